@@ -15,6 +15,13 @@ CPMAddPackage(
 if(zlib_ADDED)
     set_target_properties(zlib PROPERTIES EXCLUDE_FROM_ALL TRUE)
     set_target_properties(zlibstatic PROPERTIES EXCLUDE_FROM_ALL TRUE)
+    # zlib only sets directory-scoped includes, so consumers (httpcl) need
+    # the source dir for zlib.h and the binary dir for the generated zconf.h.
+    foreach(zlib_target zlib zlibstatic)
+        target_include_directories(${zlib_target} INTERFACE
+            $<BUILD_INTERFACE:${zlib_SOURCE_DIR}>
+            $<BUILD_INTERFACE:${zlib_BINARY_DIR}>)
+    endforeach()
     # Create ZLIB::ZLIB alias if it doesn't exist
     if(NOT TARGET ZLIB::ZLIB)
         if(TARGET zlib)
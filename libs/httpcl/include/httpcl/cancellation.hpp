@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace httpcl
+{
+
+/**
+ * Flag which lets a caller abort requests it no longer needs. Requests
+ * which are in flight when the token is cancelled are stopped, and fail
+ * with a CancelledError. Shared between the caller and its requests.
+ */
+class CancellationToken
+{
+public:
+    using CallbackId = uint64_t;
+
+    void cancel();
+    bool cancelled() const;
+
+    /**
+     * Block for up to `duration`. Returns true if
+     * the token is cancelled before it elapsed.
+     */
+    bool waitFor(std::chrono::steady_clock::duration duration) const;
+
+    /**
+     * Call `callback` once when the token is cancelled, or right
+     * away if it already is. The callback may still run after
+     * `unsubscribe()` returned if cancellation raced with it.
+     */
+    CallbackId subscribe(std::function<void()> callback);
+    void unsubscribe(CallbackId id);
+
+private:
+    mutable std::mutex mutex_;
+    mutable std::condition_variable changed_;
+    bool cancelled_ = false;
+    std::map<CallbackId, std::function<void()>> callbacks_;
+    CallbackId nextId_ = 1;
+};
+
+/**
+ * Thrown if a call is aborted through its CancellationToken.
+ */
+struct CancelledError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Thrown if a call did not finish before its deadline.
+ */
+struct DeadlineExceededError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+}
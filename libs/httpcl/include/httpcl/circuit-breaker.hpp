@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "yaml-cpp/yaml.h"
+
+namespace httpcl
+{
+
+/**
+ * When a CircuitBreaker trips, and how it recovers. A request failed
+ * if it got no response (e.g. a timeout or refused connection), or a
+ * 5xx status.
+ */
+struct CircuitBreakerPolicy
+{
+    /** Trip after this many requests in a row got no response, 0 to disable. */
+    uint32_t consecutiveFailures = 5;
+
+    /** Trip if this fraction of the last `window` requests failed. */
+    double errorRate = .5;
+    uint32_t window = 20;
+    /** Minimum number of requests in the window before `errorRate` applies. */
+    uint32_t minRequests = 10;
+
+    /** Time for which requests are rejected after tripping. */
+    std::chrono::milliseconds openDuration{30000};
+
+    /**
+     * Number of trial requests which are let through once `openDuration`
+     * has passed. The circuit closes if all of them succeed.
+     */
+    uint32_t halfOpenProbes = 1;
+};
+
+/**
+ * Circuit breaker for a single server. While closed, requests pass and
+ * their outcome is tracked. Once too many fail, the circuit opens and
+ * requests are rejected without being sent, so that callers fail fast
+ * instead of waiting for a timeout. After `openDuration`, the circuit is
+ * half-open and lets a few probe requests through to decide whether to
+ * close again.
+ */
+class CircuitBreaker
+{
+public:
+    enum class State { Closed, Open, HalfOpen };
+    using Clock = std::chrono::steady_clock;
+
+    CircuitBreaker(std::string name, CircuitBreakerPolicy policy);
+
+    /**
+     * Whether a request may be sent now. Each admitted request must be
+     * followed by `record()`, or by `abandon()` if it was not sent.
+     */
+    bool allow();
+
+    /**
+     * Report the status of an admitted request, 0 for no response.
+     */
+    void record(int status);
+
+    /**
+     * Report that an admitted request was not sent after all.
+     */
+    void abandon();
+
+    State state() const;
+
+    void setPolicy(CircuitBreakerPolicy const& policy);
+
+private:
+    void trip(Clock::time_point now);
+
+    std::string name_;
+    mutable std::mutex mutex_;
+    CircuitBreakerPolicy policy_;
+    State state_ = State::Closed;
+    Clock::time_point openedAt_;
+    /** Outcomes of recent requests in closed state, true for failures. */
+    std::deque<bool> window_;
+    uint32_t windowFailures_ = 0;
+    uint32_t consecutiveFailures_ = 0;
+    uint32_t probesInFlight_ = 0;
+    uint32_t probeSuccesses_ = 0;
+};
+
+/**
+ * Thrown if a request is rejected because the circuits
+ * for all eligible servers are open.
+ */
+struct CircuitOpenError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Process-wide circuit breakers, one per server host, so that
+ * all clients of a server share their view of its health.
+ */
+class CircuitBreakerRegistry
+{
+public:
+    static CircuitBreakerRegistry& instance();
+
+    /**
+     * Get the breaker for `host`. An existing breaker
+     * is updated to the given policy.
+     */
+    std::shared_ptr<CircuitBreaker> get(std::string const& host,
+                                        CircuitBreakerPolicy const& policy);
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<CircuitBreaker>> breakers_;
+};
+
+}
+
+namespace YAML
+{
+
+/**
+ * Conversion for `circuit-breaker` nodes in the http-settings.
+ */
+template <>
+struct convert<httpcl::CircuitBreakerPolicy>
+{
+    static Node encode(httpcl::CircuitBreakerPolicy const& policy);
+    static bool decode(Node const& node, httpcl::CircuitBreakerPolicy& policy);
+};
+
+}
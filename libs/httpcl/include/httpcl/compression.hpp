@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace httpcl
+{
+
+/**
+ * HTTP content codings which httpcl can encode and decode.
+ */
+enum class ContentEncoding {
+    Gzip,
+    Deflate
+};
+
+/**
+ * Parse a Content-Encoding header value. Returns an empty
+ * optional for `identity` and for unsupported codings.
+ */
+std::optional<ContentEncoding> parseContentEncoding(std::string_view value);
+
+/**
+ * Token for the Content-Encoding header, e.g. "gzip".
+ */
+char const* contentEncodingName(ContentEncoding encoding);
+
+/**
+ * Compress a buffer with the given coding. Deflate produces
+ * the zlib format, as mandated by RFC 9110.
+ * @throws std::runtime_error if zlib fails.
+ */
+std::string compress(std::string_view data, ContentEncoding encoding);
+
+/**
+ * Maximum size of decompressed content, read once from the
+ * HTTP_MAX_DECOMPRESSED_SIZE environment variable. Defaults
+ * to 256 MiB, 0 means unlimited.
+ */
+std::size_t maxDecompressedSize();
+
+/**
+ * Decompress a buffer with the given coding. Deflate also accepts raw
+ * deflate streams without zlib header, as sent by some servers.
+ * @throws std::runtime_error if the data is corrupt, or if it inflates
+ *  to more than `maxSize` bytes (0 means unlimited).
+ */
+std::string decompress(std::string_view data, ContentEncoding encoding,
+                       std::size_t maxSize = maxDecompressedSize());
+
+}
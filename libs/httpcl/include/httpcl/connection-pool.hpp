@@ -0,0 +1,141 @@
+#pragma once
+
+#include <httplib.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace httpcl
+{
+
+/**
+ * Process-wide pool of keep-alive httplib clients.
+ *
+ * An httplib client owns at most one socket. By lending each client to
+ * exactly one request at a time and keeping it around afterwards, the
+ * TCP connection (and TLS session) is reused by subsequent requests to the
+ * same connection key. The key is made up of scheme, host, port, proxy
+ * and TLS settings, so clients are shared across OAClient instances.
+ *
+ * The pool is configured through the following environment variables:
+ *  - HTTP_POOL_MAX_IDLE
+ *  - HTTP_POOL_MAX_IDLE_PER_HOST
+ *  - HTTP_POOL_MAX_PER_HOST
+ *  - HTTP_POOL_IDLE_TIMEOUT
+ */
+class ConnectionPool
+{
+public:
+    using ClientPtr = std::unique_ptr<httplib::Client>;
+    using ClientFactory = std::function<ClientPtr()>;
+
+    struct Options {
+        /** Maximum number of idle connections kept over all keys. */
+        std::size_t maxIdle = 64;
+        /** Maximum number of idle connections kept per key. */
+        std::size_t maxIdlePerHost = 8;
+        /** Maximum number of connections (leased + idle) per key, 0 means unlimited. */
+        std::size_t maxPerHost = 0;
+        /** Idle connections which were not used for this long are evicted. */
+        std::chrono::steady_clock::duration idleTimeout = std::chrono::seconds(30);
+    };
+
+    struct Stats {
+        /** Number of acquisitions which reused an idle connection. */
+        std::uint64_t hits = 0;
+        /** Number of acquisitions which had to create a new connection. */
+        std::uint64_t misses = 0;
+        /** Number of idle connections which were dropped from the pool. */
+        std::uint64_t evictions = 0;
+        /** Number of keys which currently have idle or leased connections. */
+        std::size_t hosts = 0;
+    };
+
+    /**
+     * Exclusive handle on a pooled client. Returns the client
+     * to the pool on destruction, unless `discard()` was called.
+     */
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        httplib::Client& client() const { return *client_; }
+
+        /** True if the client was taken from the idle set. */
+        bool reused() const { return reused_; }
+
+        /**
+         * Drop the client instead of returning it to the pool,
+         * e.g. because its connection turned out to be broken.
+         */
+        void discard();
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, std::string key, ClientPtr client, bool reused);
+
+        ConnectionPool* pool_ = nullptr;
+        std::string key_;
+        ClientPtr client_;
+        bool reused_ = false;
+    };
+
+    ConnectionPool();
+    explicit ConnectionPool(Options options);
+    ~ConnectionPool();
+
+    /**
+     * Get the process-wide pool which is configured from the
+     * HTTP_POOL_* environment variables.
+     */
+    static ConnectionPool& instance();
+
+    /**
+     * Lease an idle client for `key`, or create a new one using `factory`.
+     * Blocks if `maxPerHost` connections are already leased for the key.
+     */
+    Lease acquire(std::string const& key, ClientFactory const& factory);
+
+    /**
+     * Drop all idle connections.
+     */
+    void clear();
+
+    Stats stats() const;
+    Options const& options() const { return options_; }
+
+private:
+    struct IdleClient {
+        ClientPtr client;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    struct HostEntry {
+        std::deque<IdleClient> idle;  // Most recently used at the back
+        std::size_t leased = 0;
+    };
+
+    void release(std::string const& key, ClientPtr client, bool keep);
+    void evictExpired(std::chrono::steady_clock::time_point now, std::deque<ClientPtr>& evicted);
+    bool evictOldest(std::deque<ClientPtr>& evicted);
+
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    std::unordered_map<std::string, HostEntry> hosts_;
+    std::size_t idleCount_ = 0;
+    Stats stats_;
+};
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+#include "log.hpp"
+
+namespace httpcl
+{
+
+/**
+ * Read the integer in environment variable `name`. Returns `defaultValue`
+ * if the variable is not set, or logs a warning and returns `defaultValue`
+ * if it cannot be parsed.
+ */
+template <class _Value>
+_Value readEnvOption(char const* name, _Value defaultValue)
+{
+    static_assert(std::is_integral_v<_Value>);
+    auto str = std::getenv(name);
+    if (!str)
+        return defaultValue;
+    try {
+        if constexpr (std::is_signed_v<_Value>)
+            return static_cast<_Value>(std::stoll(str));
+        else
+            return static_cast<_Value>(std::stoull(str));
+    }
+    catch (std::exception const&) {
+        log().warn("Could not parse value of {}: '{}'.", name, str);
+    }
+    return defaultValue;
+}
+
+}
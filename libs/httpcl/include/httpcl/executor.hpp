@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace httpcl
+{
+
+/**
+ * Scheduling class of a task. Queued tasks with a higher
+ * priority are started before those with a lower one.
+ */
+enum class Priority
+{
+    Low,
+    Normal,
+    High
+};
+
+/**
+ * Fixed-size pool of worker threads with a bounded task queue.
+ * Posting blocks while the queue is full, which applies back-pressure
+ * to callers instead of spawning an unbounded number of threads.
+ */
+class ThreadPool
+{
+public:
+    ThreadPool(std::size_t threads, std::size_t maxQueued);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /**
+     * Get the process-wide pool, which is sized from the
+     * following environment variables:
+     *  - HTTP_WORKER_THREADS
+     *  - HTTP_WORKER_QUEUE
+     */
+    static ThreadPool& shared();
+
+    /**
+     * Enqueue a task. Blocks while the queue is full.
+     */
+    void post(std::function<void()> task, Priority priority = Priority::Normal);
+
+    /**
+     * Enqueue a task unless the queue is full or the pool is
+     * shutting down. Never blocks, returns false if the task was
+     * not enqueued. Use this from threads which must not wait,
+     * like the Timer thread or pool workers.
+     */
+    bool tryPost(std::function<void()> task, Priority priority = Priority::Normal);
+
+    /**
+     * Enqueue a task and obtain a future for its result.
+     */
+    template <class _Fun>
+    auto submit(_Fun&& fun, Priority priority = Priority::Normal)
+        -> std::future<std::invoke_result_t<std::decay_t<_Fun>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<_Fun>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<_Fun>(fun));
+        auto future = task->get_future();
+        post([task]{ (*task)(); }, priority);
+        return future;
+    }
+
+    std::size_t size() const { return workers_.size(); }
+
+    /**
+     * True if the calling thread is a worker of any ThreadPool.
+     */
+    static bool isWorkerThread();
+
+private:
+    void work();
+
+    std::size_t maxQueued_;
+    std::mutex mutex_;
+    std::condition_variable hasTask_;
+    std::condition_variable hasSpace_;
+    /** Queued tasks, indexed by Priority. */
+    std::array<std::deque<std::function<void()>>, 3> tasks_;
+    std::size_t queued_ = 0;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+/**
+ * Single background thread which runs short callbacks at a given time,
+ * e.g. for periodic logging or delayed actions. Callbacks must not block,
+ * as they delay all other scheduled callbacks.
+ */
+class Timer
+{
+public:
+    using TaskId = std::uint64_t;
+    using Clock = std::chrono::steady_clock;
+
+    Timer();
+    ~Timer();
+
+    Timer(Timer const&) = delete;
+    Timer& operator=(Timer const&) = delete;
+
+    /**
+     * Get the process-wide timer.
+     */
+    static Timer& shared();
+
+    /**
+     * Run `task` once after `delay`.
+     */
+    TaskId schedule(Clock::duration delay, std::function<void()> task);
+
+    /**
+     * Run `task` every `interval`, until cancelled.
+     */
+    TaskId scheduleEvery(Clock::duration interval, std::function<void()> task);
+
+    /**
+     * Cancel a scheduled task. A task which is currently
+     * running is not interrupted.
+     */
+    void cancel(TaskId id);
+
+    /**
+     * Cancels the given task on destruction.
+     */
+    struct ScopedTask
+    {
+        Timer* timer = nullptr;
+        TaskId id = 0;
+
+        ScopedTask() = default;
+        ScopedTask(Timer& timer, TaskId id) : timer(&timer), id(id) {}
+        ScopedTask(ScopedTask&& other) noexcept : timer(other.timer), id(other.id) { other.timer = nullptr; }
+        ScopedTask& operator=(ScopedTask&& other) noexcept;
+        ~ScopedTask() { if (timer) timer->cancel(id); }
+    };
+
+private:
+    struct Entry {
+        std::function<void()> task;
+        Clock::duration interval{0};
+    };
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::multimap<Clock::time_point, TaskId> queue_;
+    std::map<TaskId, Entry> entries_;
+    TaskId nextId_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+/**
+ * Where a blocking request is executed.
+ */
+enum class ExecutionPolicy
+{
+    /** Run on the calling thread. */
+    Inline,
+    /** Run on the shared ThreadPool, the caller waits for completion. */
+    WorkerPool
+};
+
+/**
+ * Read the policy from the HTTP_EXECUTION_POLICY environment variable
+ * (`inline` or `pool`). Defaults to `Inline`.
+ */
+ExecutionPolicy executionPolicyFromEnv();
+
+/**
+ * Run `task` according to `policy` and block until it is done. Exceptions
+ * thrown by `task` are rethrown. While waiting, "Waiting for response" is
+ * logged every second by the shared Timer if debug logging is enabled.
+ *
+ * Tasks are run inline if the caller already is a pool worker,
+ * to avoid exhausting the pool with waiting workers.
+ */
+void execute(ExecutionPolicy policy,
+             std::string const& debugContext,
+             std::function<void()> const& task,
+             Priority priority = Priority::Normal);
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+namespace httpcl
+{
+
+/**
+ * Recent latencies of a single operation, kept in a fixed-size
+ * ring buffer. Thread-safe.
+ */
+class LatencyWindow
+{
+public:
+    explicit LatencyWindow(std::size_t capacity = 128);
+
+    void add(std::chrono::microseconds latency);
+
+    /**
+     * The given percentile (between 0 and 1) of the recorded latencies,
+     * or an empty optional if fewer than `minSamples` were recorded.
+     */
+    std::optional<std::chrono::microseconds> percentile(double p, std::size_t minSamples = 1) const;
+
+    std::size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::chrono::microseconds> samples_;
+    std::size_t next_ = 0;
+};
+
+/**
+ * Policy for hedged requests: If an attempt did not get a response after
+ * a delay, a duplicate is sent to another server, and the first response
+ * is used. Only applies to GET methods, and to those which are
+ * explicitly marked as idempotent.
+ */
+struct HedgePolicy
+{
+    /**
+     * Fixed delay before sending a duplicate. If unset, the delay is
+     * the `percentile` of the recently observed latencies of the method.
+     */
+    std::optional<std::chrono::milliseconds> delay;
+    double percentile = .95;
+
+    /**
+     * Number of latencies which must be observed before
+     * percentile-based hedging starts.
+     */
+    uint32_t minSamples = 20;
+
+    /** Maximum number of duplicates per attempt. */
+    uint32_t maxHedges = 1;
+
+    /**
+     * Delay before the next duplicate, or an empty
+     * optional if no duplicate should be sent.
+     */
+    std::optional<std::chrono::microseconds> hedgeDelay(LatencyWindow const& latencies) const;
+};
+
+}
+
+namespace YAML
+{
+
+/**
+ * Conversion for `hedge` nodes, as used by http-settings
+ * and the `x-zswag-hedge` OpenAPI extension.
+ */
+template <>
+struct convert<httpcl::HedgePolicy>
+{
+    static Node encode(httpcl::HedgePolicy const& policy);
+    static bool decode(Node const& node, httpcl::HedgePolicy& policy);
+};
+
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "http-client.hpp"
+
+namespace httpcl
+{
+
+/**
+ * Response as kept by a CachingHttpClient.
+ */
+struct CachedResponse
+{
+    int status = 0;
+    std::string content;
+    Headers headers;
+    /** The response must be revalidated after this point in time. */
+    std::chrono::system_clock::time_point expires;
+};
+
+/**
+ * Storage for a CachingHttpClient. Implementations must be thread-safe.
+ */
+class HttpCacheStore
+{
+public:
+    virtual ~HttpCacheStore() = default;
+
+    virtual std::optional<CachedResponse> load(std::string const& key) = 0;
+    virtual void store(std::string const& key, CachedResponse const& response) = 0;
+    virtual void erase(std::string const& key) = 0;
+};
+
+/**
+ * In-memory HttpCacheStore, which drops the least recently
+ * used responses once they take up more than `maxBytes`.
+ */
+class MemoryHttpCacheStore : public HttpCacheStore
+{
+public:
+    explicit MemoryHttpCacheStore(std::size_t maxBytes);
+
+    std::optional<CachedResponse> load(std::string const& key) override;
+    void store(std::string const& key, CachedResponse const& response) override;
+    void erase(std::string const& key) override;
+
+    std::size_t bytes() const;
+
+private:
+    struct Entry {
+        std::string key;
+        CachedResponse response;
+        std::size_t bytes = 0;
+    };
+
+    void erase(std::list<Entry>::iterator entry);
+
+    std::size_t maxBytes_;
+    mutable std::mutex mutex_;
+    /** Most recently used entries first. */
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::size_t bytes_ = 0;
+};
+
+/**
+ * HttpCacheStore which keeps each response in a file under `directory`,
+ * so that responses survive restarts. The directory may be shared by
+ * several processes on one host: Files are written under a temporary
+ * name and renamed into place, and unreadable files are ignored.
+ *
+ * Loading a response touches its file. Once the files take up more
+ * than `maxBytes`, the least recently used ones are deleted until they
+ * fit into three quarters of it. Responses which were stored more than
+ * `ttl` ago are deleted, even if they could still be revalidated.
+ * Files which were not written by a DiskHttpCacheStore are never deleted.
+ */
+class DiskHttpCacheStore : public HttpCacheStore
+{
+public:
+    struct Options {
+        std::size_t maxBytes = 1024 * 1024 * 1024;
+        std::chrono::seconds ttl = std::chrono::hours(24 * 7);
+    };
+
+    explicit DiskHttpCacheStore(std::filesystem::path directory);
+    DiskHttpCacheStore(std::filesystem::path directory, Options options);
+
+    std::optional<CachedResponse> load(std::string const& key) override;
+    void store(std::string const& key, CachedResponse const& response) override;
+    void erase(std::string const& key) override;
+
+    /**
+     * Delete expired files, and the least recently used ones
+     * if the budget is exceeded. Called by `store()` as needed.
+     */
+    void trim();
+
+    /** Size of the files as of the last `trim()`, plus those stored since. */
+    std::size_t bytes() const { return bytes_; }
+
+private:
+    std::filesystem::path path(std::string const& key) const;
+
+    std::filesystem::path directory_;
+    Options options_;
+    std::mutex trimMutex_;
+    std::atomic<std::size_t> bytes_{0};
+};
+
+/**
+ * Combination of a fast and a large HttpCacheStore, e.g. memory in front
+ * of disk. Responses are stored in both, and copied to `front` when they
+ * are loaded from `back`.
+ */
+class TieredHttpCacheStore : public HttpCacheStore
+{
+public:
+    TieredHttpCacheStore(std::shared_ptr<HttpCacheStore> front,
+                         std::shared_ptr<HttpCacheStore> back);
+
+    std::optional<CachedResponse> load(std::string const& key) override;
+    void store(std::string const& key, CachedResponse const& response) override;
+    void erase(std::string const& key) override;
+
+private:
+    std::shared_ptr<HttpCacheStore> front_;
+    std::shared_ptr<HttpCacheStore> back_;
+};
+
+/**
+ * IHttpClient decorator which caches GET responses as a private
+ * HTTP cache (RFC 9111) would:
+ *  - `200` responses are fresh for their `Cache-Control: max-age`,
+ *    minus their `Age`. Fresh responses are returned without a request.
+ *  - Stale responses are revalidated with `If-None-Match`/`If-Modified-Since`
+ *    if they have an `ETag`/`Last-Modified`. A `304` reuses the cached body.
+ *  - `no-store` and `Vary: *` responses are not cached,
+ *    `no-cache` ones are revalidated on every use.
+ *  - Other methods are passed through. If they succeed, the
+ *    cached response for the same URI and config is dropped.
+ *
+ * Responses are keyed by URI and a digest of the headers, query
+ * parameters, cookies and credentials of the config. With an OAuth2
+ * config, the client identity stands in for the `Authorization` header,
+ * so that refreshed tokens still find the cached responses.
+ */
+class CachingHttpClient : public IHttpClient
+{
+public:
+    CachingHttpClient(std::unique_ptr<IHttpClient> client,
+                      std::shared_ptr<HttpCacheStore> store);
+
+    /**
+     * Wrap `client` in a CachingHttpClient if HTTP_CACHE_SIZE is set
+     * to a nonzero number of bytes, or if HTTP_CACHE_DIR is set. Otherwise,
+     * return it unchanged. All clients which are wrapped this way share
+     * one store: In memory, on disk, or both.
+     */
+    static std::unique_ptr<IHttpClient> wrapFromEnv(std::unique_ptr<IHttpClient> client);
+
+    struct Stats {
+        /** Responses which were returned without a request. */
+        uint64_t hits = 0;
+        /** Stale responses which were confirmed by a `304`. */
+        uint64_t revalidations = 0;
+        /** GET requests which returned a new response. */
+        uint64_t misses = 0;
+    };
+
+    Stats stats() const;
+
+    /**
+     * The wrapped client. Requests sent through it bypass the cache.
+     */
+    IHttpClient& transport() { return *client_; }
+
+    Result get(const std::string& uri,
+               const Config& config) override;
+    Result post(const std::string& uri,
+                const OptionalBodyAndContentType& body,
+                const Config& config) override;
+    Result put(const std::string& uri,
+               const OptionalBodyAndContentType& body,
+               const Config& config) override;
+    Result del(const std::string& uri,
+               const OptionalBodyAndContentType& body,
+               const Config& config) override;
+    Result patch(const std::string& uri,
+                 const OptionalBodyAndContentType& body,
+                 const Config& config) override;
+
+private:
+    Result invalidate(Result result, const std::string& uri, const Config& config);
+
+    std::unique_ptr<IHttpClient> client_;
+    std::shared_ptr<HttpCacheStore> store_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> revalidations_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+}
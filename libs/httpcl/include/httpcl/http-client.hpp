@@ -11,6 +11,7 @@
 #include "http-settings.hpp"
 #include "uri.hpp"
 #include "log.hpp"
+#include "connection-pool.hpp"
 
 namespace httpcl
 {
@@ -29,6 +30,13 @@ public:
     struct Result {
         int status;
         std::string content;
+        Headers headers;
+
+        /**
+         * Value of the first response header with the given
+         * (case-insensitive) name, or an empty string.
+         */
+        std::string header(std::string_view name) const;
     };
 
     struct Error : std::runtime_error {
@@ -58,10 +66,16 @@ public:
                          const Config& config) = 0;
 };
 
+/**
+ * IHttpClient implementation based on cpp-httplib. Connections are
+ * kept alive and reused through a ConnectionPool, which defaults
+ * to the process-wide `ConnectionPool::instance()`.
+ */
 class HttpLibHttpClient : public IHttpClient
 {
 public:
     HttpLibHttpClient();
+    explicit HttpLibHttpClient(ConnectionPool& pool);
 
     Result get(const std::string& uri,
                const Config& config) override;
@@ -78,6 +92,7 @@ public:
                  const OptionalBodyAndContentType& body,
                  const Config& config) override;
 private:
+    ConnectionPool& pool_;
     time_t timeoutSecs_ = 60.;
     bool sslCertStrict_ = false;
 };
@@ -8,8 +8,16 @@
 #include <shared_mutex>
 #include <atomic>
 #include <deque>
+#include <filesystem>
+#include <memory>
+#include <functional>
 
 #include "yaml-cpp/yaml.h"
+#include "compression.hpp"
+#include "retry.hpp"
+#include "hedging.hpp"
+#include "circuit-breaker.hpp"
+#include "cancellation.hpp"
 
 
 namespace httpcl
@@ -26,6 +34,12 @@ using Query = std::multimap<std::string, std::string>;
  *   - Optional Proxy-Config
  *   - Optional Basic-Auth
  *   - API-Key
+ *   - Optional Compression
+ *   - Optional Retry Policy
+ *   - Optional Circuit Breaker Policy
+ *   - Optional Hedge Policy
+ *   - Optional Idempotency Override
+ *   - Optional Response Cache TTL
  */
 struct Config
 {
@@ -56,6 +70,13 @@ struct Config
         std::vector<std::string> scopesOverride; // optional
         bool useForSpecFetch = true;  // Use OAuth2 token when fetching OpenAPI spec (default: true)
 
+        /**
+         * Share of a token's lifetime after which it is refreshed in the
+         * background, while requests keep using it (0 < x <= 1). A value
+         * of 1 disables background refresh.
+         */
+        std::optional<double> refreshAfter;
+
         /**
          * Token endpoint authentication method.
          * Specifies how the client authenticates when requesting tokens.
@@ -82,6 +103,24 @@ struct Config
         TokenEndpointAuthMethod getTokenEndpointAuthMethod() const {
             return tokenEndpointAuth ? tokenEndpointAuth->method : TokenEndpointAuthMethod::Rfc6749_ClientSecretBasic;
         }
+
+        /**
+         * Helper to get the background refresh share with default (0.8).
+         */
+        double getRefreshAfter() const {
+            return refreshAfter.value_or(0.8);
+        }
+    };
+
+    /**
+     * Opt-in body compression. If `accept` is set, gzip/deflate responses
+     * are requested via Accept-Encoding. If `request` is set, request bodies
+     * of at least `minSize` bytes are sent with that Content-Encoding.
+     */
+    struct Compression {
+        bool accept = true;
+        std::optional<ContentEncoding> request;
+        std::size_t minSize = 1024;
     };
 
     std::optional<std::string> scope;
@@ -93,9 +132,28 @@ struct Config
     std::optional<Proxy> proxy;
     std::optional<OAuth2> oauth2;
     std::optional<std::string> apiKey;
+    std::optional<Compression> compression;
+    std::optional<RetryPolicy> retry;
+    std::optional<CircuitBreakerPolicy> circuitBreaker;
+    std::optional<HedgePolicy> hedge;
+    /**
+     * Whether calls to matching URLs may be repeated (retries) and sent
+     * concurrently (hedging), regardless of their HTTP method. Overrides
+     * the default of the zswag client and `x-zswag-idempotent`.
+     */
+    std::optional<bool> idempotent;
+    /** How long responses are cached by the zswag client, 0 disables caching. */
+    std::optional<std::chrono::seconds> cacheTtl;
     Headers headers;
     Query query;
 
+    /**
+     * Limits of the current call, which are set by the caller.
+     * They are not part of the YAML representation.
+     */
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    std::shared_ptr<CancellationToken> cancellation;
+
     /**
      * Merge this configuration with another.
      */
@@ -124,10 +182,18 @@ struct Config
 /**
  * Loads/stores settings from/to HTTP_SETTINGS_FILE.
  * Allows returning config for a specific URL.
+ *
+ * Lookups read an immutable snapshot, which is swapped atomically by
+ * `load()`, `store()` and `edit()`, so they never take a lock. On Linux,
+ * HTTP_SETTINGS_FILE is watched, and changes are reloaded in the background.
  */
 struct Settings
 {
     Settings();
+    ~Settings();
+
+    Settings(Settings const&) = delete;
+    Settings& operator=(Settings const&) = delete;
 
     void load();
     void store();
@@ -138,36 +204,105 @@ struct Settings
     Config operator[](const std::string& url) const;
 
     /**
-     * Get or create a Config entry by a target scope.
+     * Copy of the entries, which map from URL pattern to some config values.
      */
-    Config& getOrCreateConfigScope(std::string_view const& scope);
+    std::deque<Config> entries() const;
 
     /**
-     * Map from URL pattern to some config values.
+     * Modify the entries through `fun`. The changes are visible to
+     * `operator[]` once this returns, but only written to
+     * HTTP_SETTINGS_FILE by `store()`.
      */
-    std::deque<Config> settings;
+    void edit(std::function<void(std::deque<Config>&)> const& fun);
+
+    /**
+     * Get or create a Config entry by a target scope,
+     * e.g. in a function passed to `edit()`.
+     */
+    static Config& getOrCreateConfigScope(std::deque<Config>& entries, std::string_view const& scope);
+
     YAML::Node document;
     mutable std::shared_mutex mutex;
-    std::chrono::steady_clock::time_point lastRead;
+    std::atomic<std::chrono::steady_clock::time_point> lastRead;
 
     /**
-     * Prompt settings instance to re-parse the HTTP settings file,
+     * Prompt settings instances to re-parse the HTTP settings file,
      * by calling updateTimestamp with std::chrono::steady_clock::now().
+     * All instances which were read before `time` are reloaded
+     * before this function returns.
      */
     static void updateTimestamp(std::chrono::steady_clock::time_point time);
     static std::atomic<std::chrono::steady_clock::time_point> lastUpdated;
+
+    /**
+     * Reload all instances for which HTTP_SETTINGS_FILE was modified
+     * since they last read or wrote it. Called by the file watcher.
+     */
+    static void reloadModified();
+
+private:
+    /**
+     * Map from URL pattern to some config values. Guarded by `mutex`.
+     */
+    std::deque<Config> settings_;
+
+    /**
+     * Immutable, indexed copy of `settings_`.
+     */
+    struct Snapshot;
+
+    /**
+     * Current snapshot, accessed through std::atomic_load/std::atomic_store.
+     */
+    std::shared_ptr<Snapshot const> snapshot_;
+
+    /**
+     * Modification time of HTTP_SETTINGS_FILE after the last load/store.
+     * Guarded by `mutex`.
+     */
+    std::filesystem::file_time_type fileTime_{};
 };
 
 struct secret
 {
+    /**
+     * Password store used by `load`, `store` and `remove`. Methods
+     * throw std::runtime_error on failure. The default implementation
+     * uses the system keychain.
+     */
+    struct Keychain
+    {
+        virtual ~Keychain() = default;
+        virtual std::string getPassword(const std::string& service, const std::string& user) = 0;
+        virtual void setPassword(const std::string& service, const std::string& user, const std::string& password) = 0;
+        virtual bool deletePassword(const std::string& service, const std::string& user) = 0;
+    };
+
+    /**
+     * Replace the password store, e.g. with a mock in tests. Passing
+     * nullptr restores the system keychain. Clears the cache.
+     */
+    static void setKeychain(std::shared_ptr<Keychain> keychain);
+
     /**
      * Read password from system keychain.
      * Returns keychain service string.
+     *
+     * Passwords are cached in memory per (service, user) for
+     * HTTP_KEYCHAIN_CACHE_TTL seconds (default 300, 0 disables the cache).
+     * Concurrent loads of an uncached password share one keychain query.
      */
     static std::string load(
         const std::string& service,
         const std::string& user);
 
+    /**
+     * Drop all cached passwords, so that the next `load`
+     * queries the keychain again. Called when the HTTP settings
+     * file changed on disk.
+     */
+    static void clearCache();
+
     /**
      * Store password into system keychain.
      * Returns the generated keychain service string to be set as `keychain`.
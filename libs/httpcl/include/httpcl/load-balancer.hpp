@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "http-settings.hpp"
+#include "executor.hpp"
+
+namespace httpcl
+{
+
+class IHttpClient;
+
+/**
+ * Strategy for spreading calls across the servers of a service.
+ */
+enum class LoadBalancing
+{
+    /** Send all calls to the preferred server. */
+    Off,
+    /** Cycle through the servers. */
+    RoundRobin,
+    /** Pick the server with the fewest requests in flight. */
+    LeastOutstanding,
+    /**
+     * Compare two random servers by their exponentially weighted
+     * moving average latency, scaled by their requests in flight
+     * ("power of two choices").
+     */
+    Ewma
+};
+
+/**
+ * Read the strategy from the HTTP_LOAD_BALANCING environment variable
+ * (`off`, `round-robin`, `least-outstanding` or `ewma`). Defaults to `Off`.
+ */
+LoadBalancing loadBalancingFromEnv();
+
+/**
+ * Read the interval for server health probes from the HTTP_PROBE_INTERVAL
+ * environment variable, in seconds. Defaults to 10, 0 disables probing.
+ */
+std::chrono::seconds probeIntervalFromEnv();
+
+/**
+ * Chooses the server for each call and tracks per-server load and latency.
+ * Servers which failed repeatedly are demoted: They are skipped as long as
+ * any other server is healthy, until a request or probe to them succeeds.
+ * One in `trialEvery` calls still goes to a demoted server, so that it
+ * recovers even without probes.
+ */
+class LoadBalancer : public std::enable_shared_from_this<LoadBalancer>
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** Consecutive failures after which a server is skipped. */
+    static constexpr uint32_t unhealthyAfterFailures = 3;
+
+    /** One in this many calls goes to a demoted server, if there is one. */
+    static constexpr uint32_t trialEvery = 100;
+
+    /** Time after which a probe request is stopped and counts as failed. */
+    static constexpr std::chrono::seconds probeTimeout{2};
+
+    LoadBalancer(std::size_t servers, LoadBalancing mode, std::size_t preferred = 0);
+
+    LoadBalancer(LoadBalancer const&) = delete;
+    LoadBalancer& operator=(LoadBalancer const&) = delete;
+
+    LoadBalancing mode() const { return mode_; }
+    std::size_t size() const { return servers_.size(); }
+
+    /**
+     * Server index for the next call.
+     */
+    std::size_t pick();
+
+    /**
+     * Report that a request to `server` was sent, or that it finished.
+     * A request failed if it got no response, or a 5xx status.
+     */
+    void begin(std::size_t server);
+    void end(std::size_t server, Clock::duration latency, bool success);
+
+    /**
+     * Report that a request to `server` was aborted on the client
+     * side, which says nothing about the server's health or latency.
+     */
+    void abandon(std::size_t server);
+
+    /**
+     * Start sending a GET request to each of the given server URLs
+     * every `interval`, in parallel on the shared ThreadPool. `configs`
+     * holds the config for each URL, or is empty. Probes only update
+     * latency and health, any HTTP response within `probeTimeout` counts
+     * as healthy. A probe is skipped while the previous probe of the
+     * same server still runs, or if the pool queue is full. Probing
+     * stops when the balancer or the client is destroyed.
+     */
+    void startProbing(std::weak_ptr<IHttpClient> client,
+                      std::vector<std::string> urls,
+                      std::vector<Config> configs,
+                      Clock::duration interval);
+
+    struct ServerStats {
+        uint32_t outstanding = 0;
+        /** Average latency, zero until the first response. */
+        std::chrono::microseconds latency{0};
+        uint32_t consecutiveFailures = 0;
+        bool healthy = true;
+    };
+
+    ServerStats stats(std::size_t server) const;
+
+private:
+    struct Server {
+        std::atomic<uint32_t> outstanding{0};
+        std::atomic<uint32_t> consecutiveFailures{0};
+        /** EWMA latency in microseconds, guarded by mutex_. */
+        double latency = 0.;
+        /** Whether a probe of the server is running. */
+        std::atomic<bool> probing{false};
+    };
+
+    void record(std::size_t server, Clock::duration latency, bool success);
+    bool healthy(std::size_t server) const;
+    double cost(std::size_t server) const;
+    void probe();
+
+    LoadBalancing mode_;
+    std::size_t preferred_;
+    std::vector<std::unique_ptr<Server>> servers_;
+    std::atomic<std::size_t> next_{0};
+    mutable std::mutex mutex_;
+
+    std::weak_ptr<IHttpClient> probeClient_;
+    std::vector<std::string> probeUrls_;
+    std::vector<Config> probeConfigs_;
+    Timer::ScopedTask probeTask_;
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+namespace httpcl
+{
+
+/**
+ * Policy for repeating failed requests. A request is repeated if it
+ * failed without a response (status 0), or with one of `statuses`.
+ * Attempts are spaced by exponential backoff with random jitter. A
+ * `Retry-After` response header extends the delay.
+ */
+struct RetryPolicy
+{
+    /** Total number of attempts, including the first one. */
+    uint32_t maxAttempts = 3;
+
+    std::chrono::milliseconds initialBackoff{100};
+    std::chrono::milliseconds maxBackoff{10000};
+    double multiplier = 2.;
+
+    /**
+     * Fraction of each backoff which is randomized, between 0 and 1.
+     * With 0.5, a delay of 200ms becomes a random value in [100ms, 200ms].
+     */
+    double jitter = .5;
+
+    std::vector<int> statuses{408, 429, 502, 503, 504};
+
+    /** Also repeat methods which are not idempotent, e.g. POST. */
+    bool nonIdempotent = false;
+
+    /** Send repeated attempts to the next server of the service. */
+    bool failover = true;
+
+    /**
+     * Whether a response with the given status (0 for
+     * no response) may be retried.
+     */
+    bool retryable(int status) const;
+
+    /**
+     * Randomized delay after the given number of failed attempts.
+     */
+    std::chrono::milliseconds backoff(uint32_t failedAttempts) const;
+};
+
+/**
+ * Parse a Retry-After header value, which is either a number of
+ * seconds, or an HTTP-date. Returns the delay relative to `now`,
+ * or an empty optional if the value could not be parsed.
+ */
+std::optional<std::chrono::milliseconds> parseRetryAfter(
+    std::string const& value,
+    std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+}
+
+namespace YAML
+{
+
+/**
+ * Conversion for `retry` nodes, as used by http-settings
+ * and the `x-zswag-retry` OpenAPI extension.
+ */
+template <>
+struct convert<httpcl::RetryPolicy>
+{
+    static Node encode(httpcl::RetryPolicy const& policy);
+    static bool decode(Node const& node, httpcl::RetryPolicy& policy);
+};
+
+}
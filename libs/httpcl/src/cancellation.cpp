@@ -0,0 +1,55 @@
+#include "cancellation.hpp"
+
+namespace httpcl
+{
+
+void CancellationToken::cancel()
+{
+    std::map<CallbackId, std::function<void()>> callbacks;
+    {
+        std::lock_guard lock(mutex_);
+        if (cancelled_)
+            return;
+        cancelled_ = true;
+        callbacks.swap(callbacks_);
+    }
+    changed_.notify_all();
+
+    // Run outside of the lock, so that callbacks may use the token.
+    for (auto& [id, callback] : callbacks)
+        callback();
+}
+
+bool CancellationToken::cancelled() const
+{
+    std::lock_guard lock(mutex_);
+    return cancelled_;
+}
+
+bool CancellationToken::waitFor(std::chrono::steady_clock::duration duration) const
+{
+    std::unique_lock lock(mutex_);
+    return changed_.wait_for(lock, duration, [this]{ return cancelled_; });
+}
+
+CancellationToken::CallbackId CancellationToken::subscribe(std::function<void()> callback)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (!cancelled_) {
+            auto id = nextId_++;
+            callbacks_.emplace(id, std::move(callback));
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void CancellationToken::unsubscribe(CallbackId id)
+{
+    std::lock_guard lock(mutex_);
+    callbacks_.erase(id);
+}
+
+}
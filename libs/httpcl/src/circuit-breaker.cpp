@@ -0,0 +1,166 @@
+#include "circuit-breaker.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+
+namespace httpcl
+{
+
+CircuitBreaker::CircuitBreaker(std::string name, CircuitBreakerPolicy policy)
+    : name_(std::move(name))
+    , policy_(std::move(policy))
+{}
+
+bool CircuitBreaker::allow()
+{
+    std::lock_guard lock(mutex_);
+    if (state_ == State::Open) {
+        if (Clock::now() - openedAt_ < policy_.openDuration)
+            return false;
+        state_ = State::HalfOpen;
+        probesInFlight_ = 0;
+        probeSuccesses_ = 0;
+    }
+
+    if (state_ == State::HalfOpen) {
+        if (probesInFlight_ + probeSuccesses_ >= std::max(policy_.halfOpenProbes, 1u))
+            return false;
+        ++probesInFlight_;
+    }
+    return true;
+}
+
+void CircuitBreaker::record(int status)
+{
+    auto failed = status == 0 || status >= 500;
+    auto now = Clock::now();
+
+    std::lock_guard lock(mutex_);
+    switch (state_) {
+    case State::Closed:
+        consecutiveFailures_ = status == 0 ? consecutiveFailures_ + 1 : 0;
+
+        window_.push_back(failed);
+        windowFailures_ += failed;
+        while (window_.size() > std::max(policy_.window, 1u)) {
+            windowFailures_ -= window_.front();
+            window_.pop_front();
+        }
+
+        if ((policy_.consecutiveFailures > 0 && consecutiveFailures_ >= policy_.consecutiveFailures) ||
+            (windowFailures_ > 0 && window_.size() >= policy_.minRequests &&
+             windowFailures_ >= policy_.errorRate * window_.size()))
+            trip(now);
+        break;
+
+    case State::HalfOpen:
+        if (probesInFlight_ > 0)
+            --probesInFlight_;
+        if (failed) {
+            trip(now);
+        }
+        else if (++probeSuccesses_ >= std::max(policy_.halfOpenProbes, 1u)) {
+            log().info("[CircuitBreaker] Closing circuit for {} after {} successful probe(s).", name_, probeSuccesses_);
+            state_ = State::Closed;
+            consecutiveFailures_ = 0;
+        }
+        break;
+
+    case State::Open:
+        // Late response of a request which was sent before the circuit opened.
+        break;
+    }
+}
+
+void CircuitBreaker::abandon()
+{
+    std::lock_guard lock(mutex_);
+    if (state_ == State::HalfOpen && probesInFlight_ > 0)
+        --probesInFlight_;
+}
+
+CircuitBreaker::State CircuitBreaker::state() const
+{
+    std::lock_guard lock(mutex_);
+    if (state_ == State::Open && Clock::now() - openedAt_ >= policy_.openDuration)
+        return State::HalfOpen;
+    return state_;
+}
+
+void CircuitBreaker::setPolicy(CircuitBreakerPolicy const& policy)
+{
+    std::lock_guard lock(mutex_);
+    policy_ = policy;
+}
+
+void CircuitBreaker::trip(Clock::time_point now)
+{
+    log().warn("[CircuitBreaker] Opening circuit for {} for {}ms ({} of {} recent requests failed, {} in a row without response).",
+               name_, policy_.openDuration.count(), windowFailures_, window_.size(), consecutiveFailures_);
+    state_ = State::Open;
+    openedAt_ = now;
+    window_.clear();
+    windowFailures_ = 0;
+    consecutiveFailures_ = 0;
+    probesInFlight_ = 0;
+    probeSuccesses_ = 0;
+}
+
+CircuitBreakerRegistry& CircuitBreakerRegistry::instance()
+{
+    // Intentionally leaked, see ThreadPool::shared().
+    static auto* registry = new CircuitBreakerRegistry();
+    return *registry;
+}
+
+std::shared_ptr<CircuitBreaker> CircuitBreakerRegistry::get(
+    std::string const& host,
+    CircuitBreakerPolicy const& policy)
+{
+    std::lock_guard lock(mutex_);
+    auto& breaker = breakers_[host];
+    if (!breaker)
+        breaker = std::make_shared<CircuitBreaker>(host, policy);
+    else
+        breaker->setPolicy(policy);
+    return breaker;
+}
+
+}
+
+namespace YAML
+{
+
+Node convert<httpcl::CircuitBreakerPolicy>::encode(httpcl::CircuitBreakerPolicy const& policy)
+{
+    Node node;
+    node["consecutive-failures"] = policy.consecutiveFailures;
+    node["error-rate"] = policy.errorRate;
+    node["window"] = policy.window;
+    node["min-requests"] = policy.minRequests;
+    node["open-ms"] = policy.openDuration.count();
+    node["half-open-probes"] = policy.halfOpenProbes;
+    return node;
+}
+
+bool convert<httpcl::CircuitBreakerPolicy>::decode(Node const& node, httpcl::CircuitBreakerPolicy& policy)
+{
+    if (!node.IsMap())
+        return false;
+
+    if (auto v = node["consecutive-failures"])
+        policy.consecutiveFailures = v.as<uint32_t>();
+    if (auto v = node["error-rate"])
+        policy.errorRate = v.as<double>();
+    if (auto v = node["window"])
+        policy.window = v.as<uint32_t>();
+    if (auto v = node["min-requests"])
+        policy.minRequests = v.as<uint32_t>();
+    if (auto v = node["open-ms"])
+        policy.openDuration = std::chrono::milliseconds(v.as<int64_t>());
+    if (auto v = node["half-open-probes"])
+        policy.halfOpenProbes = v.as<uint32_t>();
+    return true;
+}
+
+}
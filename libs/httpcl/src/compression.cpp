@@ -0,0 +1,156 @@
+#include "compression.hpp"
+#include "env.hpp"
+#include "log.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+
+#include "stx/format.h"
+
+namespace httpcl
+{
+
+namespace
+{
+
+constexpr auto chunkSize = std::size_t(16 * 1024);
+constexpr auto defaultMaxDecompressedSize = std::size_t(256) * 1024 * 1024;
+
+// zlib window bits: 15 for the zlib format, +16 for a gzip wrapper,
+// +32 to detect either automatically, negative for raw deflate.
+constexpr int zlibWindowBits = 15;
+constexpr int gzipWindowBits = 15 + 16;
+constexpr int autoWindowBits = 15 + 32;
+constexpr int rawWindowBits = -15;
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.front())))
+        value.remove_prefix(1);
+    while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+        value.remove_suffix(1);
+    return value;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+        std::equal(a.begin(), a.end(), b.begin(), [](char l, char r) {
+            return std::tolower(static_cast<unsigned char>(l)) ==
+                   std::tolower(static_cast<unsigned char>(r));
+        });
+}
+
+void checkSize(std::string_view data)
+{
+    if (data.size() > std::numeric_limits<uInt>::max())
+        throw logRuntimeError(stx::format(
+            "Cannot (de)compress buffer of {} bytes.", data.size()));
+}
+
+bool inflateWith(std::string_view data, int windowBits, std::size_t maxSize, std::string& result)
+{
+    z_stream stream{};
+    if (inflateInit2(&stream, windowBits) != Z_OK)
+        return false;
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    result.clear();
+    result.reserve(maxSize ? std::min(data.size() * 3, maxSize) : data.size() * 3);
+
+    int status = Z_OK;
+    while (status == Z_OK) {
+        auto offset = result.size();
+        result.resize(offset + chunkSize);
+        stream.next_out = reinterpret_cast<Bytef*>(&result[offset]);
+        stream.avail_out = static_cast<uInt>(chunkSize);
+        status = inflate(&stream, Z_NO_FLUSH);
+        result.resize(offset + chunkSize - stream.avail_out);
+
+        // Stop early instead of inflating a decompression bomb.
+        if (maxSize && result.size() > maxSize) {
+            inflateEnd(&stream);
+            result.clear();
+            result.shrink_to_fit();
+            throw logRuntimeError(stx::format(
+                "Decompressed content exceeds the limit of {} bytes ({} bytes compressed).",
+                maxSize, data.size()));
+        }
+    }
+
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+}
+
+std::optional<ContentEncoding> parseContentEncoding(std::string_view value)
+{
+    value = trim(value);
+    if (equalsIgnoreCase(value, "gzip") || equalsIgnoreCase(value, "x-gzip"))
+        return ContentEncoding::Gzip;
+    if (equalsIgnoreCase(value, "deflate"))
+        return ContentEncoding::Deflate;
+    return {};
+}
+
+char const* contentEncodingName(ContentEncoding encoding)
+{
+    return encoding == ContentEncoding::Gzip ? "gzip" : "deflate";
+}
+
+std::string compress(std::string_view data, ContentEncoding encoding)
+{
+    checkSize(data);
+
+    z_stream stream{};
+    auto windowBits = encoding == ContentEncoding::Gzip ? gzipWindowBits : zlibWindowBits;
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw logRuntimeError("Failed to initialize zlib compression.");
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+
+    std::string result;
+    result.resize(deflateBound(&stream, stream.avail_in));
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+
+    // The output is sized by deflateBound, so a single call finishes the stream.
+    auto status = deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    if (status != Z_STREAM_END)
+        throw logRuntimeError(stx::format("zlib compression failed (status {}).", status));
+    return result;
+}
+
+std::size_t maxDecompressedSize()
+{
+    static auto const maxSize = readEnvOption("HTTP_MAX_DECOMPRESSED_SIZE", defaultMaxDecompressedSize);
+    return maxSize;
+}
+
+std::string decompress(std::string_view data, ContentEncoding encoding, std::size_t maxSize)
+{
+    checkSize(data);
+
+    std::string result;
+    if (inflateWith(data, autoWindowBits, maxSize, result))
+        return result;
+    if (encoding == ContentEncoding::Deflate && inflateWith(data, rawWindowBits, maxSize, result))
+        return result;
+
+    throw logRuntimeError(stx::format(
+        "Failed to decompress {}-encoded content ({} bytes).",
+        contentEncodingName(encoding), data.size()));
+}
+
+}
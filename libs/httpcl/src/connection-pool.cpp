@@ -0,0 +1,219 @@
+#include "connection-pool.hpp"
+#include "env.hpp"
+#include "log.hpp"
+
+namespace httpcl
+{
+
+ConnectionPool::Lease::Lease(ConnectionPool* pool, std::string key, ClientPtr client, bool reused)
+    : pool_(pool)
+    , key_(std::move(key))
+    , client_(std::move(client))
+    , reused_(reused)
+{}
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_)
+    , key_(std::move(other.key_))
+    , client_(std::move(other.client_))
+    , reused_(other.reused_)
+{
+    other.pool_ = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other) {
+        if (pool_)
+            pool_->release(key_, std::move(client_), true);
+        pool_ = other.pool_;
+        key_ = std::move(other.key_);
+        client_ = std::move(other.client_);
+        reused_ = other.reused_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease()
+{
+    if (pool_)
+        pool_->release(key_, std::move(client_), true);
+}
+
+void ConnectionPool::Lease::discard()
+{
+    if (pool_)
+        pool_->release(key_, std::move(client_), false);
+    pool_ = nullptr;
+}
+
+ConnectionPool::ConnectionPool()
+    : ConnectionPool(Options{})
+{}
+
+ConnectionPool::ConnectionPool(Options options)
+    : options_(options)
+{}
+
+ConnectionPool::~ConnectionPool() = default;
+
+ConnectionPool& ConnectionPool::instance()
+{
+    static ConnectionPool pool([]{
+        Options options;
+        options.maxIdle = readEnvOption("HTTP_POOL_MAX_IDLE", options.maxIdle);
+        options.maxIdlePerHost = readEnvOption("HTTP_POOL_MAX_IDLE_PER_HOST", options.maxIdlePerHost);
+        options.maxPerHost = readEnvOption("HTTP_POOL_MAX_PER_HOST", options.maxPerHost);
+        options.idleTimeout = std::chrono::seconds(readEnvOption("HTTP_POOL_IDLE_TIMEOUT",
+            std::chrono::duration_cast<std::chrono::seconds>(options.idleTimeout).count()));
+        return options;
+    }());
+    return pool;
+}
+
+ConnectionPool::Lease ConnectionPool::acquire(std::string const& key, ClientFactory const& factory)
+{
+    std::deque<ClientPtr> evicted;
+    ClientPtr client;
+    {
+        std::unique_lock lock(mutex_);
+        evictExpired(std::chrono::steady_clock::now(), evicted);
+
+        if (options_.maxPerHost > 0) {
+            // Entries may be erased while waiting, so look the key up again.
+            released_.wait(lock, [&]{
+                auto& host = hosts_[key];
+                return !host.idle.empty() || host.leased < options_.maxPerHost;
+            });
+        }
+
+        auto& host = hosts_[key];
+        ++host.leased;
+        if (!host.idle.empty()) {
+            client = std::move(host.idle.back().client);
+            host.idle.pop_back();
+            --idleCount_;
+            ++stats_.hits;
+        }
+        else
+            ++stats_.misses;
+    }
+
+    // Evicted clients close their sockets outside of the lock.
+    evicted.clear();
+
+    if (client)
+        return {this, key, std::move(client), true};
+
+    try {
+        return {this, key, factory(), false};
+    }
+    catch (...) {
+        release(key, nullptr, false);
+        throw;
+    }
+}
+
+void ConnectionPool::release(std::string const& key, ClientPtr client, bool keep)
+{
+    std::deque<ClientPtr> evicted;
+    {
+        std::lock_guard lock(mutex_);
+        auto& host = hosts_[key];
+        --host.leased;
+
+        if (keep && client && options_.maxIdlePerHost > 0 && options_.maxIdle > 0) {
+            auto now = std::chrono::steady_clock::now();
+            host.idle.push_back({std::move(client), now});
+            ++idleCount_;
+
+            if (host.idle.size() > options_.maxIdlePerHost) {
+                evicted.emplace_back(std::move(host.idle.front().client));
+                host.idle.pop_front();
+                --idleCount_;
+                ++stats_.evictions;
+            }
+            while (idleCount_ > options_.maxIdle && evictOldest(evicted));
+        }
+        else if (client) {
+            evicted.emplace_back(std::move(client));
+        }
+
+        // evictOldest() may have erased the entry already.
+        auto it = hosts_.find(key);
+        if (it != hosts_.end() && it->second.idle.empty() && it->second.leased == 0)
+            hosts_.erase(it);
+    }
+    released_.notify_all();
+}
+
+void ConnectionPool::evictExpired(std::chrono::steady_clock::time_point now, std::deque<ClientPtr>& evicted)
+{
+    for (auto it = hosts_.begin(); it != hosts_.end();) {
+        auto& idle = it->second.idle;
+        while (!idle.empty() && now - idle.front().since >= options_.idleTimeout) {
+            evicted.emplace_back(std::move(idle.front().client));
+            idle.pop_front();
+            --idleCount_;
+            ++stats_.evictions;
+        }
+        if (idle.empty() && it->second.leased == 0)
+            it = hosts_.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool ConnectionPool::evictOldest(std::deque<ClientPtr>& evicted)
+{
+    auto oldest = hosts_.end();
+    for (auto it = hosts_.begin(); it != hosts_.end(); ++it) {
+        if (it->second.idle.empty())
+            continue;
+        if (oldest == hosts_.end() || it->second.idle.front().since < oldest->second.idle.front().since)
+            oldest = it;
+    }
+    if (oldest == hosts_.end())
+        return false;
+
+    auto& host = oldest->second;
+    evicted.emplace_back(std::move(host.idle.front().client));
+    host.idle.pop_front();
+    --idleCount_;
+    ++stats_.evictions;
+    if (host.idle.empty() && host.leased == 0)
+        hosts_.erase(oldest);
+    return true;
+}
+
+void ConnectionPool::clear()
+{
+    std::deque<ClientPtr> evicted;
+    {
+        std::lock_guard lock(mutex_);
+        for (auto it = hosts_.begin(); it != hosts_.end();) {
+            for (auto& idle : it->second.idle) {
+                evicted.emplace_back(std::move(idle.client));
+                ++stats_.evictions;
+            }
+            idleCount_ -= it->second.idle.size();
+            it->second.idle.clear();
+            if (it->second.leased == 0)
+                it = hosts_.erase(it);
+            else
+                ++it;
+        }
+    }
+    released_.notify_all();
+}
+
+ConnectionPool::Stats ConnectionPool::stats() const
+{
+    std::lock_guard lock(mutex_);
+    auto result = stats_;
+    result.hosts = hosts_.size();
+    return result;
+}
+
+}
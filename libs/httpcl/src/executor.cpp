@@ -0,0 +1,247 @@
+#include "executor.hpp"
+#include "env.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace httpcl
+{
+
+namespace
+{
+
+thread_local bool isWorker = false;
+
+}
+
+ThreadPool::ThreadPool(std::size_t threads, std::size_t maxQueued)
+    : maxQueued_(std::max<std::size_t>(maxQueued, 1))
+{
+    threads = std::max<std::size_t>(threads, 1);
+    workers_.reserve(threads);
+    for (auto i = 0u; i < threads; ++i)
+        workers_.emplace_back([this]{ work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    hasTask_.notify_all();
+    hasSpace_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    // Intentionally leaked, so that process exit does not
+    // wait for requests which are still in flight.
+    static auto* pool = new ThreadPool(
+        readEnvOption<std::size_t>("HTTP_WORKER_THREADS", std::max(4u, std::thread::hardware_concurrency())),
+        readEnvOption<std::size_t>("HTTP_WORKER_QUEUE", 1024));
+    return *pool;
+}
+
+void ThreadPool::post(std::function<void()> task, Priority priority)
+{
+    {
+        std::unique_lock lock(mutex_);
+        hasSpace_.wait(lock, [this]{ return stopping_ || queued_ < maxQueued_; });
+        if (stopping_)
+            throw std::runtime_error("[ThreadPool::post] The pool is shutting down.");
+        tasks_[static_cast<std::size_t>(priority)].emplace_back(std::move(task));
+        ++queued_;
+    }
+    hasTask_.notify_one();
+}
+
+bool ThreadPool::tryPost(std::function<void()> task, Priority priority)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (stopping_ || queued_ >= maxQueued_)
+            return false;
+        tasks_[static_cast<std::size_t>(priority)].emplace_back(std::move(task));
+        ++queued_;
+    }
+    hasTask_.notify_one();
+    return true;
+}
+
+bool ThreadPool::isWorkerThread()
+{
+    return isWorker;
+}
+
+void ThreadPool::work()
+{
+    isWorker = true;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            hasTask_.wait(lock, [this]{ return stopping_ || queued_ > 0; });
+            if (queued_ == 0)
+                return;
+            auto queue = std::find_if(tasks_.rbegin(), tasks_.rend(), [](auto const& q) { return !q.empty(); });
+            task = std::move(queue->front());
+            queue->pop_front();
+            --queued_;
+        }
+        hasSpace_.notify_one();
+
+        try {
+            task();
+        }
+        catch (std::exception const& e) {
+            log().error("[ThreadPool] Uncaught exception in worker task: {}", e.what());
+        }
+    }
+}
+
+Timer::ScopedTask& Timer::ScopedTask::operator=(ScopedTask&& other) noexcept
+{
+    if (this != &other) {
+        if (timer)
+            timer->cancel(id);
+        timer = other.timer;
+        id = other.id;
+        other.timer = nullptr;
+    }
+    return *this;
+}
+
+Timer::Timer()
+    : thread_([this]{ run(); })
+{}
+
+Timer::~Timer()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+Timer& Timer::shared()
+{
+    // Intentionally leaked, see ThreadPool::shared().
+    static auto* timer = new Timer();
+    return *timer;
+}
+
+Timer::TaskId Timer::schedule(Clock::duration delay, std::function<void()> task)
+{
+    TaskId id;
+    {
+        std::lock_guard lock(mutex_);
+        id = nextId_++;
+        entries_.emplace(id, Entry{std::move(task), Clock::duration::zero()});
+        queue_.emplace(Clock::now() + delay, id);
+    }
+    changed_.notify_one();
+    return id;
+}
+
+Timer::TaskId Timer::scheduleEvery(Clock::duration interval, std::function<void()> task)
+{
+    TaskId id;
+    {
+        std::lock_guard lock(mutex_);
+        id = nextId_++;
+        entries_.emplace(id, Entry{std::move(task), interval});
+        queue_.emplace(Clock::now() + interval, id);
+    }
+    changed_.notify_one();
+    return id;
+}
+
+void Timer::cancel(TaskId id)
+{
+    std::lock_guard lock(mutex_);
+    // The queue entry is skipped once it comes due.
+    entries_.erase(id);
+}
+
+void Timer::run()
+{
+    std::unique_lock lock(mutex_);
+    while (!stopping_) {
+        if (queue_.empty()) {
+            changed_.wait(lock);
+            continue;
+        }
+
+        auto next = queue_.begin();
+        if (Clock::now() < next->first) {
+            changed_.wait_until(lock, next->first);
+            continue;
+        }
+
+        auto id = next->second;
+        queue_.erase(next);
+        auto entry = entries_.find(id);
+        if (entry == entries_.end())
+            continue;
+
+        auto task = entry->second.task;
+        if (entry->second.interval > Clock::duration::zero())
+            queue_.emplace(Clock::now() + entry->second.interval, id);
+        else
+            entries_.erase(entry);
+
+        lock.unlock();
+        try {
+            task();
+        }
+        catch (std::exception const& e) {
+            log().error("[Timer] Uncaught exception in timer task: {}", e.what());
+        }
+        lock.lock();
+    }
+}
+
+ExecutionPolicy executionPolicyFromEnv()
+{
+    if (auto str = std::getenv("HTTP_EXECUTION_POLICY")) {
+        std::string value(str);
+        for (auto& ch : value)
+            ch = std::tolower(ch);
+        if (value == "pool")
+            return ExecutionPolicy::WorkerPool;
+        if (value != "inline")
+            log().warn("Could not parse value of HTTP_EXECUTION_POLICY: '{}'.", str);
+    }
+    return ExecutionPolicy::Inline;
+}
+
+void execute(ExecutionPolicy policy,
+             std::string const& debugContext,
+             std::function<void()> const& task,
+             Priority priority)
+{
+    Timer::ScopedTask waitLog;
+    if (log().should_log(spdlog::level::debug)) {
+        auto& timer = Timer::shared();
+        waitLog = {timer, timer.scheduleEvery(std::chrono::seconds(1), [debugContext]{
+            log().debug("{} Waiting for response ...", debugContext);
+        })};
+    }
+
+    if (policy == ExecutionPolicy::Inline || ThreadPool::isWorkerThread()) {
+        task();
+        return;
+    }
+
+    // The caller blocks until the task is done, so it may capture by reference.
+    ThreadPool::shared().submit([&task]{ task(); }, priority).get();
+}
+
+}
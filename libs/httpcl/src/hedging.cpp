@@ -0,0 +1,87 @@
+#include "hedging.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace httpcl
+{
+
+LatencyWindow::LatencyWindow(std::size_t capacity)
+{
+    samples_.reserve(std::max<std::size_t>(capacity, 1));
+}
+
+void LatencyWindow::add(std::chrono::microseconds latency)
+{
+    std::lock_guard lock(mutex_);
+    if (samples_.size() < samples_.capacity())
+        samples_.push_back(latency);
+    else
+        samples_[next_] = latency;
+    next_ = (next_ + 1) % samples_.capacity();
+}
+
+std::optional<std::chrono::microseconds> LatencyWindow::percentile(double p, std::size_t minSamples) const
+{
+    std::vector<std::chrono::microseconds> sorted;
+    {
+        std::lock_guard lock(mutex_);
+        if (samples_.empty() || samples_.size() < minSamples)
+            return {};
+        sorted = samples_;
+    }
+
+    auto rank = static_cast<std::size_t>(std::ceil(std::clamp(p, 0., 1.) * sorted.size()));
+    auto nth = sorted.begin() + (rank > 0 ? rank - 1 : 0);
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+}
+
+std::size_t LatencyWindow::size() const
+{
+    std::lock_guard lock(mutex_);
+    return samples_.size();
+}
+
+std::optional<std::chrono::microseconds> HedgePolicy::hedgeDelay(LatencyWindow const& latencies) const
+{
+    if (maxHedges == 0)
+        return {};
+    if (delay)
+        return std::chrono::duration_cast<std::chrono::microseconds>(*delay);
+    return latencies.percentile(percentile, minSamples);
+}
+
+}
+
+namespace YAML
+{
+
+Node convert<httpcl::HedgePolicy>::encode(httpcl::HedgePolicy const& policy)
+{
+    Node node;
+    if (policy.delay)
+        node["delay-ms"] = policy.delay->count();
+    node["percentile"] = policy.percentile;
+    node["min-samples"] = policy.minSamples;
+    node["max-hedges"] = policy.maxHedges;
+    return node;
+}
+
+bool convert<httpcl::HedgePolicy>::decode(Node const& node, httpcl::HedgePolicy& policy)
+{
+    if (!node.IsMap())
+        return false;
+
+    if (auto v = node["delay-ms"])
+        policy.delay = std::chrono::milliseconds(v.as<int64_t>());
+    if (auto v = node["percentile"])
+        policy.percentile = v.as<double>();
+    if (auto v = node["min-samples"])
+        policy.minSamples = v.as<uint32_t>();
+    if (auto v = node["max-hedges"])
+        policy.maxHedges = v.as<uint32_t>();
+    return true;
+}
+
+}
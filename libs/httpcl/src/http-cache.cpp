@@ -0,0 +1,673 @@
+#include "http-cache.hpp"
+#include "env.hpp"
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace httpcl
+{
+
+namespace
+{
+
+using Clock = std::chrono::system_clock;
+
+/** Estimated bookkeeping cost of an entry, besides key and response. */
+constexpr std::size_t entryOverhead = 128;
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+        std::equal(a.begin(), a.end(), b.begin(), [](char l, char r) {
+            return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+        });
+}
+
+std::string_view trim(std::string_view str)
+{
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front())))
+        str.remove_prefix(1);
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back())))
+        str.remove_suffix(1);
+    return str;
+}
+
+std::string header(Headers const& headers, std::string_view name)
+{
+    for (auto const& [key, value] : headers) {
+        if (equalsIgnoreCase(key, name))
+            return value;
+    }
+    return {};
+}
+
+void eraseHeader(Headers& headers, std::string_view name)
+{
+    for (auto it = headers.begin(); it != headers.end();) {
+        if (equalsIgnoreCase(it->first, name))
+            it = headers.erase(it);
+        else
+            ++it;
+    }
+}
+
+struct CacheControl
+{
+    bool noStore = false;
+    bool noCache = false;
+    std::optional<std::chrono::seconds> maxAge;
+
+    explicit CacheControl(Headers const& headers)
+    {
+        for (auto const& [key, value] : headers) {
+            if (!equalsIgnoreCase(key, "Cache-Control"))
+                continue;
+            std::string_view directives = value;
+            while (!directives.empty()) {
+                auto end = std::min(directives.find(','), directives.size());
+                auto directive = trim(directives.substr(0, end));
+                directives.remove_prefix(std::min(end + 1, directives.size()));
+
+                auto eq = std::min(directive.find('='), directive.size());
+                auto name = trim(directive.substr(0, eq));
+                if (equalsIgnoreCase(name, "no-store"))
+                    noStore = true;
+                else if (equalsIgnoreCase(name, "no-cache"))
+                    noCache = true;
+                else if (equalsIgnoreCase(name, "max-age") && eq < directive.size())
+                    maxAge = seconds(directive.substr(eq + 1));
+            }
+        }
+    }
+
+    static std::optional<std::chrono::seconds> seconds(std::string_view str)
+    {
+        str = trim(str);
+        if (str.size() >= 2 && str.front() == '"' && str.back() == '"')
+            str = str.substr(1, str.size() - 2);
+        try {
+            return std::chrono::seconds(std::max(0ll, std::stoll(std::string(str))));
+        }
+        catch (std::exception&) {
+            return {};
+        }
+    }
+};
+
+/**
+ * Point in time at which a response with these headers becomes
+ * stale, or nothing if the response must not be stored.
+ */
+std::optional<Clock::time_point> expiry(Headers const& headers, Clock::time_point now)
+{
+    CacheControl cacheControl(headers);
+    if (cacheControl.noStore || trim(header(headers, "Vary")) == "*")
+        return {};
+
+    auto lifetime = std::chrono::seconds(0);
+    if (cacheControl.maxAge && !cacheControl.noCache) {
+        auto age = CacheControl::seconds(header(headers, "Age")).value_or(std::chrono::seconds(0));
+        lifetime = std::max(*cacheControl.maxAge - age, std::chrono::seconds(0));
+    }
+
+    // Without a lifetime, the response is only worth keeping for revalidation.
+    bool validated = !header(headers, "ETag").empty() || !header(headers, "Last-Modified").empty();
+    if (lifetime.count() == 0 && !validated)
+        return {};
+    return now + lifetime;
+}
+
+/** Hex-encoded SHA-256 of `str`. */
+std::string sha256(std::string const& str)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+    EVP_Digest(str.data(), str.size(), digest, &size, EVP_sha256(), nullptr);
+
+    static constexpr char hex[] = "0123456789abcdef";
+    std::string result;
+    for (auto i = 0u; i < size; ++i) {
+        result += hex[digest[i] >> 4];
+        result += hex[digest[i] & 0xf];
+    }
+    return result;
+}
+
+/**
+ * Stable stand-in for the rotating bearer token of an OAuth2 config,
+ * so that cached responses stay valid when the token is refreshed.
+ */
+std::string oauth2Identity(Config::OAuth2 const& oauth2)
+{
+    std::string identity = "oauth2";
+    for (auto const* field : {&oauth2.clientId, &oauth2.audience, &oauth2.tokenUrlOverride}) {
+        identity += '\0';
+        identity += *field;
+    }
+    for (auto const& scope : oauth2.scopesOverride) {
+        identity += '\0';
+        identity += scope;
+    }
+    return identity;
+}
+
+/**
+ * The URI, followed by a digest of the query parameters, headers, cookies
+ * and credentials of the config. Keys are written to shared cache
+ * directories, so the values, which may be secrets, are only hashed.
+ */
+std::string cacheKey(std::string const& uri, Config const& config)
+{
+    std::string fields;
+    auto append = [&fields](char kind, std::string const& name, std::string const& value) {
+        fields += '\0';
+        fields += kind;
+        fields += name;
+        fields += '=';
+        fields += value;
+    };
+    for (auto const& [name, value] : config.query)
+        append('q', name, value);
+    for (auto const& [name, value] : config.headers) {
+        if (config.oauth2 && equalsIgnoreCase(name, "Authorization"))
+            append('h', name, oauth2Identity(*config.oauth2));
+        else
+            append('h', name, value);
+    }
+    for (auto const& [name, value] : config.cookies)
+        append('c', name, value);
+    if (config.auth)
+        append('a', config.auth->user, {});
+    if (config.apiKey)
+        append('k', {}, *config.apiKey);
+
+    std::string key = uri;
+    key += '\0';
+    key += sha256(fields);
+    return key;
+}
+
+IHttpClient::Result toResult(CachedResponse response)
+{
+    return {response.status, std::move(response.content), std::move(response.headers)};
+}
+
+/** Tag at the start of DiskHttpCacheStore files, which also marks their format version. */
+constexpr uint64_t diskEntryMagic = 0x3130434857535a00ull;
+
+/**
+ * Binary layout of a DiskHttpCacheStore file. Numbers are stored in
+ * host byte order, as the directory is only shared on one host.
+ */
+struct DiskEntry
+{
+    std::string key;
+    CachedResponse response;
+    Clock::time_point stored;
+
+    std::string serialize() const
+    {
+        std::string data;
+        auto appendNumber = [&data](int64_t value) {
+            data.append(reinterpret_cast<char const*>(&value), sizeof(value));
+        };
+        auto appendString = [&](std::string const& value) {
+            appendNumber(static_cast<int64_t>(value.size()));
+            data += value;
+        };
+
+        appendNumber(static_cast<int64_t>(diskEntryMagic));
+        appendString(key);
+        appendNumber(response.status);
+        appendNumber(std::chrono::duration_cast<std::chrono::milliseconds>(response.expires.time_since_epoch()).count());
+        appendNumber(std::chrono::duration_cast<std::chrono::milliseconds>(stored.time_since_epoch()).count());
+        appendNumber(static_cast<int64_t>(response.headers.size()));
+        for (auto const& [name, value] : response.headers) {
+            appendString(name);
+            appendString(value);
+        }
+        appendString(response.content);
+        return data;
+    }
+
+    /** Returns nothing if `data` is truncated or not an entry. */
+    static std::optional<DiskEntry> parse(std::string_view data)
+    {
+        auto readNumber = [&data](int64_t& value) {
+            if (data.size() < sizeof(value))
+                return false;
+            std::memcpy(&value, data.data(), sizeof(value));
+            data.remove_prefix(sizeof(value));
+            return true;
+        };
+        auto readString = [&](std::string& value) {
+            int64_t size = 0;
+            if (!readNumber(size) || size < 0 || static_cast<uint64_t>(size) > data.size())
+                return false;
+            value = data.substr(0, size);
+            data.remove_prefix(size);
+            return true;
+        };
+
+        DiskEntry entry;
+        int64_t magic = 0, status = 0, expires = 0, stored = 0, headers = 0;
+        if (!readNumber(magic) || magic != static_cast<int64_t>(diskEntryMagic) ||
+            !readString(entry.key) || !readNumber(status) || !readNumber(expires) ||
+            !readNumber(stored) || !readNumber(headers))
+            return {};
+        entry.response.status = static_cast<int>(status);
+        entry.response.expires = Clock::time_point(std::chrono::milliseconds(expires));
+        entry.stored = Clock::time_point(std::chrono::milliseconds(stored));
+        for (auto i = 0; i < headers; ++i) {
+            std::string name, value;
+            if (!readString(name) || !readString(value))
+                return {};
+            entry.response.headers.emplace(std::move(name), std::move(value));
+        }
+        if (!readString(entry.response.content) || !data.empty())
+            return {};
+        return entry;
+    }
+};
+
+/** Suffix which keeps temporary files of concurrent writers apart. */
+std::string temporarySuffix()
+{
+    thread_local std::mt19937_64 random{std::random_device{}()};
+    return ".tmp" + std::to_string(random());
+}
+
+constexpr auto diskEntryExtension = ".entry";
+
+enum class DiskFileKind
+{
+    /** Not written by a DiskHttpCacheStore, so it is never touched. */
+    Foreign,
+    Entry,
+    Temporary
+};
+
+/**
+ * Entries are named `<sha256>.entry`, and their temporary files
+ * `<sha256>.entry.tmp<number>`.
+ */
+DiskFileKind diskFileKind(std::filesystem::path const& path)
+{
+    auto name = path.filename().string();
+    constexpr std::size_t hashSize = 64;
+    if (name.size() < hashSize || !std::all_of(name.begin(), name.begin() + hashSize, [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c)) || (c >= 'a' && c <= 'f');
+        }))
+        return DiskFileKind::Foreign;
+
+    std::string_view suffix(name);
+    suffix.remove_prefix(hashSize);
+    if (suffix == diskEntryExtension)
+        return DiskFileKind::Entry;
+
+    constexpr std::string_view temporaryExtension = ".entry.tmp";
+    if (suffix.size() > temporaryExtension.size() && suffix.substr(0, temporaryExtension.size()) == temporaryExtension &&
+        std::all_of(suffix.begin() + temporaryExtension.size(), suffix.end(), [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c));
+        }))
+        return DiskFileKind::Temporary;
+    return DiskFileKind::Foreign;
+}
+
+}
+
+MemoryHttpCacheStore::MemoryHttpCacheStore(std::size_t maxBytes)
+    : maxBytes_(maxBytes)
+{}
+
+std::optional<CachedResponse> MemoryHttpCacheStore::load(std::string const& key)
+{
+    std::lock_guard lock(mutex_);
+    auto found = index_.find(key);
+    if (found == index_.end())
+        return {};
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return found->second->response;
+}
+
+void MemoryHttpCacheStore::store(std::string const& key, CachedResponse const& response)
+{
+    auto bytes = 2 * key.size() + response.content.size() + entryOverhead;
+    for (auto const& [name, value] : response.headers)
+        bytes += name.size() + value.size();
+
+    std::lock_guard lock(mutex_);
+    if (auto found = index_.find(key); found != index_.end())
+        erase(found->second);
+    if (bytes > maxBytes_)
+        return;
+
+    while (!entries_.empty() && bytes_ + bytes > maxBytes_)
+        erase(std::prev(entries_.end()));
+
+    entries_.push_front({key, response, bytes});
+    index_.emplace(key, entries_.begin());
+    bytes_ += bytes;
+}
+
+void MemoryHttpCacheStore::erase(std::string const& key)
+{
+    std::lock_guard lock(mutex_);
+    if (auto found = index_.find(key); found != index_.end())
+        erase(found->second);
+}
+
+void MemoryHttpCacheStore::erase(std::list<Entry>::iterator entry)
+{
+    bytes_ -= entry->bytes;
+    index_.erase(entry->key);
+    entries_.erase(entry);
+}
+
+std::size_t MemoryHttpCacheStore::bytes() const
+{
+    std::lock_guard lock(mutex_);
+    return bytes_;
+}
+
+DiskHttpCacheStore::DiskHttpCacheStore(std::filesystem::path directory)
+    : DiskHttpCacheStore(std::move(directory), Options{})
+{}
+
+DiskHttpCacheStore::DiskHttpCacheStore(std::filesystem::path directory, Options options)
+    : directory_(std::move(directory))
+    , options_(options)
+{
+    std::filesystem::create_directories(directory_);
+    trim();
+}
+
+std::filesystem::path DiskHttpCacheStore::path(std::string const& key) const
+{
+    return directory_ / (sha256(key) + diskEntryExtension);
+}
+
+std::optional<CachedResponse> DiskHttpCacheStore::load(std::string const& key)
+{
+    auto file = path(key);
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+        return {};
+    std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    in.close();
+
+    auto entry = DiskEntry::parse(data);
+    if (!entry || entry->key != key)
+        return {};
+
+    std::error_code error;
+    if (Clock::now() - entry->stored > options_.ttl) {
+        std::filesystem::remove(file, error);
+        return {};
+    }
+    std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), error);
+    return std::move(entry->response);
+}
+
+void DiskHttpCacheStore::store(std::string const& key, CachedResponse const& response)
+{
+    auto data = DiskEntry{key, response, Clock::now()}.serialize();
+    if (data.size() > options_.maxBytes)
+        return;
+
+    auto file = path(key);
+    auto temporary = file;
+    temporary += temporarySuffix();
+    std::error_code error;
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            out.close();
+            log().warn("Could not write HTTP cache file {}.", temporary.string());
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, file, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+
+    if ((bytes_ += data.size()) > options_.maxBytes)
+        trim();
+}
+
+void DiskHttpCacheStore::erase(std::string const& key)
+{
+    std::error_code error;
+    std::filesystem::remove(path(key), error);
+}
+
+void DiskHttpCacheStore::trim()
+{
+    std::lock_guard lock(trimMutex_);
+
+    struct File {
+        std::filesystem::path path;
+        std::size_t size;
+        std::filesystem::file_time_type lastUsed;
+    };
+    std::vector<File> files;
+    std::size_t total = 0;
+
+    // Files are touched when they are used, so files which were not
+    // used for the TTL are expired. This includes stale temporary files.
+    // Other files in the directory are left alone.
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code error;
+    for (auto const& entry : std::filesystem::directory_iterator(directory_, error)) {
+        auto kind = diskFileKind(entry.path());
+        std::error_code entryError;
+        if (kind == DiskFileKind::Foreign || !entry.is_regular_file(entryError))
+            continue;
+        auto lastUsed = entry.last_write_time(entryError);
+        auto size = entry.file_size(entryError);
+        if (entryError)
+            continue;
+        if (now - lastUsed > options_.ttl) {
+            std::filesystem::remove(entry.path(), entryError);
+            continue;
+        }
+        if (kind != DiskFileKind::Entry)
+            continue;
+        files.push_back({entry.path(), size, lastUsed});
+        total += size;
+    }
+
+    if (total > options_.maxBytes) {
+        std::sort(files.begin(), files.end(), [](auto const& l, auto const& r) {
+            return l.lastUsed < r.lastUsed;
+        });
+        for (auto const& file : files) {
+            if (total <= options_.maxBytes / 4 * 3)
+                break;
+            std::filesystem::remove(file.path, error);
+            total -= file.size;
+        }
+    }
+    bytes_ = total;
+}
+
+TieredHttpCacheStore::TieredHttpCacheStore(std::shared_ptr<HttpCacheStore> front,
+                                           std::shared_ptr<HttpCacheStore> back)
+    : front_(std::move(front))
+    , back_(std::move(back))
+{}
+
+std::optional<CachedResponse> TieredHttpCacheStore::load(std::string const& key)
+{
+    if (auto response = front_->load(key))
+        return response;
+    auto response = back_->load(key);
+    if (response)
+        front_->store(key, *response);
+    return response;
+}
+
+void TieredHttpCacheStore::store(std::string const& key, CachedResponse const& response)
+{
+    front_->store(key, response);
+    back_->store(key, response);
+}
+
+void TieredHttpCacheStore::erase(std::string const& key)
+{
+    front_->erase(key);
+    back_->erase(key);
+}
+
+CachingHttpClient::CachingHttpClient(std::unique_ptr<IHttpClient> client,
+                                     std::shared_ptr<HttpCacheStore> store)
+    : client_(std::move(client))
+    , store_(std::move(store))
+{}
+
+std::unique_ptr<IHttpClient> CachingHttpClient::wrapFromEnv(std::unique_ptr<IHttpClient> client)
+{
+    static auto store = []() -> std::shared_ptr<HttpCacheStore> {
+        std::shared_ptr<HttpCacheStore> memory;
+        auto maxBytes = readEnvOption<std::size_t>("HTTP_CACHE_SIZE", 0);
+        if (maxBytes)
+            memory = std::make_shared<MemoryHttpCacheStore>(maxBytes);
+
+        std::shared_ptr<HttpCacheStore> disk;
+        if (auto dir = std::getenv("HTTP_CACHE_DIR"); dir && *dir) {
+            DiskHttpCacheStore::Options options;
+            options.maxBytes = readEnvOption("HTTP_CACHE_DIR_SIZE", options.maxBytes);
+            options.ttl = std::chrono::seconds(readEnvOption("HTTP_CACHE_DIR_TTL", options.ttl.count()));
+            try {
+                disk = std::make_shared<DiskHttpCacheStore>(dir, options);
+            }
+            catch (std::exception& e) {
+                log().error("Could not use HTTP cache directory {}: {}", dir, e.what());
+            }
+        }
+
+        if (memory && disk)
+            return std::make_shared<TieredHttpCacheStore>(memory, disk);
+        return memory ? memory : disk;
+    }();
+
+    if (!store)
+        return client;
+    return std::make_unique<CachingHttpClient>(std::move(client), store);
+}
+
+CachingHttpClient::Stats CachingHttpClient::stats() const
+{
+    return {hits_, revalidations_, misses_};
+}
+
+IHttpClient::Result CachingHttpClient::get(const std::string& uri,
+                                           const Config& config)
+{
+    // Conditional requests of the caller are theirs to handle.
+    if (!header(config.headers, "If-None-Match").empty() || !header(config.headers, "If-Modified-Since").empty())
+        return client_->get(uri, config);
+
+    auto key = cacheKey(uri, config);
+    auto now = Clock::now();
+    auto cached = store_->load(key);
+    if (cached && now < cached->expires) {
+        ++hits_;
+        log().debug("  ... returning cached response for {}.", uri);
+        return toResult(std::move(*cached));
+    }
+
+    std::optional<Config> conditional;
+    if (cached) {
+        auto etag = header(cached->headers, "ETag");
+        auto lastModified = header(cached->headers, "Last-Modified");
+        if (!etag.empty() || !lastModified.empty()) {
+            conditional = config;
+            if (!etag.empty())
+                conditional->headers.emplace("If-None-Match", etag);
+            if (!lastModified.empty())
+                conditional->headers.emplace("If-Modified-Since", lastModified);
+        }
+    }
+
+    auto result = client_->get(uri, conditional ? *conditional : config);
+    if (result.status == 304 && conditional) {
+        ++revalidations_;
+        log().debug("  ... cached response for {} is still valid.", uri);
+
+        // The headers of a 304 replace the stored ones.
+        for (auto const& [name, value] : result.headers)
+            eraseHeader(cached->headers, name);
+        cached->headers.insert(result.headers.begin(), result.headers.end());
+        if (auto expires = expiry(cached->headers, now)) {
+            eraseHeader(cached->headers, "Age");
+            cached->expires = *expires;
+            store_->store(key, *cached);
+        }
+        else
+            store_->erase(key);
+        return toResult(std::move(*cached));
+    }
+
+    ++misses_;
+    if (result.status == 200) {
+        if (auto expires = expiry(result.headers, now)) {
+            CachedResponse response{result.status, result.content, result.headers, *expires};
+            eraseHeader(response.headers, "Age");
+            store_->store(key, response);
+        }
+        else if (cached)
+            store_->erase(key);
+    }
+    return result;
+}
+
+IHttpClient::Result CachingHttpClient::post(const std::string& uri,
+                                            const OptionalBodyAndContentType& body,
+                                            const Config& config)
+{
+    return invalidate(client_->post(uri, body, config), uri, config);
+}
+
+IHttpClient::Result CachingHttpClient::put(const std::string& uri,
+                                           const OptionalBodyAndContentType& body,
+                                           const Config& config)
+{
+    return invalidate(client_->put(uri, body, config), uri, config);
+}
+
+IHttpClient::Result CachingHttpClient::del(const std::string& uri,
+                                           const OptionalBodyAndContentType& body,
+                                           const Config& config)
+{
+    return invalidate(client_->del(uri, body, config), uri, config);
+}
+
+IHttpClient::Result CachingHttpClient::patch(const std::string& uri,
+                                             const OptionalBodyAndContentType& body,
+                                             const Config& config)
+{
+    return invalidate(client_->patch(uri, body, config), uri, config);
+}
+
+IHttpClient::Result CachingHttpClient::invalidate(Result result,
+                                                  const std::string& uri,
+                                                  const Config& config)
+{
+    if (result.status >= 200 && result.status < 400)
+        store_->erase(cacheKey(uri, config));
+    return result;
+}
+
+}
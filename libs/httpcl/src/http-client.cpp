@@ -1,41 +1,285 @@
 #include "http-client.hpp"
 #include "uri.hpp"
+#include "connection-pool.hpp"
+#include "compression.hpp"
+#include "executor.hpp"
 
 #include <httplib.h>
 
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+
 namespace
 {
 
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char l, char r) {
+               return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+           });
+}
+
+/**
+ * Convert the httplib result, decoding the body if the server
+ * sent it with a supported Content-Encoding. A decoded body
+ * drops the Content-Encoding and Content-Length headers, which
+ * only describe the wire representation.
+ */
 httpcl::IHttpClient::Result makeResult(httplib::Result&& result)
 {
-    if (result)
-        return {result->status, std::move(result->body)};
-    return {0, {}};
+    if (!result)
+        return {0, {}};
+
+    auto decoded = false;
+    auto& body = result->body;
+    if (!body.empty()) {
+        if (auto encoding = httpcl::parseContentEncoding(result->get_header_value("Content-Encoding"))) {
+            httpcl::log().debug("  ... decoding {} response body ({} bytes).",
+                                httpcl::contentEncodingName(*encoding), body.size());
+            body = httpcl::decompress(body, *encoding);
+            decoded = true;
+        }
+    }
+
+    httpcl::Headers headers;
+    for (auto const& [name, value] : result->headers) {
+        if (decoded && (equalsIgnoreCase(name, "Content-Encoding") ||
+                        equalsIgnoreCase(name, "Content-Length")))
+            continue;
+        headers.emplace(name, value);
+    }
+    return {result->status, std::move(body), std::move(headers)};
 }
 
+/**
+ * Request body as sent over the wire: Compressed with the
+ * configured Content-Encoding if it is large enough, and if
+ * compression actually makes it smaller.
+ */
+struct EncodedBody
+{
+    EncodedBody(std::optional<httpcl::BodyAndContentType> const& body,
+                httpcl::Config const& config)
+    {
+        if (!body)
+            return;
+        data = &body->body;
+        contentType = body->contentType;
+
+        auto const& compression = config.compression;
+        if (!compression || !compression->request || body->body.size() < compression->minSize)
+            return;
+
+        auto encoded = httpcl::compress(body->body, *compression->request);
+        if (encoded.size() >= body->body.size())
+            return;
+
+        compressed = std::move(encoded);
+        data = &compressed;
+        headers.insert({"Content-Encoding", httpcl::contentEncodingName(*compression->request)});
+    }
+
+    EncodedBody(EncodedBody const&) = delete;
+
+    /**
+     * Stream the body from its buffer, as httplib
+     * would copy a string body into the request.
+     */
+    httplib::ContentProvider provider() const
+    {
+        return [data = data](size_t offset, size_t length, httplib::DataSink& sink) {
+            return sink.write(data->data() + offset, length);
+        };
+    }
+
+    std::string const* data = &compressed;
+    std::string contentType;
+    std::string compressed;
+    httplib::Headers headers;
+};
+
 void applyQuery(httpcl::URIComponents& uri, httpcl::Config const& config) {
     for (auto const& [key, value] : config.query)
         uri.addQuery(key, value);
 }
 
-auto makeClientAndApplyQuery(
-    httpcl::URIComponents& uri,
+std::string connectionKey(
+    std::string const& host,
+    httpcl::Config const& config,
+    bool sslCertStrict)
+{
+    auto key = host;
+    if (config.proxy)
+        key += "|proxy=" + config.proxy->user + "@" + config.proxy->host + ":" + std::to_string(config.proxy->port);
+    key += sslCertStrict ? "|ssl-strict" : "|ssl-lax";
+    return key;
+}
+
+/**
+ * Connect and read timeout: The time left until the call's
+ * deadline if there is one, HTTP_TIMEOUT otherwise.
+ */
+std::chrono::milliseconds requestTimeout(httpcl::Config const& config, time_t const& timeoutSecs)
+{
+    if (!config.deadline)
+        return std::chrono::seconds(timeoutSecs);
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        *config.deadline - std::chrono::steady_clock::now());
+    return std::max(remaining, std::chrono::milliseconds(1));
+}
+
+bool callExpired(httpcl::Config const& config)
+{
+    return (config.cancellation && config.cancellation->cancelled()) ||
+           (config.deadline && std::chrono::steady_clock::now() >= *config.deadline);
+}
+
+/**
+ * Stops the client of a request in flight when the call's deadline
+ * passes or its token is cancelled, as connect and read timeouts
+ * only bound single socket operations.
+ */
+class RequestStopper
+{
+public:
+    RequestStopper(httplib::Client& client, httpcl::Config const& config)
+        : token_(config.cancellation)
+    {
+        if (!config.deadline && !token_)
+            return;
+
+        state_ = std::make_shared<State>();
+        state_->client = &client;
+        if (config.deadline) {
+            auto& timer = httpcl::Timer::shared();
+            deadlineTask_ = {timer, timer.schedule(*config.deadline - std::chrono::steady_clock::now(),
+                                                   [state = state_]{ state->stop(); })};
+        }
+        if (token_)
+            subscription_ = token_->subscribe([state = state_]{ state->stop(); });
+    }
+
+    ~RequestStopper()
+    {
+        release();
+    }
+
+    /**
+     * Detach from the client. Returns true if it was stopped.
+     */
+    bool release()
+    {
+        if (!state_)
+            return false;
+        deadlineTask_ = {};
+        if (token_)
+            token_->unsubscribe(subscription_);
+
+        std::lock_guard lock(state_->mutex);
+        state_->client = nullptr;
+        return state_->stopped;
+    }
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        httplib::Client* client = nullptr;
+        bool stopped = false;
+
+        void stop()
+        {
+            std::lock_guard lock(mutex);
+            if (client) {
+                client->stop();
+                stopped = true;
+            }
+        }
+    };
+
+    std::shared_ptr<State> state_;
+    std::shared_ptr<httpcl::CancellationToken> token_;
+    httpcl::CancellationToken::CallbackId subscription_ = 0;
+    httpcl::Timer::ScopedTask deadlineTask_;
+};
+
+void configureClient(
+    httplib::Client& client,
     httpcl::Config const& config,
     time_t const& timeoutSecs,
     bool const& sslCertStrict)
 {
-    auto client = std::make_unique<httplib::Client>(uri.buildHost().c_str());
-    client->enable_server_certificate_verification(sslCertStrict);
-    client->set_connection_timeout(timeoutSecs);
-    client->set_read_timeout(timeoutSecs);
-    client->set_follow_location(true);
-    config.apply(*client);
+    auto timeout = requestTimeout(config, timeoutSecs);
+    client.enable_server_certificate_verification(sslCertStrict);
+    client.set_connection_timeout(timeout);
+    client.set_read_timeout(timeout);
+    client.set_follow_location(true);
+    client.set_keep_alive(true);
+    // Encoded responses are decoded in makeResult().
+    client.set_decompress(false);
+    config.apply(client);
+}
 
+/**
+ * Run a request on a pooled client for the URI's host. If a reused
+ * connection turns out to be stale (the server closed it while it was
+ * idle), the client is dropped and the request is repeated once on a
+ * fresh connection. Read errors are only retried for idempotent requests,
+ * since the server may already have processed the request.
+ *
+ * Requests whose deadline passed or which were cancelled fail
+ * with status 0, without being sent if possible.
+ */
+template <class _Fun>
+httpcl::IHttpClient::Result sendPooled(
+    httpcl::ConnectionPool& pool,
+    httpcl::URIComponents& uri,
+    httpcl::Config const& config,
+    time_t const& timeoutSecs,
+    bool const& sslCertStrict,
+    bool idempotent,
+    _Fun const& request)
+{
+    auto host = uri.buildHost();
     applyQuery(uri, config);
     if (httpcl::log().should_log(spdlog::level::debug)) {
         httpcl::log().debug("  ... full URI: {}", uri.build());
     }
-    return client;
+    auto path = uri.buildPath();
+    auto key = connectionKey(host, config, sslCertStrict);
+
+    for (auto attempt = 0;; ++attempt) {
+        if (callExpired(config)) {
+            httpcl::log().debug("  ... call to {} was cancelled or timed out.", host);
+            return {0, {}};
+        }
+
+        auto lease = pool.acquire(key, [&]{
+            return std::make_unique<httplib::Client>(host);
+        });
+        configureClient(lease.client(), config, timeoutSecs, sslCertStrict);
+
+        RequestStopper stopper(lease.client(), config);
+        auto result = request(lease.client(), path);
+        if (stopper.release()) {
+            // The connection was shut down, it must not be reused.
+            lease.discard();
+            return makeResult(std::move(result));
+        }
+        if (result)
+            return makeResult(std::move(result));
+
+        lease.discard();
+        auto error = result.error();
+        auto stale = lease.reused() && attempt == 0 &&
+            (error == httplib::Error::Write || (idempotent && error == httplib::Error::Read));
+        if (!stale)
+            return makeResult(std::move(result));
+
+        httpcl::log().debug("  ... pooled connection to {} is stale, reconnecting.", host);
+    }
 }
 
 }
@@ -45,7 +289,25 @@ namespace httpcl
 
 using Result = HttpLibHttpClient::Result;
 
-HttpLibHttpClient::HttpLibHttpClient() {
+std::string IHttpClient::Result::header(std::string_view name) const
+{
+    for (auto const& [key, value] : headers) {
+        if (key.size() == name.size() &&
+            std::equal(key.begin(), key.end(), name.begin(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+            }))
+            return value;
+    }
+    return {};
+}
+
+HttpLibHttpClient::HttpLibHttpClient()
+    : HttpLibHttpClient(ConnectionPool::instance())
+{}
+
+HttpLibHttpClient::HttpLibHttpClient(ConnectionPool& pool)
+    : pool_(pool)
+{
     if (auto timeoutStr = std::getenv("HTTP_TIMEOUT")) {
         try {
             timeoutSecs_ = std::stoll(timeoutStr);
@@ -62,9 +324,10 @@ Result HttpLibHttpClient::get(const std::string& uriStr,
                               const Config& config)
 {
     auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Get(uri.buildPath()));
+    return sendPooled(pool_, uri, config, timeoutSecs_, sslCertStrict_, true,
+        [&](httplib::Client& client, std::string const& path) {
+            return client.Get(path);
+        });
 }
 
 Result HttpLibHttpClient::post(const std::string& uriStr,
@@ -72,12 +335,18 @@ Result HttpLibHttpClient::post(const std::string& uriStr,
                                const Config& config)
 {
     auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Post(
-                uri.buildPath(),
-                body ? body->body : std::string(),
-                body ? body->contentType : std::string()));
+    EncodedBody encoded(body, config);
+    return sendPooled(pool_, uri, config, timeoutSecs_, sslCertStrict_, false,
+        [&](httplib::Client& client, std::string const& path) {
+            if (encoded.data->empty())
+                return client.Post(path, encoded.headers, *encoded.data, encoded.contentType);
+            return client.Post(
+                path,
+                encoded.headers,
+                encoded.data->size(),
+                encoded.provider(),
+                encoded.contentType);
+        });
 }
 
 Result HttpLibHttpClient::put(const std::string& uriStr,
@@ -85,12 +354,18 @@ Result HttpLibHttpClient::put(const std::string& uriStr,
                               const Config& config)
 {
     auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Put(
-                uri.buildPath(),
-                body ? body->body : std::string(),
-                body ? body->contentType : std::string()));
+    EncodedBody encoded(body, config);
+    return sendPooled(pool_, uri, config, timeoutSecs_, sslCertStrict_, true,
+        [&](httplib::Client& client, std::string const& path) {
+            if (encoded.data->empty())
+                return client.Put(path, encoded.headers, *encoded.data, encoded.contentType);
+            return client.Put(
+                path,
+                encoded.headers,
+                encoded.data->size(),
+                encoded.provider(),
+                encoded.contentType);
+        });
 }
 
 Result HttpLibHttpClient::del(const std::string& uriStr,
@@ -98,12 +373,15 @@ Result HttpLibHttpClient::del(const std::string& uriStr,
                               const Config& config)
 {
     auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Delete(
-                uri.buildPath(),
-                body ? body->body : std::string(),
-                body ? body->contentType : std::string()));
+    EncodedBody encoded(body, config);
+    return sendPooled(pool_, uri, config, timeoutSecs_, sslCertStrict_, true,
+        [&](httplib::Client& client, std::string const& path) {
+            return client.Delete(
+                path,
+                encoded.headers,
+                *encoded.data,
+                encoded.contentType);
+        });
 }
 
 Result HttpLibHttpClient::patch(const std::string& uriStr,
@@ -111,12 +389,18 @@ Result HttpLibHttpClient::patch(const std::string& uriStr,
                                 const Config& config)
 {
     auto uri = URIComponents::fromStrRfc3986(uriStr);
-    return makeResult(
-        makeClientAndApplyQuery(uri, config, timeoutSecs_, sslCertStrict_)
-            ->Patch(
-                uri.buildPath(),
-                body ? body->body : std::string(),
-                body ? body->contentType : std::string()));
+    EncodedBody encoded(body, config);
+    return sendPooled(pool_, uri, config, timeoutSecs_, sslCertStrict_, false,
+        [&](httplib::Client& client, std::string const& path) {
+            if (encoded.data->empty())
+                return client.Patch(path, encoded.headers, *encoded.data, encoded.contentType);
+            return client.Patch(
+                path,
+                encoded.headers,
+                encoded.data->size(),
+                encoded.provider(),
+                encoded.contentType);
+        });
 }
 
 Result MockHttpClient::get(const std::string& uri,
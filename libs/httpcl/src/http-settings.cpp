@@ -1,17 +1,30 @@
 #include "http-settings.hpp"
+#include "env.hpp"
 #include "log.hpp"
 
 #ifdef ZSWAG_KEYCHAIN_SUPPORT
 #include <keychain/keychain.h>
 #endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 #include <yaml-cpp/yaml.h>
 
 #include <cstdlib>
 #include <regex>
 #include <future>
+#include <condition_variable>
+#include <map>
 #include <fstream>
 #include <filesystem>
 #include <sstream>
+#include <unordered_map>
+#include <array>
+#include <thread>
+#include <algorithm>
+#include <string_view>
 #include <spdlog/spdlog.h>
 
 using namespace httpcl;
@@ -20,6 +33,210 @@ using namespace std::string_literals;
 static const std::chrono::minutes KEYCHAIN_TIMEOUT{1};
 static const char* KEYCHAIN_PACKAGE = "lib.openapi.zserio.client";
 
+namespace
+{
+
+/**
+ * Password store backed by the system keychain.
+ */
+struct SystemKeychain : secret::Keychain
+{
+    std::string getPassword(const std::string& service, const std::string& user) override
+    {
+#ifdef ZSWAG_KEYCHAIN_SUPPORT
+        keychain::Error error;
+        auto password = keychain::getPassword(KEYCHAIN_PACKAGE, service, user, error);
+        if (error)
+            throw std::runtime_error(error.message);
+        return password;
+#else
+        throw std::runtime_error("[secret::load] zswag was compiled with ZSWAG_KEYCHAIN_SUPPORT OFF.");
+#endif
+    }
+
+    void setPassword(const std::string& service, const std::string& user, const std::string& password) override
+    {
+#ifdef ZSWAG_KEYCHAIN_SUPPORT
+        keychain::Error error;
+        keychain::setPassword(KEYCHAIN_PACKAGE, service, user, password, error);
+        if (error)
+            throw std::runtime_error(error.message);
+#else
+        throw std::runtime_error("[secret::store] zswag was compiled with ZSWAG_KEYCHAIN_SUPPORT OFF.");
+#endif
+    }
+
+    bool deletePassword(const std::string& service, const std::string& user) override
+    {
+#ifdef ZSWAG_KEYCHAIN_SUPPORT
+        keychain::Error error;
+        keychain::deletePassword(KEYCHAIN_PACKAGE, service, user, error);
+        return !error;
+#else
+        throw std::runtime_error("[secret::remove] zswag was compiled with ZSWAG_KEYCHAIN_SUPPORT OFF.");
+#endif
+    }
+};
+
+/**
+ * In-memory cache for keychain passwords. Lookups only take a
+ * shared lock, so concurrent requests do not block each other.
+ * Keychain operations run on their own thread, so that callers
+ * can give up after KEYCHAIN_TIMEOUT.
+ */
+struct SecretCache
+{
+    struct Entry {
+        std::string password;
+        std::chrono::steady_clock::time_point expiresAt;
+    };
+
+    struct Query {
+        std::shared_ptr<std::promise<std::string>> promise;
+        std::shared_future<std::string> result;
+    };
+
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    // Keychain queries in flight, by key
+    std::unordered_map<std::string, Query> queries;
+    // Incremented by every write and by clear(). Queries which
+    // started before do not store their result.
+    uint64_t generation = 0;
+    std::shared_ptr<secret::Keychain> keychain = std::make_shared<SystemKeychain>();
+
+    static SecretCache& instance()
+    {
+        // Intentionally leaked, as keychain threads may outlive process exit.
+        static auto* cache = new SecretCache();
+        return *cache;
+    }
+
+    static std::string key(const std::string& service, const std::string& user)
+    {
+        return service + '\0' + user;
+    }
+
+    /**
+     * Read from HTTP_KEYCHAIN_CACHE_TTL on each use,
+     * so that changes apply after the next clear().
+     */
+    static std::chrono::seconds ttl()
+    {
+        return std::chrono::seconds(readEnvOption<int64_t>("HTTP_KEYCHAIN_CACHE_TTL", 300));
+    }
+
+    std::optional<std::string> get(const std::string& key)
+    {
+        std::shared_lock lock(mutex);
+        auto entry = entries.find(key);
+        if (entry == entries.end() || std::chrono::steady_clock::now() >= entry->second.expiresAt)
+            return {};
+        return entry->second.password;
+    }
+
+    /**
+     * Query the keychain for the password of `service` and `user`,
+     * or join the query for it which is already in flight.
+     */
+    std::shared_future<std::string> load(const std::string& service, const std::string& user)
+    {
+        auto cacheKey = key(service, user);
+        std::unique_lock lock(mutex);
+        if (auto query = queries.find(cacheKey); query != queries.end())
+            return query->second.result;
+
+        auto promise = std::make_shared<std::promise<std::string>>();
+        auto result = promise->get_future().share();
+        queries.emplace(cacheKey, Query{promise, result});
+
+        std::thread([this, cacheKey, service, user, promise, startGeneration = generation, keychain = keychain]() {
+            std::optional<std::string> password;
+            std::exception_ptr error;
+            try {
+                password = keychain->getPassword(service, user);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            {
+                std::unique_lock lock(mutex);
+                if (auto query = queries.find(cacheKey); query != queries.end() && query->second.promise == promise)
+                    queries.erase(query);
+                auto cacheTtl = ttl();
+                if (password && generation == startGeneration && cacheTtl.count() > 0)
+                    entries[cacheKey] = {*password, std::chrono::steady_clock::now() + cacheTtl};
+            }
+
+            if (password)
+                promise->set_value(*password);
+            else
+                promise->set_exception(error);
+        }).detach();
+        return result;
+    }
+
+    /**
+     * Run `write` against the keychain. The cached password for `key` is
+     * dropped before and after, so that loads which overlap the write
+     * neither return nor keep the old password afterwards.
+     */
+    template <class _Fun>
+    auto write(const std::string& cacheKey, _Fun write) -> std::future<decltype(write(*keychain))>
+    {
+        using Result = decltype(write(*keychain));
+        auto promise = std::make_shared<std::promise<Result>>();
+        auto result = promise->get_future();
+        auto store = invalidate(cacheKey);
+
+        std::thread([this, cacheKey, promise, write = std::move(write), store = std::move(store)]() {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    write(*store);
+                    invalidate(cacheKey);
+                    promise->set_value();
+                }
+                else {
+                    auto value = write(*store);
+                    invalidate(cacheKey);
+                    promise->set_value(std::move(value));
+                }
+            }
+            catch (...) {
+                invalidate(cacheKey);
+                promise->set_exception(std::current_exception());
+            }
+        }).detach();
+        return result;
+    }
+
+    /**
+     * Drop the cached password and the query in flight for `key`.
+     * Returns the current keychain.
+     */
+    std::shared_ptr<secret::Keychain> invalidate(const std::string& cacheKey)
+    {
+        std::unique_lock lock(mutex);
+        ++generation;
+        entries.erase(cacheKey);
+        queries.erase(cacheKey);
+        return keychain;
+    }
+
+    void clear(std::shared_ptr<secret::Keychain> newKeychain = {})
+    {
+        std::unique_lock lock(mutex);
+        ++generation;
+        entries.clear();
+        queries.clear();
+        if (newKeychain)
+            keychain = std::move(newKeychain);
+    }
+};
+
+}
+
 namespace YAML
 {
 
@@ -181,6 +398,30 @@ YAML::Node configToNode(Config const& config) {
     if (config.apiKey)
         result["api-key"] = *config.apiKey;
 
+    if (config.compression) {
+        YAML::Node compressionNode;
+        compressionNode["accept"] = config.compression->accept;
+        if (config.compression->request)
+            compressionNode["request"] = contentEncodingName(*config.compression->request);
+        compressionNode["min-size"] = config.compression->minSize;
+        result["compression"] = compressionNode;
+    }
+
+    if (config.retry)
+        result["retry"] = *config.retry;
+
+    if (config.circuitBreaker)
+        result["circuit-breaker"] = *config.circuitBreaker;
+
+    if (config.hedge)
+        result["hedge"] = *config.hedge;
+
+    if (config.idempotent)
+        result["idempotent"] = *config.idempotent;
+
+    if (config.cacheTtl)
+        result["cache-ttl"] = config.cacheTtl->count();
+
     if (config.oauth2) {
         YAML::Node oauth2Node;
         if (!config.oauth2->clientId.empty())
@@ -215,6 +456,9 @@ YAML::Node configToNode(Config const& config) {
             oauth2Node["tokenEndpointAuth"] = authNode;
         }
 
+        if (config.oauth2->refreshAfter)
+            oauth2Node["refreshAfter"] = *config.oauth2->refreshAfter;
+
         // Write useForSpecFetch only if non-default (false)
         if (!config.oauth2->useForSpecFetch) {
             oauth2Node["useForSpecFetch"] = false;
@@ -264,6 +508,36 @@ Config configFromNode(YAML::Node const& node)
     if (auto apiKey = node["api-key"])
         conf.apiKey = apiKey.as<std::string>();
 
+    if (auto compressionNode = node["compression"]) {
+        Config::Compression compression;
+        if (auto v = compressionNode["accept"])
+            compression.accept = v.as<bool>();
+        if (auto v = compressionNode["request"]) {
+            auto encoding = v.as<std::string>();
+            compression.request = parseContentEncoding(encoding);
+            if (!compression.request)
+                throw std::runtime_error("Unknown compression.request encoding: " + encoding);
+        }
+        if (auto v = compressionNode["min-size"])
+            compression.minSize = v.as<std::size_t>();
+        conf.compression = compression;
+    }
+
+    if (auto retry = node["retry"])
+        conf.retry = retry.as<RetryPolicy>();
+
+    if (auto circuitBreaker = node["circuit-breaker"])
+        conf.circuitBreaker = circuitBreaker.as<CircuitBreakerPolicy>();
+
+    if (auto hedge = node["hedge"])
+        conf.hedge = hedge.as<HedgePolicy>();
+
+    if (auto idempotent = node["idempotent"])
+        conf.idempotent = idempotent.as<bool>();
+
+    if (auto cacheTtl = node["cache-ttl"])
+        conf.cacheTtl = std::chrono::seconds(cacheTtl.as<int64_t>());
+
     if (auto oauth2Node = node["oauth2"]) {
         Config::OAuth2 oauth2;
         if (auto v = oauth2Node["clientId"])
@@ -311,6 +585,13 @@ Config configFromNode(YAML::Node const& node)
             oauth2.useForSpecFetch = useForSpecFetchNode.as<bool>();
         }
 
+        if (auto v = oauth2Node["refreshAfter"]) {
+            oauth2.refreshAfter = v.as<double>();
+            if (!(*oauth2.refreshAfter > 0. && *oauth2.refreshAfter <= 1.)) {
+                throw std::runtime_error("oauth2.refreshAfter must be greater than 0 and at most 1");
+            }
+        }
+
         conf.oauth2 = oauth2;
     }
 
@@ -318,35 +599,30 @@ Config configFromNode(YAML::Node const& node)
 }
 }
 
+void secret::setKeychain(std::shared_ptr<Keychain> keychain)
+{
+    SecretCache::instance().clear(keychain ? std::move(keychain) : std::make_shared<SystemKeychain>());
+}
+
 std::string secret::load(
         const std::string &service,
         const std::string &user)
 {
-#ifdef ZSWAG_KEYCHAIN_SUPPORT
-    log().debug("Loading secret (service={}, user={}) ...", service, user);
-    auto result = std::async(std::launch::async, [=]() {
-        keychain::Error error;
-        auto password = keychain::getPassword(
-                KEYCHAIN_PACKAGE,
-                service,
-                user,
-                error);
+    auto& cache = SecretCache::instance();
+    if (auto password = cache.get(SecretCache::key(service, user)))
+        return *password;
 
-        if (error)
-            throw std::runtime_error(error.message);
-        return password;
-    });
+    log().debug("Loading secret (service={}, user={}) ...", service, user);
+    auto result = cache.load(service, user);
 
     if (result.wait_for(KEYCHAIN_TIMEOUT) == std::future_status::timeout) {
         log().warn("  ... Keychain timed out.");
         return {};
     }
 
+    auto password = result.get();
     log().debug("  ...OK.");
-    return result.get();
-#else
-    throw std::runtime_error("[secret::load] zswag was compiled with ZSWAG_KEYCHAIN_SUPPORT OFF.");
-#endif
+    return password;
 }
 
 std::string secret::store(
@@ -354,7 +630,6 @@ std::string secret::store(
         const std::string &user,
         const std::string &password)
 {
-#ifdef ZSWAG_KEYCHAIN_SUPPORT
     auto randServiceId = []() {
         std::string id(12, '.');
         std::generate(id.begin(), id.end(), []() {
@@ -368,147 +643,358 @@ std::string secret::store(
                       : service;
 
     log().debug("Storing secret (service={}, user={}) ...", newService, user);
-
-    auto result = std::async(std::launch::async, [=]() {
-        keychain::Error error;
-        keychain::setPassword(KEYCHAIN_PACKAGE,
-                              newService,
-                              user,
-                              password,
-                              error);
-
-        if (error)
-            throw std::runtime_error(error.message);
-    });
+    auto result = SecretCache::instance().write(
+        SecretCache::key(newService, user),
+        [=](Keychain& keychain) { keychain.setPassword(newService, user, password); });
 
     if (result.wait_for(KEYCHAIN_TIMEOUT) == std::future_status::timeout) {
         log().warn("  ... Keychain timed out!");
         return {};
     }
 
+    result.get();
     log().debug("  ...OK.");
     return newService;
-#else
-    throw std::runtime_error("[secret::store] zswag was compiled with ZSWAG_KEYCHAIN_SUPPORT OFF.");
-#endif
 }
 
 bool secret::remove(
         const std::string &service,
         const std::string &user)
 {
-#ifdef ZSWAG_KEYCHAIN_SUPPORT
     log().debug("Deleting secret (service={}, user={}) ...", service, user);
-
-    auto result = std::async(std::launch::async, [=]() {
-        keychain::Error error;
-        keychain::deletePassword(KEYCHAIN_PACKAGE,
-                                 service,
-                                 user,
-                                 error);
-
-        return error;
-    });
+    auto result = SecretCache::instance().write(
+        SecretCache::key(service, user),
+        [=](Keychain& keychain) { return keychain.deletePassword(service, user); });
 
     if (result.wait_for(KEYCHAIN_TIMEOUT) == std::future_status::timeout) {
         log().warn("  ... Keychain timeout!");
         return false;
     }
 
+    auto removed = result.get();
     log().debug("  ...OK.");
-    return result.get();
-#else
-    throw std::runtime_error("[secret::remove] zswag was compiled with ZSWAG_KEYCHAIN_SUPPORT OFF.");
+    return removed;
+}
+
+void secret::clearCache()
+{
+    SecretCache::instance().clear();
+}
+
+namespace
+{
+
+/**
+ * Modification time of HTTP_SETTINGS_FILE, or the
+ * default value if it is not set or does not exist.
+ */
+std::filesystem::file_time_type settingsFileTime()
+{
+    auto cookieJar = std::getenv("HTTP_SETTINGS_FILE");
+    if (!cookieJar || strcmp(cookieJar, "") == 0)
+        return {};
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(cookieJar, error);
+    return error ? std::filesystem::file_time_type{} : time;
+}
+
+/**
+ * Live Settings instances, which are reloaded by
+ * updateTimestamp() and reloadModified().
+ */
+struct SettingsRegistry
+{
+    std::mutex mutex;
+    std::condition_variable idle;
+    /** Live instances, with their number of reloads in progress. */
+    std::map<Settings*, std::size_t> instances;
+
+    static SettingsRegistry& instance()
+    {
+        // Intentionally leaked, as the watcher thread may still use it on exit.
+        static auto* registry = new SettingsRegistry();
+        return *registry;
+    }
+
+    /**
+     * Call `load()` on each instance for which `outdated` returns true.
+     * Instances are loaded outside of the registry lock, so that parsing
+     * does not block the construction and destruction of others.
+     */
+    template <class _Pred>
+    void reload(_Pred const& outdated)
+    {
+        std::vector<Settings*> reloading;
+        {
+            std::lock_guard lock(mutex);
+            for (auto& [settings, reloads] : instances) {
+                ++reloads;
+                reloading.push_back(settings);
+            }
+        }
+
+        for (auto* settings : reloading) {
+            try {
+                if (outdated(*settings))
+                    settings->load();
+            }
+            catch (...) {
+                // If an exception occurred during load(), it was already
+                // logged in all likelihood.
+            }
+
+            std::lock_guard lock(mutex);
+            --instances[settings];
+            idle.notify_all();
+        }
+    }
+};
+
+#ifdef __linux__
+/**
+ * Watches the directory of HTTP_SETTINGS_FILE using inotify, and calls
+ * Settings::reloadModified when the file is written, replaced or removed.
+ * The directory is watched, as editors usually replace files by renaming.
+ */
+class SettingsFileWatcher
+{
+public:
+    static SettingsFileWatcher& instance()
+    {
+        // Intentionally leaked, the watcher thread runs until process exit.
+        static auto* watcher = new SettingsFileWatcher();
+        return *watcher;
+    }
+
+    void watch(std::filesystem::path const& file)
+    {
+        std::lock_guard lock(mutex_);
+        if (fd_ < 0 || file == file_)
+            return;
+
+        if (wd_ >= 0)
+            inotify_rm_watch(fd_, wd_);
+        file_ = file;
+        auto dir = file.parent_path().empty() ? std::filesystem::path(".") : file.parent_path();
+        wd_ = inotify_add_watch(fd_, dir.c_str(),
+                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+        if (wd_ < 0)
+            log().debug("Cannot watch '{}' for HTTP settings changes.", dir.string());
+    }
+
+private:
+    SettingsFileWatcher()
+        : fd_(inotify_init1(IN_CLOEXEC))
+    {
+        if (fd_ < 0) {
+            log().debug("inotify is not available, HTTP settings are not reloaded on change.");
+            return;
+        }
+        std::thread([this]{ run(); }).detach();
+    }
+
+    void run()
+    {
+        alignas(inotify_event) char buffer[4096];
+        for (;;) {
+            auto length = read(fd_, buffer, sizeof(buffer));
+            if (length <= 0) {
+                if (length < 0 && errno == EINTR)
+                    continue;
+                return;
+            }
+
+            auto changed = false;
+            {
+                std::lock_guard lock(mutex_);
+                for (auto pos = 0; pos < length;) {
+                    auto event = reinterpret_cast<inotify_event const*>(buffer + pos);
+                    if (event->wd == wd_ && event->len > 0 && file_.filename() == event->name)
+                        changed = true;
+                    pos += sizeof(inotify_event) + event->len;
+                }
+            }
+
+            if (changed)
+                Settings::reloadModified();
+        }
+    }
+
+    std::mutex mutex_;
+    int fd_ = -1;
+    int wd_ = -1;
+    std::filesystem::path file_;
+};
 #endif
+
 }
 
 Settings::Settings()
 {
     load();
+    std::lock_guard lock(SettingsRegistry::instance().mutex);
+    SettingsRegistry::instance().instances.emplace(this, 0);
+}
+
+Settings::~Settings()
+{
+    auto& registry = SettingsRegistry::instance();
+    std::unique_lock lock(registry.mutex);
+    registry.idle.wait(lock, [&]{ return registry.instances[this] == 0; });
+    registry.instances.erase(this);
 }
 
 std::atomic<std::chrono::steady_clock::time_point> Settings::lastUpdated{std::chrono::steady_clock::now()};
 
 void Settings::updateTimestamp(std::chrono::steady_clock::time_point time) {
     lastUpdated.store(time, std::memory_order_relaxed);
+
+    // Reload outdated instances here, so that lookups never parse.
+    auto fileTime = settingsFileTime();
+    auto fileChanged = false;
+    SettingsRegistry::instance().reload([&](Settings const& settings) {
+        if (settings.lastRead.load() >= time)
+            return false;
+        std::shared_lock settingsLock(settings.mutex);
+        fileChanged |= settings.fileTime_ != fileTime;
+        return true;
+    });
+
+    // Passwords are only re-read from the keychain if the file
+    // actually changed, as it may now refer to other entries.
+    if (fileChanged)
+        secret::clearCache();
 }
 
-void Settings::load()
+void Settings::reloadModified()
 {
-    std::unique_lock lock(mutex);
-    lastRead = std::chrono::steady_clock::now();
-    settings.clear();
+    auto fileTime = settingsFileTime();
+    auto fileChanged = false;
+    SettingsRegistry::instance().reload([&](Settings const& settings) {
+        // Waits for a store() in progress, which updates fileTime_.
+        std::shared_lock settingsLock(settings.mutex);
+        if (settings.fileTime_ == fileTime)
+            return false;
+        log().debug("HTTP settings file changed, reloading ...");
+        fileChanged = true;
+        return true;
+    });
 
-    auto cookieJar = std::getenv("HTTP_SETTINGS_FILE");
-    if (!cookieJar || strcmp(cookieJar, "") == 0) {
-        log().debug("HTTP_SETTINGS_FILE environment variable is empty.");
-        return;
-    }
+    if (fileChanged)
+        secret::clearCache();
+}
 
-    if (!std::filesystem::is_regular_file(cookieJar)) {
-        log().debug("The HTTP_SETTINGS_FILE path '{}' is not a file.", cookieJar);
-        return;
-    }
+void Settings::load()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto fileTime = settingsFileTime();
+    std::deque<Config> loadedSettings;
+    YAML::Node loadedDocument;
+
+    [&]{
+        auto cookieJar = std::getenv("HTTP_SETTINGS_FILE");
+        if (!cookieJar || strcmp(cookieJar, "") == 0) {
+            log().debug("HTTP_SETTINGS_FILE environment variable is empty.");
+            return;
+        }
 
-    try {
-        log().debug("Loading HTTP settings from '{}'...", cookieJar);
-        document = YAML::LoadFile(cookieJar);
-        YAML::Node httpSettingsNode;
-        uint32_t idx = 0;
+#ifdef __linux__
+        SettingsFileWatcher::instance().watch(std::filesystem::absolute(cookieJar));
+#endif
 
-        if (document.IsMap()) {
-            auto settingsNode = document["http-settings"];
-            if (!settingsNode.IsDefined()) {
-                log().debug("No 'http-settings' section found in the YAML file '{}'.", cookieJar);
-                return;
-            }
-            httpSettingsNode = settingsNode;
-        } else {
-            // Keep supporting the old format, where the root structure is a settings array.
-            httpSettingsNode = document;
+        if (!std::filesystem::is_regular_file(cookieJar)) {
+            log().debug("The HTTP_SETTINGS_FILE path '{}' is not a file.", cookieJar);
+            return;
         }
 
-        for (auto const& entry : httpSettingsNode.as<std::vector<YAML::Node>>()) {
-            settings.emplace_back(configFromNode(entry));
-            ++idx;
+        try {
+            log().debug("Loading HTTP settings from '{}'...", cookieJar);
+            loadedDocument = YAML::LoadFile(cookieJar);
+            YAML::Node httpSettingsNode;
+
+            if (loadedDocument.IsMap()) {
+                auto settingsNode = loadedDocument["http-settings"];
+                if (!settingsNode.IsDefined()) {
+                    log().debug("No 'http-settings' section found in the YAML file '{}'.", cookieJar);
+                    return;
+                }
+                httpSettingsNode = settingsNode;
+            } else {
+                // Keep supporting the old format, where the root structure is a settings array.
+                httpSettingsNode = loadedDocument;
+            }
+
+            for (auto const& entry : httpSettingsNode.as<std::vector<YAML::Node>>())
+                loadedSettings.emplace_back(configFromNode(entry));
+
+            log().debug("  ...Done.");
+        } catch (const YAML::BadFile& e) {
+            log().error("Failed to parse HTTP settings at '{}': {}", cookieJar, e.what());
+        } catch (const std::exception& e) {
+            log().error("Failed to read http-settings from '{}': {}", cookieJar, e.what());
         }
+    }();
 
-        log().debug("  ...Done.");
-    } catch (const YAML::BadFile& e) {
-        log().error("Failed to parse HTTP settings at '{}': {}", cookieJar, e.what());
-    } catch (const std::exception& e) {
-        log().error("Failed to read http-settings from '{}': {}", cookieJar, e.what());
+    auto snapshot = std::make_shared<Snapshot const>(loadedSettings);
+    {
+        std::unique_lock lock(mutex);
+        settings_ = std::move(loadedSettings);
+        document = loadedDocument;
+        lastRead = now;
+        fileTime_ = fileTime;
     }
+    std::atomic_store(&snapshot_, std::move(snapshot));
+}
+
+std::deque<Config> Settings::entries() const
+{
+    std::shared_lock lock(mutex);
+    return settings_;
+}
+
+void Settings::edit(std::function<void(std::deque<Config>&)> const& fun)
+{
+    std::unique_lock lock(mutex);
+    fun(settings_);
+    std::atomic_store(&snapshot_, std::make_shared<Snapshot const>(settings_));
 }
 
 void Settings::store()
 {
-    auto cookieJar = std::getenv("HTTP_SETTINGS_FILE");
-    if (!cookieJar) {
-        log().warn("HTTP_SETTINGS_FILE is not set, cannot save HTTP settings.");
-        return;
-    }
+    [this]{
+        auto cookieJar = std::getenv("HTTP_SETTINGS_FILE");
+        if (!cookieJar) {
+            log().warn("HTTP_SETTINGS_FILE is not set, cannot save HTTP settings.");
+            return;
+        }
 
-    try {
-        auto node = YAML::Node();
+        std::unique_lock lock(mutex);
+        try {
+            auto node = YAML::Node();
 
-        for (const auto& config : settings)
-            node.push_back(configToNode(config));
+            for (const auto& config : settings_)
+                node.push_back(configToNode(config));
 
-        if (document && document.IsMap()) {
-            document["http-settings"] = node;
-        }
-        else {
-            document = node;
+            if (document && document.IsMap()) {
+                document["http-settings"] = node;
+            }
+            else {
+                document = node;
+            }
+
+            log().debug("Saving HTTP settings to '{}'...", cookieJar);
+            {
+                std::ofstream os(cookieJar);
+                os << node;
+            }
+            log().debug("  ...Done.", cookieJar);
+        } catch (const std::exception& e) {
+            log().error("Failed to write http-settings to '{}': {}", cookieJar, e.what());
         }
 
-        log().debug("Saving HTTP settings to '{}'...", cookieJar);
-        std::ofstream os(cookieJar);
-        os << node;
-        log().debug("  ...Done.", cookieJar);
-    } catch (const std::exception& e) {
-        log().error("Failed to write http-settings to '{}': {}", cookieJar, e.what());
-    }
+        // Our own write must not trigger a reload by the file watcher.
+        fileTime_ = settingsFileTime();
+    }();
 }
 
 Config::Config(const std::string& yamlConf)
@@ -517,35 +1003,155 @@ Config::Config(const std::string& yamlConf)
     *this = configFromNode(parsedYaml);
 }
 
-Config Settings::operator[] (const std::string &url) const
+/**
+ * Scope entries are plain globs ('*' matches anything, and a match is a
+ * prefix match), so they are indexed by the literal text before their
+ * first '*' in a character trie. Only `url:` entries are matched using
+ * std::regex. Candidates are merged in their original order.
+ *
+ * Merged results are memoized per thread, so that lookups do not
+ * need any lock. The memo is keyed by the snapshot's unique id.
+ */
+struct Settings::Snapshot
 {
-    std::shared_lock lock(mutex);
-    if (lastRead < lastUpdated.load(std::memory_order_relaxed)) {
-        lock.unlock();
-        try {
-            const_cast<Settings*>(this)->load();
+    static constexpr std::size_t MAX_CACHED_URLS = 1024;
+
+    struct Glob {
+        std::uint32_t entry = 0;
+        /** Literal parts after the first '*', which must occur in order. */
+        std::vector<std::string> parts;
+    };
+
+    struct TrieNode {
+        std::vector<std::pair<char, std::uint32_t>> children;
+        std::vector<Glob> globs;  // Globs whose literal prefix ends here
+    };
+
+    static inline std::atomic<std::uint64_t> nextId{1};
+
+    std::uint64_t id = nextId++;
+    std::deque<Config> settings;
+    std::vector<TrieNode> trie{1};
+    std::vector<std::uint32_t> regexEntries;
+
+    explicit Snapshot(std::deque<Config> settingsCopy)
+        : settings(std::move(settingsCopy))
+    {
+        for (std::uint32_t i = 0; i < settings.size(); ++i) {
+            auto const& config = settings[i];
+            if (!config.scope || config.urlPatternString != convertToRegex(*config.scope)) {
+                regexEntries.push_back(i);
+                continue;
+            }
+
+            auto const& scope = *config.scope;
+            auto prefixEnd = std::min(scope.find('*'), scope.size());
+            auto node = 0u;
+            for (auto c : std::string_view(scope).substr(0, prefixEnd))
+                node = child(node, c);
+
+            Glob glob{i, {}};
+            for (auto pos = prefixEnd; pos < scope.size();) {
+                auto next = std::min(scope.find('*', pos + 1), scope.size());
+                if (next > pos + 1)
+                    glob.parts.emplace_back(scope.substr(pos + 1, next - pos - 1));
+                pos = next;
+            }
+            trie[node].globs.emplace_back(std::move(glob));
         }
-        catch (...) {
-            // If an exception occurred during load(), it was already
-            // logged in all likelihood.
+    }
+
+    std::uint32_t child(std::uint32_t node, char c)
+    {
+        for (auto const& [key, index] : trie[node].children)
+            if (key == c)
+                return index;
+        trie.emplace_back();
+        trie[node].children.emplace_back(c, static_cast<std::uint32_t>(trie.size() - 1));
+        return static_cast<std::uint32_t>(trie.size() - 1);
+    }
+
+    static bool matchParts(std::string_view rest, std::vector<std::string> const& parts)
+    {
+        // Leftmost matching is sufficient, as the glob has an implicit trailing '*'.
+        for (auto const& part : parts) {
+            auto pos = rest.find(part);
+            if (pos == std::string_view::npos)
+                return false;
+            rest.remove_prefix(pos + part.size());
         }
-        lock.lock();
+        return true;
     }
 
-    Config result;
-    for (auto const& config : settings)
+    Config merge(std::string const& url) const
     {
-        if (!std::regex_match(url, config.urlPattern))
-            continue;
-        result |= config;
+        std::vector<std::uint32_t> matches;
+        auto collect = [&](TrieNode const& node, std::size_t depth) {
+            for (auto const& glob : node.globs)
+                if (matchParts(std::string_view(url).substr(depth), glob.parts))
+                    matches.push_back(glob.entry);
+        };
+
+        auto node = 0u;
+        collect(trie[node], 0);
+        for (std::size_t depth = 0; depth < url.size(); ++depth) {
+            auto const& children = trie[node].children;
+            auto it = std::find_if(children.begin(), children.end(),
+                                   [c = url[depth]](auto const& kv) { return kv.first == c; });
+            if (it == children.end())
+                break;
+            node = it->second;
+            collect(trie[node], depth + 1);
+        }
+
+        for (auto entry : regexEntries)
+            if (std::regex_match(url, settings[entry].urlPattern))
+                matches.push_back(entry);
+
+        std::sort(matches.begin(), matches.end());
+        Config result;
+        for (auto entry : matches)
+            result |= settings[entry];
+        return result;
     }
-    return result;
+
+    Config lookup(std::string const& url) const
+    {
+        struct Memo {
+            std::uint64_t snapshotId = 0;
+            std::unordered_map<std::string, Config> configs;
+        };
+        // A few slots, as each OpenAPIClient has its own Settings.
+        thread_local std::array<Memo, 4> memos;
+        thread_local std::size_t nextSlot = 0;
+
+        auto memo = std::find_if(memos.begin(), memos.end(),
+                                 [this](auto const& m) { return m.snapshotId == id; });
+        if (memo == memos.end()) {
+            memo = memos.begin() + (nextSlot++ % memos.size());
+            memo->snapshotId = id;
+            memo->configs.clear();
+        }
+        else if (auto it = memo->configs.find(url); it != memo->configs.end())
+            return it->second;
+
+        auto result = merge(url);
+        if (memo->configs.size() >= MAX_CACHED_URLS)
+            memo->configs.clear();
+        memo->configs.emplace(url, result);
+        return result;
+    }
+};
+
+Config Settings::operator[] (const std::string &url) const
+{
+    return std::atomic_load(&snapshot_)->lookup(url);
 }
 
-Config& Settings::getOrCreateConfigScope(std::string_view const& scope)
+Config& Settings::getOrCreateConfigScope(std::deque<Config>& entries, std::string_view const& scope)
 {
     Config* config = nullptr;
-    for (auto& configCandidate : settings) {
+    for (auto& configCandidate : entries) {
         if (configCandidate.scope.has_value() && *configCandidate.scope == scope) {
             config = &configCandidate;
             break;
@@ -553,7 +1159,7 @@ Config& Settings::getOrCreateConfigScope(std::string_view const& scope)
     }
     if (!config) {
         std::string formatted_scope = fmt::format("scope: '{}'", scope);
-        config = &settings.emplace_back(formatted_scope);
+        config = &entries.emplace_back(formatted_scope);
     }
     return *config;
 }
@@ -583,6 +1189,10 @@ void Config::apply(httplib::Client &cl) const
             httplib::make_basic_authentication_header(auth->user, password));
     }
 
+    // Accepted response encodings, decoded by the HTTP client
+    if (compression && compression->accept && !httpLibHeaders.count("Accept-Encoding"))
+        httpLibHeaders.insert({"Accept-Encoding", "gzip, deflate"});
+
     // Proxy Settings
     if (proxy) {
         cl.set_proxy(proxy->host, proxy->port);
@@ -705,6 +1315,45 @@ std::string Config::toSafeString() const {
         ss << "\n";
     }
 
+    // Compression
+    if (compression) {
+        ss << "  - Compression: accept=" << (compression->accept ? "gzip, deflate" : "none");
+        if (compression->request)
+            ss << ", request=" << contentEncodingName(*compression->request)
+               << " (min-size " << compression->minSize << ")";
+        ss << "\n";
+    }
+
+    // Retry
+    if (retry) {
+        ss << "  - Retry: max-attempts=" << retry->maxAttempts
+           << ", backoff=" << retry->initialBackoff.count() << "-" << retry->maxBackoff.count() << "ms"
+           << ", failover=" << (retry->failover ? "true" : "false") << "\n";
+    }
+
+    // Circuit breaker
+    if (circuitBreaker) {
+        ss << "  - Circuit breaker: consecutive-failures=" << circuitBreaker->consecutiveFailures
+           << ", error-rate=" << circuitBreaker->errorRate
+           << ", open=" << circuitBreaker->openDuration.count() << "ms\n";
+    }
+
+    // Hedging
+    if (hedge) {
+        ss << "  - Hedge: delay=";
+        if (hedge->delay)
+            ss << hedge->delay->count() << "ms";
+        else
+            ss << "p" << hedge->percentile * 100.;
+        ss << ", max-hedges=" << hedge->maxHedges << "\n";
+    }
+    if (idempotent)
+        ss << "  - Idempotent: " << (*idempotent ? "true" : "false") << "\n";
+
+    // Response cache
+    if (cacheTtl)
+        ss << "  - Cache TTL: " << cacheTtl->count() << "s\n";
+
     std::string result = ss.str();
     if (result.empty())
         return "  (no auth configuration)\n";
@@ -721,6 +1370,22 @@ Config& Config::operator |= (Config const& other) {
         proxy = other.proxy;
     if (other.apiKey)
         apiKey = other.apiKey;
+    if (other.compression)
+        compression = other.compression;
+    if (other.retry)
+        retry = other.retry;
+    if (other.circuitBreaker)
+        circuitBreaker = other.circuitBreaker;
+    if (other.hedge)
+        hedge = other.hedge;
+    if (other.idempotent)
+        idempotent = other.idempotent;
+    if (other.cacheTtl)
+        cacheTtl = other.cacheTtl;
+    if (other.deadline && (!deadline || *other.deadline < *deadline))
+        deadline = other.deadline;
+    if (other.cancellation)
+        cancellation = other.cancellation;
     if (other.oauth2) {
         if (!oauth2)
             oauth2.emplace();
@@ -742,6 +1407,8 @@ Config& Config::operator |= (Config const& other) {
         oauth2->useForSpecFetch = other.oauth2->useForSpecFetch;
         if (other.oauth2->tokenEndpointAuth)
             oauth2->tokenEndpointAuth = other.oauth2->tokenEndpointAuth;
+        if (other.oauth2->refreshAfter)
+            oauth2->refreshAfter = other.oauth2->refreshAfter;
     }
     return *this;
 }
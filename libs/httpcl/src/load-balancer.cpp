@@ -0,0 +1,245 @@
+#include "load-balancer.hpp"
+#include "http-client.hpp"
+#include "env.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <random>
+
+namespace httpcl
+{
+
+namespace
+{
+
+/** Weight of the newest sample in the latency average. */
+constexpr double ewmaWeight = .3;
+
+/** Latency sample in microseconds which is recorded for a failed request. */
+constexpr double failurePenalty = 5'000'000.;
+
+std::mt19937& randomEngine()
+{
+    thread_local std::mt19937 engine{std::random_device{}()};
+    return engine;
+}
+
+}
+
+LoadBalancing loadBalancingFromEnv()
+{
+    if (auto str = std::getenv("HTTP_LOAD_BALANCING")) {
+        std::string value(str);
+        for (auto& ch : value)
+            ch = std::tolower(ch);
+        if (value == "round-robin")
+            return LoadBalancing::RoundRobin;
+        if (value == "least-outstanding")
+            return LoadBalancing::LeastOutstanding;
+        if (value == "ewma")
+            return LoadBalancing::Ewma;
+        if (value != "off")
+            log().warn("Could not parse value of HTTP_LOAD_BALANCING: '{}'.", str);
+    }
+    return LoadBalancing::Off;
+}
+
+std::chrono::seconds probeIntervalFromEnv()
+{
+    return std::chrono::seconds(readEnvOption<int64_t>("HTTP_PROBE_INTERVAL", 10));
+}
+
+LoadBalancer::LoadBalancer(std::size_t servers, LoadBalancing mode, std::size_t preferred)
+    : mode_(mode)
+    , preferred_(preferred)
+{
+    servers_.reserve(servers);
+    for (auto i = 0u; i < servers; ++i)
+        servers_.emplace_back(std::make_unique<Server>());
+}
+
+std::size_t LoadBalancer::pick()
+{
+    auto const count = servers_.size();
+    if (mode_ == LoadBalancing::Off || count <= 1)
+        return preferred_;
+
+    auto start = next_++;
+    if ((start + 1) % trialEvery == 0) {
+        for (auto i = 0u; i < count; ++i) {
+            auto server = (start + i) % count;
+            if (!healthy(server))
+                return server;
+        }
+    }
+
+    switch (mode_) {
+    case LoadBalancing::RoundRobin:
+        for (auto i = 0u; i < count; ++i) {
+            auto server = (start + i) % count;
+            if (healthy(server))
+                return server;
+        }
+        return start % count;
+
+    case LoadBalancing::LeastOutstanding: {
+        // Start at a rotating offset, so that ties are spread evenly.
+        auto best = start % count;
+        auto bestHealthy = healthy(best);
+        for (auto i = 1u; i < count; ++i) {
+            auto server = (start + i) % count;
+            auto serverHealthy = healthy(server);
+            if (bestHealthy && !serverHealthy)
+                continue;
+            if ((serverHealthy && !bestHealthy) ||
+                servers_[server]->outstanding < servers_[best]->outstanding) {
+                best = server;
+                bestHealthy = serverHealthy;
+            }
+        }
+        return best;
+    }
+
+    case LoadBalancing::Ewma: {
+        std::vector<std::size_t> candidates;
+        candidates.reserve(count);
+        for (auto server = 0u; server < count; ++server)
+            if (healthy(server))
+                candidates.push_back(server);
+        if (candidates.empty()) {
+            for (auto server = 0u; server < count; ++server)
+                candidates.push_back(server);
+        }
+        if (candidates.size() == 1)
+            return candidates.front();
+
+        std::uniform_int_distribution<std::size_t> distribution(0, candidates.size() - 1);
+        auto first = distribution(randomEngine());
+        auto second = distribution(randomEngine());
+        if (second == first)
+            second = (first + 1) % candidates.size();
+
+        std::lock_guard lock(mutex_);
+        return cost(candidates[first]) <= cost(candidates[second]) ? candidates[first] : candidates[second];
+    }
+
+    default:
+        return preferred_;
+    }
+}
+
+void LoadBalancer::begin(std::size_t server)
+{
+    ++servers_[server]->outstanding;
+}
+
+void LoadBalancer::end(std::size_t server, Clock::duration latency, bool success)
+{
+    --servers_[server]->outstanding;
+    record(server, latency, success);
+}
+
+void LoadBalancer::abandon(std::size_t server)
+{
+    --servers_[server]->outstanding;
+}
+
+void LoadBalancer::record(std::size_t server, Clock::duration latency, bool success)
+{
+    auto& state = *servers_[server];
+    if (success)
+        state.consecutiveFailures = 0;
+    else if (++state.consecutiveFailures == unhealthyAfterFailures)
+        log().debug("[LoadBalancer] Demoting server #{} after {} failures.", server, unhealthyAfterFailures);
+
+    auto sample = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    if (!success)
+        sample = std::max(sample, failurePenalty);
+
+    std::lock_guard lock(mutex_);
+    state.latency = state.latency == 0. ? sample : state.latency + ewmaWeight * (sample - state.latency);
+}
+
+bool LoadBalancer::healthy(std::size_t server) const
+{
+    return servers_[server]->consecutiveFailures < unhealthyAfterFailures;
+}
+
+double LoadBalancer::cost(std::size_t server) const
+{
+    auto const& state = *servers_[server];
+    return (state.latency + 1.) * (state.outstanding + 1.);
+}
+
+LoadBalancer::ServerStats LoadBalancer::stats(std::size_t server) const
+{
+    auto const& state = *servers_[server];
+    ServerStats result;
+    result.outstanding = state.outstanding;
+    result.consecutiveFailures = state.consecutiveFailures;
+    result.healthy = healthy(server);
+    std::lock_guard lock(mutex_);
+    result.latency = std::chrono::microseconds(static_cast<int64_t>(state.latency));
+    return result;
+}
+
+void LoadBalancer::startProbing(std::weak_ptr<IHttpClient> client,
+                                std::vector<std::string> urls,
+                                std::vector<Config> configs,
+                                Clock::duration interval)
+{
+    probeClient_ = std::move(client);
+    probeUrls_ = std::move(urls);
+    probeConfigs_ = std::move(configs);
+    probeConfigs_.resize(probeUrls_.size());
+
+    auto& timer = Timer::shared();
+    probeTask_ = {timer, timer.scheduleEvery(interval, [weak = weak_from_this()]{
+        if (auto self = weak.lock())
+            self->probe();
+    })};
+}
+
+void LoadBalancer::probe()
+{
+    // Servers are probed in parallel, so that a hanging server does
+    // not hold up the others, and each probe gets at most probeTimeout.
+    for (auto server = 0u; server < probeUrls_.size(); ++server) {
+        // Skip the server if its previous probe is still running.
+        if (servers_[server]->probing.exchange(true))
+            continue;
+
+        auto config = probeConfigs_[server];
+        auto deadline = Clock::now() + probeTimeout;
+        if (!config.deadline || *config.deadline > deadline)
+            config.deadline = deadline;
+
+        // This runs on the Timer thread, which must not wait for the pool.
+        auto posted = ThreadPool::shared().tryPost([weak = weak_from_this(), server, config = std::move(config)]{
+            auto self = weak.lock();
+            if (!self)
+                return;
+
+            if (auto client = self->probeClient_.lock()) {
+                auto start = Clock::now();
+                auto success = false;
+                try {
+                    success = client->get(self->probeUrls_[server], config).status != 0;
+                }
+                catch (std::exception const& e) {
+                    log().debug("[LoadBalancer] Probe of {} failed: {}", self->probeUrls_[server], e.what());
+                }
+                self->record(server, Clock::now() - start, success);
+            }
+            self->servers_[server]->probing = false;
+        });
+        if (!posted) {
+            log().debug("[LoadBalancer] Skipping probe of {}, the worker queue is full.", probeUrls_[server]);
+            servers_[server]->probing = false;
+        }
+    }
+}
+
+}
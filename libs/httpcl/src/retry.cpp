@@ -0,0 +1,127 @@
+#include "retry.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <iomanip>
+#include <locale>
+#include <random>
+#include <sstream>
+
+namespace httpcl
+{
+
+namespace
+{
+
+std::mt19937& randomEngine()
+{
+    thread_local std::mt19937 engine{std::random_device{}()};
+    return engine;
+}
+
+std::time_t toUtcTime(std::tm& tm)
+{
+#ifdef _WIN32
+    return _mkgmtime(&tm);
+#else
+    return timegm(&tm);
+#endif
+}
+
+}
+
+bool RetryPolicy::retryable(int status) const
+{
+    return status == 0 || std::find(statuses.begin(), statuses.end(), status) != statuses.end();
+}
+
+std::chrono::milliseconds RetryPolicy::backoff(uint32_t failedAttempts) const
+{
+    auto delay = static_cast<double>(initialBackoff.count());
+    for (auto i = 1u; i < failedAttempts && delay < maxBackoff.count(); ++i)
+        delay *= multiplier;
+    delay = std::min(delay, static_cast<double>(maxBackoff.count()));
+
+    auto randomized = std::clamp(jitter, 0., 1.);
+    if (randomized > 0.) {
+        std::uniform_real_distribution<double> distribution(1. - randomized, 1.);
+        delay *= distribution(randomEngine());
+    }
+    return std::chrono::milliseconds(static_cast<int64_t>(delay));
+}
+
+std::optional<std::chrono::milliseconds> parseRetryAfter(
+    std::string const& value,
+    std::chrono::system_clock::time_point now)
+{
+    if (value.empty())
+        return {};
+
+    if (std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        try {
+            return std::chrono::seconds(std::stoll(value));
+        }
+        catch (std::exception const&) {
+            return {};
+        }
+    }
+
+    // IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+    std::tm tm{};
+    std::istringstream stream(value);
+    stream.imbue(std::locale::classic());
+    stream >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S");
+    if (stream.fail())
+        return {};
+
+    auto date = std::chrono::system_clock::from_time_t(toUtcTime(tm));
+    if (date <= now)
+        return std::chrono::milliseconds(0);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(date - now);
+}
+
+}
+
+namespace YAML
+{
+
+Node convert<httpcl::RetryPolicy>::encode(httpcl::RetryPolicy const& policy)
+{
+    Node node;
+    node["max-attempts"] = policy.maxAttempts;
+    node["initial-backoff-ms"] = policy.initialBackoff.count();
+    node["max-backoff-ms"] = policy.maxBackoff.count();
+    node["multiplier"] = policy.multiplier;
+    node["jitter"] = policy.jitter;
+    node["statuses"] = policy.statuses;
+    node["non-idempotent"] = policy.nonIdempotent;
+    node["failover"] = policy.failover;
+    return node;
+}
+
+bool convert<httpcl::RetryPolicy>::decode(Node const& node, httpcl::RetryPolicy& policy)
+{
+    if (!node.IsMap())
+        return false;
+
+    if (auto v = node["max-attempts"])
+        policy.maxAttempts = std::max(v.as<uint32_t>(), 1u);
+    if (auto v = node["initial-backoff-ms"])
+        policy.initialBackoff = std::chrono::milliseconds(v.as<int64_t>());
+    if (auto v = node["max-backoff-ms"])
+        policy.maxBackoff = std::chrono::milliseconds(v.as<int64_t>());
+    if (auto v = node["multiplier"])
+        policy.multiplier = v.as<double>();
+    if (auto v = node["jitter"])
+        policy.jitter = v.as<double>();
+    if (auto v = node["statuses"])
+        policy.statuses = v.as<std::vector<int>>();
+    if (auto v = node["non-idempotent"])
+        policy.nonIdempotent = v.as<bool>();
+    if (auto v = node["failover"])
+        policy.failover = v.as<bool>();
+    return true;
+}
+
+}
@@ -0,0 +1,65 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/cancellation.hpp"
+#include "httpcl/http-settings.hpp"
+
+#include <thread>
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("CancellationToken", "[cancellation]") {
+    CancellationToken token;
+    int calls = 0;
+    auto id = token.subscribe([&]{ ++calls; });
+    auto removed = token.subscribe([&]{ calls += 10; });
+    token.unsubscribe(removed);
+
+    REQUIRE_FALSE(token.cancelled());
+    REQUIRE_FALSE(token.waitFor(1ms));
+
+    SECTION("Callbacks run once on cancellation") {
+        token.cancel();
+        token.cancel();
+        REQUIRE(token.cancelled());
+        REQUIRE(calls == 1);
+        REQUIRE(token.waitFor(1h));
+    }
+
+    SECTION("Late subscribers are called right away") {
+        token.cancel();
+        token.subscribe([&]{ calls += 100; });
+        REQUIRE(calls == 101);
+    }
+
+    SECTION("Waiting ends on cancellation") {
+        std::thread canceller([&]{
+            std::this_thread::sleep_for(10ms);
+            token.cancel();
+        });
+        REQUIRE(token.waitFor(10s));
+        canceller.join();
+    }
+
+    token.unsubscribe(id);
+}
+
+TEST_CASE("Merging call limits", "[cancellation]") {
+    auto now = std::chrono::steady_clock::now();
+    Config config;
+    config.deadline = now + 10s;
+
+    Config other;
+    other.deadline = now + 1s;
+    other.cancellation = std::make_shared<CancellationToken>();
+
+    config |= other;
+    REQUIRE(config.deadline == now + 1s);
+    REQUIRE(config.cancellation == other.cancellation);
+
+    // The earlier deadline is kept.
+    Config later;
+    later.deadline = now + 1h;
+    config |= later;
+    REQUIRE(config.deadline == now + 1s);
+}
@@ -0,0 +1,137 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/circuit-breaker.hpp"
+#include "httpcl/http-settings.hpp"
+
+#include <thread>
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+using State = CircuitBreaker::State;
+
+namespace
+{
+
+CircuitBreakerPolicy testPolicy()
+{
+    CircuitBreakerPolicy policy;
+    policy.consecutiveFailures = 3;
+    policy.errorRate = .5;
+    policy.window = 10;
+    policy.minRequests = 4;
+    policy.openDuration = 20ms;
+    policy.halfOpenProbes = 2;
+    return policy;
+}
+
+void send(CircuitBreaker& breaker, int status)
+{
+    REQUIRE(breaker.allow());
+    breaker.record(status);
+}
+
+}
+
+TEST_CASE("CircuitBreaker trips", "[circuit-breaker]") {
+    CircuitBreaker breaker("test", testPolicy());
+    REQUIRE(breaker.state() == State::Closed);
+
+    SECTION("After consecutive requests without response") {
+        send(breaker, 0);
+        send(breaker, 0);
+        REQUIRE(breaker.state() == State::Closed);
+        send(breaker, 0);
+        REQUIRE(breaker.state() == State::Open);
+        REQUIRE_FALSE(breaker.allow());
+    }
+
+    SECTION("Responses reset the consecutive count") {
+        auto policy = testPolicy();
+        policy.errorRate = 1.;
+        breaker.setPolicy(policy);
+        send(breaker, 0);
+        send(breaker, 0);
+        send(breaker, 200);
+        send(breaker, 0);
+        send(breaker, 200);
+        send(breaker, 200);
+        REQUIRE(breaker.state() == State::Closed);
+    }
+
+    SECTION("On the error rate") {
+        send(breaker, 200);
+        send(breaker, 503);
+        send(breaker, 200);
+        REQUIRE(breaker.state() == State::Closed);
+        send(breaker, 500);
+        REQUIRE(breaker.state() == State::Open);
+    }
+
+    SECTION("Client errors do not count") {
+        for (auto i = 0; i < 10; ++i)
+            send(breaker, 404);
+        REQUIRE(breaker.state() == State::Closed);
+    }
+}
+
+TEST_CASE("CircuitBreaker recovers through half-open probes", "[circuit-breaker]") {
+    CircuitBreaker breaker("test", testPolicy());
+    for (auto i = 0; i < 3; ++i)
+        send(breaker, 0);
+    REQUIRE_FALSE(breaker.allow());
+
+    std::this_thread::sleep_for(30ms);
+    REQUIRE(breaker.state() == State::HalfOpen);
+
+    // Only the configured number of probes is let through.
+    REQUIRE(breaker.allow());
+    REQUIRE(breaker.allow());
+    REQUIRE_FALSE(breaker.allow());
+
+    SECTION("Successful probes close the circuit") {
+        breaker.record(200);
+        REQUIRE(breaker.state() == State::HalfOpen);
+        breaker.record(200);
+        REQUIRE(breaker.state() == State::Closed);
+        REQUIRE(breaker.allow());
+    }
+
+    SECTION("A failed probe opens the circuit again") {
+        breaker.record(200);
+        breaker.record(502);
+        REQUIRE(breaker.state() == State::Open);
+        REQUIRE_FALSE(breaker.allow());
+    }
+
+    SECTION("Abandoned probes free their slot") {
+        breaker.abandon();
+        REQUIRE(breaker.allow());
+    }
+}
+
+TEST_CASE("CircuitBreakerRegistry shares breakers per host", "[circuit-breaker]") {
+    auto& registry = CircuitBreakerRegistry::instance();
+    auto a = registry.get("https://registry-test-a", testPolicy());
+    REQUIRE(a == registry.get("https://registry-test-a", testPolicy()));
+    REQUIRE(a != registry.get("https://registry-test-b", testPolicy()));
+}
+
+TEST_CASE("Circuit breaker settings are read from YAML", "[circuit-breaker]") {
+    Config config(R"(
+        scope: "*"
+        circuit-breaker:
+          consecutive-failures: 2
+          error-rate: 0.25
+          open-ms: 5000
+    )");
+
+    REQUIRE(config.circuitBreaker);
+    REQUIRE(config.circuitBreaker->consecutiveFailures == 2);
+    REQUIRE(config.circuitBreaker->errorRate == .25);
+    REQUIRE(config.circuitBreaker->openDuration == 5000ms);
+    REQUIRE(config.circuitBreaker->halfOpenProbes == 1);
+
+    Config reloaded(config.toYaml());
+    REQUIRE(reloaded.circuitBreaker);
+    REQUIRE(reloaded.circuitBreaker->openDuration == 5000ms);
+}
@@ -0,0 +1,102 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/compression.hpp"
+#include "httpcl/http-settings.hpp"
+
+using namespace httpcl;
+
+TEST_CASE("Content encodings are parsed", "[compression]") {
+    REQUIRE(parseContentEncoding("gzip") == ContentEncoding::Gzip);
+    REQUIRE(parseContentEncoding(" X-GZIP ") == ContentEncoding::Gzip);
+    REQUIRE(parseContentEncoding("Deflate") == ContentEncoding::Deflate);
+    REQUIRE_FALSE(parseContentEncoding("identity"));
+    REQUIRE_FALSE(parseContentEncoding("br"));
+    REQUIRE_FALSE(parseContentEncoding(""));
+}
+
+TEST_CASE("Buffers survive a compression round trip", "[compression]") {
+    std::string data;
+    for (auto i = 0; i < 10000; ++i)
+        data += "tile " + std::to_string(i % 17) + ";";
+    data.push_back('\0');
+    data += "binary tail";
+
+    for (auto encoding : {ContentEncoding::Gzip, ContentEncoding::Deflate}) {
+        auto compressed = compress(data, encoding);
+        REQUIRE(compressed.size() < data.size() / 3);
+        REQUIRE(decompress(compressed, encoding) == data);
+    }
+
+    SECTION("Empty buffers") {
+        REQUIRE(decompress(compress("", ContentEncoding::Gzip), ContentEncoding::Gzip).empty());
+    }
+}
+
+TEST_CASE("Foreign encodings are decoded", "[compression]") {
+    // `printf hello | gzip -n`
+    const unsigned char gzipHello[] = {
+        0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xcb, 0x48,
+        0xcd, 0xc9, 0xc9, 0x07, 0x00, 0x86, 0xa6, 0x10, 0x36, 0x05, 0x00, 0x00,
+        0x00};
+    // Raw deflate stream without zlib header, as sent by some servers.
+    const unsigned char rawDeflateHello[] = {0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x07, 0x00};
+
+    REQUIRE(decompress({reinterpret_cast<char const*>(gzipHello), sizeof(gzipHello)},
+                       ContentEncoding::Gzip) == "hello");
+    REQUIRE(decompress({reinterpret_cast<char const*>(rawDeflateHello), sizeof(rawDeflateHello)},
+                       ContentEncoding::Deflate) == "hello");
+}
+
+TEST_CASE("Corrupt content is rejected", "[compression]") {
+    auto compressed = compress("hello hello hello", ContentEncoding::Gzip);
+    REQUIRE_THROWS(decompress(compressed.substr(0, compressed.size() / 2), ContentEncoding::Gzip));
+    REQUIRE_THROWS(decompress("not compressed", ContentEncoding::Gzip));
+}
+
+TEST_CASE("Decompression bombs are rejected", "[compression]") {
+    // 4 MiB of zeros compress to a few KiB.
+    std::string zeros(4 * 1024 * 1024, '\0');
+
+    for (auto encoding : {ContentEncoding::Gzip, ContentEncoding::Deflate}) {
+        auto compressed = compress(zeros, encoding);
+        REQUIRE(compressed.size() < 64 * 1024);
+
+        REQUIRE_THROWS_WITH(decompress(compressed, encoding, 1024 * 1024),
+                            Catch::Matchers::ContainsSubstring("exceeds the limit"));
+        REQUIRE(decompress(compressed, encoding, zeros.size()) == zeros);
+        REQUIRE(decompress(compressed, encoding, 0) == zeros);
+    }
+
+    SECTION("The default limit allows regular responses") {
+        REQUIRE(maxDecompressedSize() > zeros.size());
+        REQUIRE(decompress(compress(zeros, ContentEncoding::Gzip), ContentEncoding::Gzip) == zeros);
+    }
+}
+
+TEST_CASE("Compression settings are read from YAML", "[compression]") {
+    Config config(R"(
+        scope: "*"
+        compression:
+          request: gzip
+          min-size: 512
+    )");
+
+    REQUIRE(config.compression);
+    REQUIRE(config.compression->accept);
+    REQUIRE(config.compression->request == ContentEncoding::Gzip);
+    REQUIRE(config.compression->minSize == 512);
+
+    SECTION("YAML round trip") {
+        Config reloaded(config.toYaml());
+        REQUIRE(reloaded.compression);
+        REQUIRE(reloaded.compression->request == ContentEncoding::Gzip);
+        REQUIRE(reloaded.compression->minSize == 512);
+    }
+
+    SECTION("Unknown encodings are an error") {
+        REQUIRE_THROWS(Config(R"(
+            compression:
+              request: br
+        )"));
+    }
+}
@@ -0,0 +1,163 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/connection-pool.hpp"
+
+#include <atomic>
+#include <thread>
+
+using namespace httpcl;
+
+namespace
+{
+
+ConnectionPool::ClientFactory makeFactory(int& created)
+{
+    return [&created]() {
+        ++created;
+        // Constructing a client does not connect, so no server is needed.
+        return std::make_unique<httplib::Client>("http://localhost:1");
+    };
+}
+
+}
+
+TEST_CASE("ConnectionPool reuses released clients", "[connection-pool]") {
+    ConnectionPool pool;
+    int created = 0;
+    auto factory = makeFactory(created);
+
+    SECTION("Same key hits the idle client") {
+        httplib::Client* first = nullptr;
+        {
+            auto lease = pool.acquire("http://a", factory);
+            REQUIRE_FALSE(lease.reused());
+            first = &lease.client();
+        }
+        auto lease = pool.acquire("http://a", factory);
+        REQUIRE(lease.reused());
+        REQUIRE(&lease.client() == first);
+        REQUIRE(created == 1);
+
+        auto stats = pool.stats();
+        REQUIRE(stats.hits == 1);
+        REQUIRE(stats.misses == 1);
+        REQUIRE(stats.evictions == 0);
+    }
+
+    SECTION("Different keys do not share clients") {
+        { auto lease = pool.acquire("http://a", factory); }
+        auto lease = pool.acquire("http://b", factory);
+        REQUIRE_FALSE(lease.reused());
+        REQUIRE(created == 2);
+    }
+
+    SECTION("Concurrent leases get separate clients") {
+        auto lease1 = pool.acquire("http://a", factory);
+        auto lease2 = pool.acquire("http://a", factory);
+        REQUIRE(&lease1.client() != &lease2.client());
+        REQUIRE(pool.stats().misses == 2);
+    }
+
+    SECTION("Discarded clients are not reused") {
+        {
+            auto lease = pool.acquire("http://a", factory);
+            lease.discard();
+        }
+        auto lease = pool.acquire("http://a", factory);
+        REQUIRE_FALSE(lease.reused());
+        REQUIRE(created == 2);
+    }
+}
+
+TEST_CASE("ConnectionPool limits and eviction", "[connection-pool]") {
+    int created = 0;
+    auto factory = makeFactory(created);
+
+    SECTION("Idle clients beyond maxIdlePerHost are evicted") {
+        ConnectionPool::Options options;
+        options.maxIdlePerHost = 1;
+        ConnectionPool pool(options);
+        {
+            auto lease1 = pool.acquire("http://a", factory);
+            auto lease2 = pool.acquire("http://a", factory);
+        }
+        REQUIRE(pool.stats().evictions == 1);
+    }
+
+    SECTION("Idle clients beyond maxIdle are evicted oldest first") {
+        ConnectionPool::Options options;
+        options.maxIdle = 1;
+        ConnectionPool pool(options);
+        { auto lease = pool.acquire("http://a", factory); }
+        { auto lease = pool.acquire("http://b", factory); }
+        REQUIRE(pool.stats().evictions == 1);
+
+        auto lease = pool.acquire("http://b", factory);
+        REQUIRE(lease.reused());
+    }
+
+    SECTION("Keys without connections are forgotten") {
+        ConnectionPool::Options options;
+        options.maxIdle = 1;
+        ConnectionPool pool(options);
+        for (auto key : {"http://a", "http://b", "http://c"}) {
+            auto lease = pool.acquire(key, factory);
+        }
+        REQUIRE(pool.stats().evictions == 2);
+        REQUIRE(pool.stats().hosts == 1);
+
+        { auto lease = pool.acquire("http://c", factory); lease.discard(); }
+        REQUIRE(pool.stats().hosts == 0);
+    }
+
+    SECTION("Expired idle clients are evicted") {
+        ConnectionPool::Options options;
+        options.idleTimeout = std::chrono::milliseconds(0);
+        ConnectionPool pool(options);
+        { auto lease = pool.acquire("http://a", factory); }
+        auto lease = pool.acquire("http://a", factory);
+        REQUIRE_FALSE(lease.reused());
+        REQUIRE(pool.stats().evictions == 1);
+    }
+
+    SECTION("Disabled idle set never reuses") {
+        ConnectionPool::Options options;
+        options.maxIdlePerHost = 0;
+        ConnectionPool pool(options);
+        { auto lease = pool.acquire("http://a", factory); }
+        auto lease = pool.acquire("http://a", factory);
+        REQUIRE_FALSE(lease.reused());
+    }
+
+    SECTION("maxPerHost blocks until a lease is returned") {
+        ConnectionPool::Options options;
+        options.maxPerHost = 1;
+        ConnectionPool pool(options);
+
+        auto lease = std::make_unique<ConnectionPool::Lease>(pool.acquire("http://a", factory));
+        std::atomic_bool acquired{false};
+        std::atomic_bool reused{false};
+        std::thread waiter([&]{
+            auto second = pool.acquire("http://a", factory);
+            reused = second.reused();
+            acquired = true;
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE_FALSE(acquired);
+        lease.reset();
+        waiter.join();
+        REQUIRE(acquired);
+        REQUIRE(reused);
+        REQUIRE(created == 1);
+    }
+
+    SECTION("clear() drops idle clients") {
+        ConnectionPool pool;
+        { auto lease = pool.acquire("http://a", factory); }
+        pool.clear();
+        auto lease = pool.acquire("http://a", factory);
+        REQUIRE_FALSE(lease.reused());
+        REQUIRE(pool.stats().evictions == 1);
+    }
+}
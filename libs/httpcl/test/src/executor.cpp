@@ -0,0 +1,134 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/executor.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("ThreadPool runs submitted tasks", "[executor]") {
+    ThreadPool pool(2, 4);
+    REQUIRE(pool.size() == 2);
+
+    SECTION("Results are delivered through the future") {
+        auto future = pool.submit([]{ return 42; });
+        REQUIRE(future.get() == 42);
+    }
+
+    SECTION("Exceptions are delivered through the future") {
+        auto future = pool.submit([]() -> int { throw std::runtime_error("fail"); });
+        REQUIRE_THROWS_AS(future.get(), std::runtime_error);
+    }
+
+    SECTION("Tasks run on worker threads") {
+        REQUIRE_FALSE(ThreadPool::isWorkerThread());
+        REQUIRE(pool.submit([]{ return ThreadPool::isWorkerThread(); }).get());
+    }
+
+    SECTION("All queued tasks are run") {
+        std::atomic<int> count{0};
+        std::vector<std::future<void>> futures;
+        for (auto i = 0; i < 32; ++i)
+            futures.emplace_back(pool.submit([&count]{ ++count; }));
+        for (auto& future : futures)
+            future.get();
+        REQUIRE(count == 32);
+    }
+}
+
+TEST_CASE("ThreadPool starts tasks by priority", "[executor]") {
+    ThreadPool pool(1, 8);
+
+    // Keep the only worker busy while the other tasks are queued.
+    std::promise<void> release;
+    auto blocker = pool.submit([gate = release.get_future().share()]{ gate.wait(); });
+
+    std::mutex mutex;
+    std::vector<Priority> order;
+    std::vector<std::future<void>> futures;
+    for (auto priority : {Priority::Low, Priority::Normal, Priority::High, Priority::Normal})
+        futures.emplace_back(pool.submit([&, priority]{
+            std::lock_guard lock(mutex);
+            order.push_back(priority);
+        }, priority));
+
+    release.set_value();
+    blocker.get();
+    for (auto& future : futures)
+        future.get();
+    REQUIRE(order == std::vector<Priority>{Priority::High, Priority::Normal, Priority::Normal, Priority::Low});
+}
+
+TEST_CASE("ThreadPool::tryPost does not block on a full queue", "[executor]") {
+    ThreadPool pool(1, 1);
+
+    std::promise<void> release;
+    auto gate = release.get_future().share();
+    std::promise<void> started;
+    pool.post([&started, gate]{ started.set_value(); gate.wait(); });
+    started.get_future().wait();
+
+    std::atomic<int> count{0};
+    REQUIRE(pool.tryPost([&count]{ ++count; }));
+    REQUIRE_FALSE(pool.tryPost([&count]{ ++count; }));
+
+    release.set_value();
+    auto done = pool.submit([]{});
+    done.get();
+    REQUIRE(count == 1);
+}
+
+TEST_CASE("Timer runs scheduled tasks", "[executor]") {
+    Timer timer;
+
+    SECTION("One-shot task") {
+        std::promise<void> done;
+        timer.schedule(10ms, [&done]{ done.set_value(); });
+        REQUIRE(done.get_future().wait_for(5s) == std::future_status::ready);
+    }
+
+    SECTION("Repeated task until cancelled") {
+        std::atomic<int> count{0};
+        auto id = timer.scheduleEvery(5ms, [&count]{ ++count; });
+        while (count < 3)
+            std::this_thread::sleep_for(1ms);
+        timer.cancel(id);
+        auto stopped = count.load();
+        std::this_thread::sleep_for(50ms);
+        // At most one run may have been in progress while cancelling.
+        REQUIRE(count <= stopped + 1);
+    }
+
+    SECTION("Cancelled task does not run") {
+        std::atomic<bool> ran{false};
+        {
+            Timer::ScopedTask task(timer, timer.schedule(20ms, [&ran]{ ran = true; }));
+        }
+        std::this_thread::sleep_for(50ms);
+        REQUIRE_FALSE(ran);
+    }
+}
+
+TEST_CASE("Execution policies", "[executor]") {
+    SECTION("Inline runs on the calling thread") {
+        auto caller = std::this_thread::get_id();
+        std::thread::id runner;
+        execute(ExecutionPolicy::Inline, "[test]", [&]{ runner = std::this_thread::get_id(); });
+        REQUIRE(runner == caller);
+    }
+
+    SECTION("WorkerPool runs on a pool thread") {
+        bool onWorker = false;
+        execute(ExecutionPolicy::WorkerPool, "[test]", [&]{ onWorker = ThreadPool::isWorkerThread(); });
+        REQUIRE(onWorker);
+    }
+
+    SECTION("Exceptions are rethrown") {
+        REQUIRE_THROWS_AS(
+            execute(ExecutionPolicy::WorkerPool, "[test]", []{ throw std::runtime_error("fail"); }),
+            std::runtime_error);
+    }
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/hedging.hpp"
+#include "httpcl/http-settings.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("LatencyWindow percentiles", "[hedging]") {
+    LatencyWindow window(10);
+    REQUIRE_FALSE(window.percentile(.5));
+
+    for (auto i = 1; i <= 10; ++i)
+        window.add(std::chrono::microseconds(i));
+    REQUIRE(window.percentile(.5) == 5us);
+    REQUIRE(window.percentile(.9) == 9us);
+    REQUIRE(window.percentile(1.) == 10us);
+    REQUIRE(window.percentile(0.) == 1us);
+    REQUIRE_FALSE(window.percentile(.5, 11));
+
+    SECTION("Old samples are replaced") {
+        for (auto i = 0; i < 10; ++i)
+            window.add(100us);
+        REQUIRE(window.size() == 10);
+        REQUIRE(window.percentile(0.) == 100us);
+    }
+}
+
+TEST_CASE("HedgePolicy delays", "[hedging]") {
+    LatencyWindow window;
+    HedgePolicy policy;
+    policy.minSamples = 2;
+
+    SECTION("Percentile delay needs enough samples") {
+        REQUIRE_FALSE(policy.hedgeDelay(window));
+        window.add(10ms);
+        window.add(20ms);
+        REQUIRE(policy.hedgeDelay(window) == 20ms);
+    }
+
+    SECTION("Fixed delay") {
+        policy.delay = 5ms;
+        REQUIRE(policy.hedgeDelay(window) == 5ms);
+    }
+
+    SECTION("Disabled") {
+        policy.delay = 5ms;
+        policy.maxHedges = 0;
+        REQUIRE_FALSE(policy.hedgeDelay(window));
+    }
+}
+
+TEST_CASE("Hedge settings are read from YAML", "[hedging]") {
+    Config config(R"(
+        scope: "*"
+        hedge:
+          percentile: 0.99
+          max-hedges: 2
+    )");
+
+    REQUIRE(config.hedge);
+    REQUIRE_FALSE(config.hedge->delay);
+    REQUIRE(config.hedge->percentile == .99);
+    REQUIRE(config.hedge->maxHedges == 2);
+
+    Config fixed(R"(
+        scope: "*"
+        hedge:
+          delay-ms: 50
+    )");
+    config |= fixed;
+    REQUIRE(config.hedge->delay == 50ms);
+    REQUIRE(Config(config.toYaml()).hedge->delay == 50ms);
+}
+
+TEST_CASE("Methods are marked idempotent in YAML", "[hedging]") {
+    Config config(R"(
+        scope: "*"
+        idempotent: true
+    )");
+    REQUIRE(config.idempotent == true);
+    REQUIRE(Config(config.toYaml()).idempotent == true);
+    REQUIRE_FALSE(Config("scope: \"*\"").idempotent);
+
+    Config notIdempotent(R"(
+        scope: "*"
+        idempotent: false
+    )");
+    config |= notIdempotent;
+    REQUIRE(config.idempotent == false);
+}
@@ -0,0 +1,306 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/http-cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+/** Empty directory which is deleted with the test. */
+struct TemporaryDirectory
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("httpcl-cache-test-" + std::to_string(std::random_device{}()));
+
+    ~TemporaryDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+};
+
+/** MockHttpClient which remembers the config of the last GET. */
+struct RecordingHttpClient : MockHttpClient
+{
+    Config* lastConfig = nullptr;
+
+    Result get(const std::string& uri, const Config& config) override {
+        *lastConfig = config;
+        return MockHttpClient::get(uri, config);
+    }
+};
+
+}
+
+TEST_CASE("CachingHttpClient", "[http-cache]") {
+    int requests = 0;
+    IHttpClient::Result response{200, "payload", {{"Cache-Control", "max-age=60"}}};
+    Config lastConfig;
+
+    auto mock = std::make_unique<RecordingHttpClient>();
+    mock->lastConfig = &lastConfig;
+    mock->getFun = [&](std::string_view) {
+        ++requests;
+        return response;
+    };
+    mock->postFun = [&](std::string_view, auto const&, auto const&) {
+        return IHttpClient::Result{200, {}};
+    };
+
+    auto store = std::make_shared<MemoryHttpCacheStore>(1024 * 1024);
+    CachingHttpClient client(std::move(mock), store);
+    Config config;
+
+    SECTION("Fresh responses are reused") {
+        REQUIRE(client.get("https://a.com/data", config).content == "payload");
+        auto cached = client.get("https://a.com/data", config);
+        REQUIRE(cached.status == 200);
+        REQUIRE(cached.content == "payload");
+        REQUIRE(cached.header("Cache-Control") == "max-age=60");
+        REQUIRE(requests == 1);
+        REQUIRE(client.stats().hits == 1);
+        REQUIRE(client.stats().misses == 1);
+
+        // Different URI or config.
+        client.get("https://a.com/other", config);
+        config.headers.emplace("X-Tenant", "b");
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 3);
+    }
+
+    SECTION("Age is subtracted from max-age") {
+        response.headers.emplace("Age", "60");
+        client.get("https://a.com/data", config);
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 2);
+    }
+
+    SECTION("Uncacheable responses") {
+        response.headers = {{"Cache-Control", "no-store, max-age=60"}};
+        client.get("https://a.com/data", config);
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 2);
+
+        response.headers = {};
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 3);
+        REQUIRE(store->bytes() == 0);
+
+        response = {404, {}, {{"Cache-Control", "max-age=60"}}};
+        client.get("https://a.com/data", config);
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 5);
+    }
+
+    SECTION("Stale responses are revalidated") {
+        response.headers = {{"Cache-Control", "no-cache"}, {"ETag", "\"v1\""}, {"Last-Modified", "Wed, 21 Oct 2015 07:28:00 GMT"}};
+        client.get("https://a.com/data", config);
+        REQUIRE(lastConfig.headers.count("If-None-Match") == 0);
+
+        response = {304, {}, {{"Cache-Control", "max-age=60"}, {"ETag", "\"v1\""}}};
+        auto revalidated = client.get("https://a.com/data", config);
+        REQUIRE(requests == 2);
+        REQUIRE(lastConfig.headers.find("If-None-Match")->second == "\"v1\"");
+        REQUIRE(lastConfig.headers.find("If-Modified-Since")->second == "Wed, 21 Oct 2015 07:28:00 GMT");
+        REQUIRE(revalidated.status == 200);
+        REQUIRE(revalidated.content == "payload");
+        REQUIRE(client.stats().revalidations == 1);
+
+        // The 304 made the response fresh.
+        REQUIRE(client.get("https://a.com/data", config).content == "payload");
+        REQUIRE(requests == 2);
+        REQUIRE(client.stats().hits == 1);
+    }
+
+    SECTION("Changed responses replace stale ones") {
+        response.headers = {{"ETag", "\"v1\""}};
+        client.get("https://a.com/data", config);
+        response = {200, "changed", {{"ETag", "\"v2\""}}};
+        REQUIRE(client.get("https://a.com/data", config).content == "changed");
+        client.get("https://a.com/data", config);
+        REQUIRE(lastConfig.headers.find("If-None-Match")->second == "\"v2\"");
+    }
+
+    SECTION("Successful unsafe methods invalidate") {
+        client.get("https://a.com/data", config);
+        client.post("https://a.com/data", {}, config);
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 2);
+    }
+}
+
+TEST_CASE("MemoryHttpCacheStore evicts least recently used", "[http-cache]") {
+    MemoryHttpCacheStore store(1024);
+    CachedResponse response{200, std::string(300, 'x')};
+
+    store.store("a", response);
+    store.store("b", response);
+    REQUIRE(store.load("a"));
+    store.store("c", response);
+    REQUIRE(store.load("a"));
+    REQUIRE_FALSE(store.load("b"));
+    REQUIRE(store.bytes() <= 1024);
+
+    store.erase("a");
+    REQUIRE_FALSE(store.load("a"));
+}
+
+TEST_CASE("DiskHttpCacheStore", "[http-cache]") {
+    TemporaryDirectory dir;
+    CachedResponse response{200, std::string("\0payload", 8), {{"ETag", "\"v1\""}}, std::chrono::system_clock::now() + 1h};
+
+    SECTION("Responses survive restarts") {
+        DiskHttpCacheStore(dir.path).store("a", response);
+
+        DiskHttpCacheStore store(dir.path);
+        auto loaded = store.load("a");
+        REQUIRE(loaded);
+        REQUIRE(loaded->status == 200);
+        REQUIRE(loaded->content == response.content);
+        REQUIRE(loaded->headers == response.headers);
+        REQUIRE(std::chrono::abs(loaded->expires - response.expires) < 1ms);
+        REQUIRE_FALSE(store.load("b"));
+
+        store.erase("a");
+        REQUIRE_FALSE(store.load("a"));
+    }
+
+    SECTION("Unreadable files are ignored") {
+        DiskHttpCacheStore store(dir.path);
+        store.store("a", response);
+        for (auto const& entry : std::filesystem::directory_iterator(dir.path))
+            std::ofstream(entry.path(), std::ios::binary | std::ios::trunc) << "garbage";
+        REQUIRE_FALSE(store.load("a"));
+    }
+
+    SECTION("Expired responses are deleted") {
+        DiskHttpCacheStore store(dir.path, {1024 * 1024, 0s});
+        store.store("a", response);
+        std::this_thread::sleep_for(5ms);
+        REQUIRE_FALSE(store.load("a"));
+        REQUIRE(std::filesystem::is_empty(dir.path));
+    }
+
+    SECTION("Least recently used responses are deleted beyond the budget") {
+        response.content = std::string(300, 'x');
+        DiskHttpCacheStore store(dir.path, {1400, 1h});
+        auto touch = [&](std::string const& key, std::chrono::seconds age) {
+            store.store(key, response);
+            for (auto const& entry : std::filesystem::directory_iterator(dir.path))
+                if (std::filesystem::last_write_time(entry.path()) > std::filesystem::file_time_type::clock::now() - 1s)
+                    std::filesystem::last_write_time(entry.path(), std::filesystem::file_time_type::clock::now() - age);
+        };
+        touch("a", 30s);
+        touch("b", 20s);
+        touch("c", 10s);
+        REQUIRE(store.load("a"));
+
+        // Over budget: "b" and "c" are deleted, which brings it below 3/4.
+        store.store("d", response);
+        REQUIRE(store.load("a"));
+        REQUIRE_FALSE(store.load("b"));
+        REQUIRE_FALSE(store.load("c"));
+        REQUIRE(store.load("d"));
+        REQUIRE(store.bytes() <= 1400);
+    }
+}
+
+TEST_CASE("DiskHttpCacheStore leaves foreign files alone", "[http-cache]") {
+    TemporaryDirectory dir;
+    std::filesystem::create_directories(dir.path);
+    auto old = std::filesystem::file_time_type::clock::now() - 2h;
+    auto write = [&](std::string const& name) {
+        std::ofstream(dir.path / name, std::ios::binary) << std::string(1000, 'x');
+        std::filesystem::last_write_time(dir.path / name, old);
+    };
+    write("notes.txt");
+    write("notes.entry");
+    write(std::string(64, 'a') + ".entry.tmp123");
+
+    CachedResponse response{200, std::string(300, 'x'), {}, std::chrono::system_clock::now() + 1h};
+    DiskHttpCacheStore store(dir.path, {1000, 1h});
+    for (auto key : {"a", "b", "c", "d"})
+        store.store(key, response);
+
+    // The stale temporary file was expired, the budget only counts entries.
+    REQUIRE(std::filesystem::exists(dir.path / "notes.txt"));
+    REQUIRE(std::filesystem::exists(dir.path / "notes.entry"));
+    REQUIRE_FALSE(std::filesystem::exists(dir.path / (std::string(64, 'a') + ".entry.tmp123")));
+    REQUIRE(store.load("d"));
+    REQUIRE(store.bytes() <= 1000);
+}
+
+TEST_CASE("CachingHttpClient keys", "[http-cache]") {
+    TemporaryDirectory dir;
+    int requests = 0;
+    auto mock = std::make_unique<MockHttpClient>();
+    mock->getFun = [&](std::string_view) {
+        ++requests;
+        return IHttpClient::Result{200, "payload", {{"Cache-Control", "max-age=60"}}};
+    };
+    CachingHttpClient client(std::move(mock), std::make_shared<DiskHttpCacheStore>(dir.path));
+
+    Config config;
+    config.oauth2 = Config::OAuth2{"client-id"};
+    config.headers.insert({"Authorization", "Bearer secret-token-1"});
+    config.cookies["session"] = "secret-cookie";
+    config.apiKey = "secret-key";
+    client.get("https://a.com/data", config);
+    REQUIRE(requests == 1);
+
+    SECTION("Credentials are not written to disk") {
+        for (auto const& entry : std::filesystem::directory_iterator(dir.path)) {
+            std::ifstream in(entry.path(), std::ios::binary);
+            std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+            REQUIRE(data.find("https://a.com/data") != std::string::npos);
+            REQUIRE(data.find("secret") == std::string::npos);
+        }
+    }
+
+    SECTION("Refreshed OAuth2 tokens find cached responses") {
+        config.headers.find("Authorization")->second = "Bearer secret-token-2";
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 1);
+
+        config.oauth2->clientId = "other-client";
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 2);
+    }
+
+    SECTION("Other credentials are part of the key") {
+        config.apiKey = "other-key";
+        client.get("https://a.com/data", config);
+        REQUIRE(requests == 2);
+    }
+}
+
+TEST_CASE("CachingHttpClient with a disk tier", "[http-cache]") {
+    TemporaryDirectory dir;
+    int requests = 0;
+    auto makeClient = [&]() {
+        auto mock = std::make_unique<MockHttpClient>();
+        mock->getFun = [&](std::string_view) {
+            ++requests;
+            return IHttpClient::Result{200, "payload", {{"Cache-Control", "max-age=60"}}};
+        };
+        return CachingHttpClient(std::move(mock), std::make_shared<TieredHttpCacheStore>(
+            std::make_shared<MemoryHttpCacheStore>(1024 * 1024),
+            std::make_shared<DiskHttpCacheStore>(dir.path)));
+    };
+
+    makeClient().get("https://a.com/data", {});
+    REQUIRE(requests == 1);
+
+    // A new process would start with an empty memory tier.
+    auto client = makeClient();
+    REQUIRE(client.get("https://a.com/data", {}).content == "payload");
+    REQUIRE(client.get("https://a.com/data", {}).content == "payload");
+    REQUIRE(requests == 1);
+    REQUIRE(client.stats().hits == 2);
+}
@@ -382,6 +382,57 @@ TEST_CASE("OAuth2 getTokenEndpointAuthMethod helper", "[http-settings][oauth2]")
     }
 }
 
+TEST_CASE("OAuth2 refreshAfter configuration", "[http-settings][oauth2]") {
+
+    SECTION("Defaults to 0.8 when omitted") {
+        httpcl::Config cfg(R"(
+oauth2:
+  clientId: test-client
+)");
+        REQUIRE(cfg.oauth2.has_value());
+        REQUIRE_FALSE(cfg.oauth2->refreshAfter.has_value());
+        REQUIRE(cfg.oauth2->getRefreshAfter() == 0.8);
+    }
+
+    SECTION("Parse, serialize and merge refreshAfter") {
+        httpcl::Config cfg(R"(
+oauth2:
+  clientId: test-client
+  refreshAfter: 0.5
+)");
+        REQUIRE(cfg.oauth2->getRefreshAfter() == 0.5);
+
+        httpcl::Config cfg2(cfg.toYaml());
+        REQUIRE(cfg2.oauth2->refreshAfter == 0.5);
+
+        httpcl::Config base(R"(
+oauth2:
+  clientId: base-client
+  refreshAfter: 1
+)");
+        base |= httpcl::Config(R"(
+oauth2:
+  clientId: other-client
+)");
+        REQUIRE(base.oauth2->getRefreshAfter() == 1.0);
+        base |= cfg;
+        REQUIRE(base.oauth2->getRefreshAfter() == 0.5);
+    }
+
+    SECTION("Reject values outside of (0, 1]") {
+        REQUIRE_THROWS_WITH(httpcl::Config(R"(
+oauth2:
+  clientId: test-client
+  refreshAfter: 0
+)"), Catch::Matchers::ContainsSubstring("refreshAfter"));
+        REQUIRE_THROWS_WITH(httpcl::Config(R"(
+oauth2:
+  clientId: test-client
+  refreshAfter: 1.5
+)"), Catch::Matchers::ContainsSubstring("refreshAfter"));
+    }
+}
+
 // ============================================================================
 // Proxy Configuration Tests - Coverage for http-settings.cpp:69-84
 // ============================================================================
@@ -7,6 +7,11 @@
 #include <thread>
 #include <cstdlib>
 #include <string>
+#include <atomic>
+#include <future>
+#include <map>
+#include <mutex>
+#include <optional>
 
 namespace fs = std::filesystem;
 
@@ -358,15 +363,15 @@ http-settings:
 
     httpcl::Settings settings;
 
-    REQUIRE(settings.settings.size() == 2);
-    REQUIRE(settings.settings[0].scope.has_value());
-    REQUIRE(*settings.settings[0].scope == "https://api1.example.com");
-    REQUIRE(settings.settings[0].apiKey.has_value());
-    REQUIRE(*settings.settings[0].apiKey == "key1");
-    REQUIRE(settings.settings[1].scope.has_value());
-    REQUIRE(*settings.settings[1].scope == "https://api2.example.com");
-    REQUIRE(settings.settings[1].apiKey.has_value());
-    REQUIRE(*settings.settings[1].apiKey == "key2");
+    REQUIRE(settings.entries().size() == 2);
+    REQUIRE(settings.entries()[0].scope.has_value());
+    REQUIRE(*settings.entries()[0].scope == "https://api1.example.com");
+    REQUIRE(settings.entries()[0].apiKey.has_value());
+    REQUIRE(*settings.entries()[0].apiKey == "key1");
+    REQUIRE(settings.entries()[1].scope.has_value());
+    REQUIRE(*settings.entries()[1].scope == "https://api2.example.com");
+    REQUIRE(settings.entries()[1].apiKey.has_value());
+    REQUIRE(*settings.entries()[1].apiKey == "key2");
 }
 
 TEST_CASE("LoadSettingsOldFormatCompatibility", "[http-settings][settings][load]") {
@@ -385,11 +390,11 @@ TEST_CASE("LoadSettingsOldFormatCompatibility", "[http-settings][settings][load]
 
     httpcl::Settings settings;
 
-    REQUIRE(settings.settings.size() == 2);
-    REQUIRE(settings.settings[0].scope.has_value());
-    REQUIRE(*settings.settings[0].scope == "https://api.example.com");
-    REQUIRE(settings.settings[0].apiKey.has_value());
-    REQUIRE(*settings.settings[0].apiKey == "oldformat-key");
+    REQUIRE(settings.entries().size() == 2);
+    REQUIRE(settings.entries()[0].scope.has_value());
+    REQUIRE(*settings.entries()[0].scope == "https://api.example.com");
+    REQUIRE(settings.entries()[0].apiKey.has_value());
+    REQUIRE(*settings.entries()[0].apiKey == "oldformat-key");
 }
 
 TEST_CASE("LoadSettingsWithMissingFile", "[http-settings][settings][load]") {
@@ -401,7 +406,7 @@ TEST_CASE("LoadSettingsWithMissingFile", "[http-settings][settings][load]") {
     httpcl::Settings settings;
 
     // Should not throw, should just have empty settings
-    REQUIRE(settings.settings.empty());
+    REQUIRE(settings.entries().empty());
 }
 
 TEST_CASE("LoadSettingsWithEmptyEnvironmentVariable", "[http-settings][settings][load]") {
@@ -411,7 +416,7 @@ TEST_CASE("LoadSettingsWithEmptyEnvironmentVariable", "[http-settings][settings]
     httpcl::Settings settings;
 
     // Should not throw, should just have empty settings
-    REQUIRE(settings.settings.empty());
+    REQUIRE(settings.entries().empty());
 
     test_unsetenv("HTTP_SETTINGS_FILE");
 }
@@ -431,7 +436,7 @@ http-settings:
 
     // Should not throw, should handle error gracefully
     httpcl::Settings settings;
-    REQUIRE(settings.settings.empty());
+    REQUIRE(settings.entries().empty());
 }
 
 // =============================================================================
@@ -448,12 +453,12 @@ TEST_CASE("StoreSettingsToFile", "[http-settings][settings][store]") {
     httpcl::Config config1;
     config1.scope = "https://api1.example.com";
     config1.apiKey = "stored-key1";
-    settings.settings.push_back(config1);
+    settings.edit([&](auto& entries) { entries.push_back(config1); });
 
     httpcl::Config config2;
     config2.scope = "https://api2.example.com";
     config2.apiKey = "stored-key2";
-    settings.settings.push_back(config2);
+    settings.edit([&](auto& entries) { entries.push_back(config2); });
 
     settings.store();
 
@@ -477,7 +482,7 @@ TEST_CASE("StoreWithoutEnvironmentVariable", "[http-settings][settings][store]")
     httpcl::Config config;
     config.scope = "https://api.example.com";
     config.apiKey = "test-key";
-    settings.settings.push_back(config);
+    settings.edit([&](auto& entries) { entries.push_back(config); });
 
     // Should not throw, should just log warning
     REQUIRE_NOTHROW(settings.store());
@@ -639,6 +644,105 @@ http-settings:
     REQUIRE(*config2.apiKey == "updated-key");
 }
 
+#ifdef __linux__
+TEST_CASE("UrlMatchingReloadOnFileChange", "[http-settings][url-matching][reload]") {
+    SettingsTestFixture fixture;
+
+    fixture.writeFile(R"(
+http-settings:
+  - scope: https://api.example.com
+    api-key: original-key
+)");
+    fixture.setEnvironmentVariable();
+
+    httpcl::Settings settings;
+    REQUIRE(*settings["https://api.example.com/endpoint"].apiKey == "original-key");
+
+    // The file watcher reloads the settings in the background.
+    fixture.writeFile(R"(
+http-settings:
+  - scope: https://api.example.com
+    api-key: watched-key
+)");
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (*settings["https://api.example.com/endpoint"].apiKey != "watched-key" &&
+           std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    REQUIRE(*settings["https://api.example.com/endpoint"].apiKey == "watched-key");
+}
+#endif
+
+TEST_CASE("UrlMatchingMixedScopeAndUrlEntriesKeepOrder", "[http-settings][url-matching]") {
+    SettingsTestFixture fixture;
+
+    std::string yaml = R"(
+http-settings:
+  - scope: "*"
+    api-key: global-key
+  - url: https://api\.example\.com/v[0-9]+/.*
+    api-key: regex-key
+  - scope: https://api.example.com/*/users
+    api-key: users-key
+  - scope: https://*.example.com/v1
+    api-key: v1-key
+)";
+
+    fixture.writeFile(yaml);
+    fixture.setEnvironmentVariable();
+
+    httpcl::Settings settings;
+
+    // Later entries override earlier ones, regardless of the entry kind.
+    REQUIRE(*settings["https://api.example.com/v1/users"].apiKey == "v1-key");
+    REQUIRE(*settings["https://api.example.com/v2/users/42"].apiKey == "users-key");
+    REQUIRE(*settings["https://api.example.com/v2/items"].apiKey == "regex-key");
+    REQUIRE(*settings["https://other.org/"].apiKey == "global-key");
+
+    // Wildcards must match the literal parts in order.
+    REQUIRE(*settings["https://api.example.com/users"].apiKey == "global-key");
+}
+
+TEST_CASE("UrlMatchingSeesAddedEntries", "[http-settings][url-matching]") {
+    SettingsTestFixture fixture;
+    fixture.setEnvironmentVariable();
+
+    httpcl::Settings settings;
+    REQUIRE(!settings["https://api.example.com/endpoint"].apiKey.has_value());
+
+    settings.edit([](auto& entries) {
+        entries.emplace_back("scope: https://api.example.com\napi-key: added-key");
+    });
+    auto config = settings["https://api.example.com/endpoint"];
+    REQUIRE(config.apiKey.has_value());
+    REQUIRE(*config.apiKey == "added-key");
+}
+
+TEST_CASE("ReloadWhileInstancesComeAndGo", "[http-settings][reload]") {
+    SettingsTestFixture fixture;
+    fixture.writeFile(R"(
+http-settings:
+  - scope: https://api.example.com
+    api-key: key
+)");
+    fixture.setEnvironmentVariable();
+
+    std::atomic_bool done{false};
+    std::thread reloader([&]{
+        while (!done)
+            httpcl::Settings::updateTimestamp(std::chrono::steady_clock::now());
+    });
+
+    for (auto i = 0; i < 200; ++i) {
+        httpcl::Settings settings;
+        REQUIRE(*settings["https://api.example.com/endpoint"].apiKey == "key");
+    }
+
+    done = true;
+    reloader.join();
+}
+
 // =============================================================================
 // toSafeString Tests
 // =============================================================================
@@ -833,3 +937,165 @@ TEST_CASE("ToSafeStringCombined", "[http-settings][to-safe-string]") {
     REQUIRE(result.find("Query params:") != std::string::npos);
     REQUIRE(result.find("Cookies:") != std::string::npos);
 }
+
+// =============================================================================
+// Keychain Cache Tests
+// =============================================================================
+
+namespace
+{
+
+// Password store which counts queries. Queries wait for `gate` if it is set.
+struct MockKeychain : httpcl::secret::Keychain
+{
+    std::mutex mutex;
+    std::map<std::string, std::string> passwords;
+    std::atomic<int> queries{0};
+    std::optional<std::shared_future<void>> gate;
+
+    std::string getPassword(const std::string& service, const std::string& user) override {
+        ++queries;
+        if (gate)
+            gate->wait_for(std::chrono::seconds(5));
+        std::lock_guard lock(mutex);
+        auto password = passwords.find(service + "/" + user);
+        if (password == passwords.end())
+            throw std::runtime_error("Password not found.");
+        return password->second;
+    }
+
+    void setPassword(const std::string& service, const std::string& user, const std::string& password) override {
+        std::lock_guard lock(mutex);
+        passwords[service + "/" + user] = password;
+    }
+
+    bool deletePassword(const std::string& service, const std::string& user) override {
+        std::lock_guard lock(mutex);
+        return passwords.erase(service + "/" + user) > 0;
+    }
+};
+
+// Installs a MockKeychain for the lifetime of the test
+struct KeychainFixture
+{
+    std::shared_ptr<MockKeychain> keychain = std::make_shared<MockKeychain>();
+
+    KeychainFixture() {
+        keychain->passwords["service/user"] = "secret";
+        httpcl::secret::setKeychain(keychain);
+    }
+
+    ~KeychainFixture() {
+        test_unsetenv("HTTP_KEYCHAIN_CACHE_TTL");
+        httpcl::secret::setKeychain(nullptr);
+    }
+};
+
+}
+
+TEST_CASE("KeychainCacheServesRepeatedLoads", "[http-settings][keychain]") {
+    KeychainFixture fixture;
+
+    REQUIRE(httpcl::secret::load("service", "user") == "secret");
+    REQUIRE(httpcl::secret::load("service", "user") == "secret");
+    REQUIRE(fixture.keychain->queries == 1);
+}
+
+TEST_CASE("KeychainCacheTtlFromEnvironment", "[http-settings][keychain]") {
+    KeychainFixture fixture;
+
+    SECTION("Entries expire after the TTL") {
+        test_setenv("HTTP_KEYCHAIN_CACHE_TTL", "1");
+        REQUIRE(httpcl::secret::load("service", "user") == "secret");
+        REQUIRE(httpcl::secret::load("service", "user") == "secret");
+        REQUIRE(fixture.keychain->queries == 1);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        REQUIRE(httpcl::secret::load("service", "user") == "secret");
+        REQUIRE(fixture.keychain->queries == 2);
+    }
+
+    SECTION("A TTL of 0 disables the cache") {
+        test_setenv("HTTP_KEYCHAIN_CACHE_TTL", "0");
+        httpcl::secret::load("service", "user");
+        httpcl::secret::load("service", "user");
+        REQUIRE(fixture.keychain->queries == 2);
+    }
+}
+
+TEST_CASE("KeychainCacheInvalidatedByWrites", "[http-settings][keychain]") {
+    KeychainFixture fixture;
+    REQUIRE(httpcl::secret::load("service", "user") == "secret");
+
+    SECTION("Store") {
+        REQUIRE(httpcl::secret::store("service", "user", "changed") == "service");
+        REQUIRE(httpcl::secret::load("service", "user") == "changed");
+        REQUIRE(fixture.keychain->queries == 2);
+    }
+
+    SECTION("Remove") {
+        REQUIRE(httpcl::secret::remove("service", "user"));
+        REQUIRE_THROWS_WITH(httpcl::secret::load("service", "user"), "Password not found.");
+        REQUIRE(fixture.keychain->queries == 2);
+    }
+
+    SECTION("A load which overlaps a store does not keep the old password") {
+        std::promise<void> release;
+        fixture.keychain->gate = release.get_future().share();
+        httpcl::secret::clearCache();
+
+        auto overlapping = std::async(std::launch::async, []{ return httpcl::secret::load("service", "user"); });
+        while (fixture.keychain->queries < 2)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        httpcl::secret::store("service", "user", "changed");
+        release.set_value();
+        overlapping.get();
+
+        REQUIRE(httpcl::secret::load("service", "user") == "changed");
+    }
+}
+
+TEST_CASE("KeychainCacheClearedBySettingsFileChange", "[http-settings][keychain]") {
+    KeychainFixture fixture;
+    SettingsTestFixture settingsFixture;
+    settingsFixture.writeFile("http-settings: []\n");
+    settingsFixture.setEnvironmentVariable();
+
+    REQUIRE(httpcl::secret::load("service", "user") == "secret");
+
+    SECTION("Loading settings keeps the cache") {
+        httpcl::Settings settings;
+        httpcl::Settings::updateTimestamp(std::chrono::steady_clock::now());
+        httpcl::Settings::reloadModified();
+        REQUIRE(httpcl::secret::load("service", "user") == "secret");
+        REQUIRE(fixture.keychain->queries == 1);
+    }
+
+    SECTION("A changed settings file clears the cache") {
+        httpcl::Settings settings;
+        settingsFixture.writeFile("http-settings: []\n");
+        fs::last_write_time(settingsFixture.getTempFile(),
+                            fs::last_write_time(settingsFixture.getTempFile()) + std::chrono::seconds(1));
+        httpcl::Settings::reloadModified();
+        REQUIRE(httpcl::secret::load("service", "user") == "secret");
+        REQUIRE(fixture.keychain->queries == 2);
+    }
+}
+
+TEST_CASE("KeychainCacheSharesConcurrentMisses", "[http-settings][keychain]") {
+    KeychainFixture fixture;
+    std::promise<void> release;
+    fixture.keychain->gate = release.get_future().share();
+
+    std::vector<std::future<std::string>> loads;
+    for (auto i = 0; i < 4; ++i)
+        loads.push_back(std::async(std::launch::async, []{ return httpcl::secret::load("service", "user"); }));
+    while (fixture.keychain->queries == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release.set_value();
+
+    for (auto& load : loads)
+        REQUIRE(load.get() == "secret");
+    REQUIRE(fixture.keychain->queries == 1);
+}
@@ -0,0 +1,129 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/load-balancer.hpp"
+#include "httpcl/http-client.hpp"
+
+#include <map>
+#include <thread>
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("LoadBalancer picks servers", "[load-balancer]") {
+    SECTION("Off always returns the preferred server") {
+        LoadBalancer balancer(3, LoadBalancing::Off, 2);
+        for (auto i = 0; i < 10; ++i)
+            REQUIRE(balancer.pick() == 2);
+    }
+
+    SECTION("Round robin cycles through all servers") {
+        LoadBalancer balancer(3, LoadBalancing::RoundRobin);
+        std::map<std::size_t, int> picks;
+        for (auto i = 0; i < 9; ++i)
+            ++picks[balancer.pick()];
+        REQUIRE(picks == std::map<std::size_t, int>{{0, 3}, {1, 3}, {2, 3}});
+    }
+
+    SECTION("Least outstanding avoids busy servers") {
+        LoadBalancer balancer(3, LoadBalancing::LeastOutstanding);
+        balancer.begin(0);
+        balancer.begin(1);
+        REQUIRE(balancer.pick() == 2);
+        balancer.begin(2);
+        balancer.begin(2);
+        auto server = balancer.pick();
+        REQUIRE((server == 0 || server == 1));
+    }
+
+    SECTION("EWMA prefers fast servers") {
+        LoadBalancer balancer(2, LoadBalancing::Ewma);
+        balancer.begin(0);
+        balancer.end(0, 100ms, true);
+        balancer.begin(1);
+        balancer.end(1, 1ms, true);
+        for (auto i = 0; i < 10; ++i)
+            REQUIRE(balancer.pick() == 1);
+        REQUIRE(balancer.stats(0).latency == 100ms);
+    }
+}
+
+TEST_CASE("LoadBalancer demotes failing servers", "[load-balancer]") {
+    LoadBalancer balancer(2, LoadBalancing::RoundRobin);
+    for (auto i = 0u; i < LoadBalancer::unhealthyAfterFailures; ++i) {
+        balancer.begin(0);
+        balancer.end(0, 1ms, false);
+    }
+    REQUIRE_FALSE(balancer.stats(0).healthy);
+    for (auto i = 0; i < 4; ++i)
+        REQUIRE(balancer.pick() == 1);
+
+    SECTION("Recovers after a success") {
+        balancer.begin(0);
+        balancer.end(0, 1ms, true);
+        REQUIRE(balancer.stats(0).healthy);
+        REQUIRE(balancer.stats(0).consecutiveFailures == 0);
+    }
+
+    SECTION("Still sends trial calls to demoted servers") {
+        std::map<std::size_t, int> picks;
+        for (auto i = 0u; i < 2 * LoadBalancer::trialEvery; ++i)
+            ++picks[balancer.pick()];
+        REQUIRE(picks[0] == 2);
+    }
+
+    SECTION("Falls back to unhealthy servers if all are down") {
+        for (auto i = 0u; i < LoadBalancer::unhealthyAfterFailures; ++i) {
+            balancer.begin(1);
+            balancer.end(1, 1ms, false);
+        }
+        auto server = balancer.pick();
+        REQUIRE(server < 2);
+    }
+}
+
+TEST_CASE("LoadBalancer probes servers", "[load-balancer]") {
+    auto client = std::make_shared<MockHttpClient>();
+    std::atomic<int> probes{0};
+    client->getFun = [&](std::string_view uri) {
+        ++probes;
+        return IHttpClient::Result{uri == "https://down" ? 0 : 404, {}};
+    };
+
+    auto balancer = std::make_shared<LoadBalancer>(2, LoadBalancing::RoundRobin);
+    balancer->startProbing(client, {"https://up", "https://down"}, {}, 10ms);
+
+    for (auto i = 0; i < 200 && balancer->stats(1).healthy; ++i)
+        std::this_thread::sleep_for(10ms);
+    REQUIRE(balancer->stats(0).healthy);
+    REQUIRE_FALSE(balancer->stats(1).healthy);
+
+    // Probing stops with the balancer.
+    balancer.reset();
+    std::this_thread::sleep_for(50ms);
+    auto probesAfterReset = probes.load();
+    std::this_thread::sleep_for(50ms);
+    REQUIRE(probes == probesAfterReset);
+}
+
+TEST_CASE("LoadBalancer probes servers in parallel", "[load-balancer]") {
+    auto client = std::make_shared<MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        if (uri == "https://hanging")
+            std::this_thread::sleep_for(300ms);
+        return IHttpClient::Result{uri == "https://down" ? 0 : 404, {}};
+    };
+
+    auto balancer = std::make_shared<LoadBalancer>(2, LoadBalancing::RoundRobin);
+    balancer->startProbing(client, {"https://hanging", "https://down"}, {}, 10ms);
+
+    // Probed one after another, the hanging server would delay each round.
+    auto started = std::chrono::steady_clock::now();
+    while (balancer->stats(1).healthy && std::chrono::steady_clock::now() - started < 1s)
+        std::this_thread::sleep_for(5ms);
+    REQUIRE(std::chrono::steady_clock::now() - started < 250ms);
+    REQUIRE_FALSE(balancer->stats(1).healthy);
+
+    // Let the hanging probe finish before the client goes away.
+    balancer.reset();
+    std::this_thread::sleep_for(350ms);
+}
@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+
+#include "httpcl/retry.hpp"
+#include "httpcl/http-settings.hpp"
+
+using namespace httpcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("Retry backoff grows exponentially up to the limit", "[retry]") {
+    RetryPolicy policy;
+    policy.initialBackoff = 100ms;
+    policy.maxBackoff = 1000ms;
+    policy.multiplier = 2.;
+
+    SECTION("Without jitter") {
+        policy.jitter = 0.;
+        REQUIRE(policy.backoff(1) == 100ms);
+        REQUIRE(policy.backoff(2) == 200ms);
+        REQUIRE(policy.backoff(3) == 400ms);
+        REQUIRE(policy.backoff(5) == 1000ms);
+        REQUIRE(policy.backoff(100) == 1000ms);
+    }
+
+    SECTION("With jitter") {
+        policy.jitter = .5;
+        for (auto i = 0; i < 100; ++i) {
+            auto delay = policy.backoff(2);
+            REQUIRE(delay >= 100ms);
+            REQUIRE(delay <= 200ms);
+        }
+    }
+}
+
+TEST_CASE("Retryable statuses", "[retry]") {
+    RetryPolicy policy;
+    REQUIRE(policy.retryable(0));
+    REQUIRE(policy.retryable(503));
+    REQUIRE(policy.retryable(429));
+    REQUIRE_FALSE(policy.retryable(400));
+    REQUIRE_FALSE(policy.retryable(500));
+}
+
+TEST_CASE("Retry-After is parsed", "[retry]") {
+    REQUIRE(parseRetryAfter("120") == std::chrono::milliseconds(120s));
+    REQUIRE_FALSE(parseRetryAfter(""));
+    REQUIRE_FALSE(parseRetryAfter("soon"));
+
+    // 1994-11-06T08:49:37Z
+    auto now = std::chrono::system_clock::from_time_t(784111777);
+    REQUIRE(parseRetryAfter("Sun, 06 Nov 1994 08:50:07 GMT", now) == std::chrono::milliseconds(30s));
+    REQUIRE(parseRetryAfter("Sun, 06 Nov 1994 08:00:00 GMT", now) == 0ms);
+}
+
+TEST_CASE("Retry settings are read from YAML", "[retry]") {
+    Config config(R"(
+        scope: "*"
+        retry:
+          max-attempts: 5
+          initial-backoff-ms: 50
+          statuses: [503]
+          non-idempotent: true
+          failover: false
+    )");
+
+    REQUIRE(config.retry);
+    REQUIRE(config.retry->maxAttempts == 5);
+    REQUIRE(config.retry->initialBackoff == 50ms);
+    REQUIRE(config.retry->maxBackoff == 10000ms);
+    REQUIRE(config.retry->statuses == std::vector<int>{503});
+    REQUIRE(config.retry->nonIdempotent);
+    REQUIRE_FALSE(config.retry->failover);
+
+    Config reloaded(config.toYaml());
+    REQUIRE(reloaded.retry);
+    REQUIRE(reloaded.retry->maxAttempts == 5);
+    REQUIRE(reloaded.retry->statuses == std::vector<int>{503});
+}
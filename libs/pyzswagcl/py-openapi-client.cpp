@@ -73,7 +73,19 @@ void PyOpenApiClient::bind(py::module_& m) {
             "method_name"_a, "request"_a, "unused"_a)
         .def("config", [](PyOpenApiClient const& self)->OpenAPIConfig const&{
             return self.client_->config_;
-        }, py::return_value_policy::reference_internal);
+        }, py::return_value_policy::reference_internal)
+        .def("hedge_stats", [](PyOpenApiClient const& self) {
+            auto stats = self.client_->hedgeStats();
+            return py::dict("attempts"_a = stats.attempts, "hedges"_a = stats.hedges, "wins"_a = stats.wins);
+        })
+        .def("coalesced_calls", [](PyOpenApiClient const& self) {
+            return self.client_->coalescedCalls();
+        })
+        .def("cache_stats", [](PyOpenApiClient const& self) {
+            auto stats = self.client_->cacheStats();
+            return py::dict("hits"_a = stats.hits, "misses"_a = stats.misses, "evictions"_a = stats.evictions,
+                            "entries"_a = stats.entries, "bytes"_a = stats.bytes);
+        });
 
     py::object serviceClientBase = py::module::import("zserio").attr("ServiceInterface");
     serviceClient.attr("__bases__") = py::make_tuple(serviceClientBase) + serviceClient.attr("__bases__");
@@ -107,7 +119,7 @@ PyOpenApiClient::PyOpenApiClient(std::string const& openApiUrl,
         serverIndex ? *serverIndex : 0);
 }
 
-std::vector<uint8_t> PyOpenApiClient::callMethod(
+py::bytes PyOpenApiClient::callMethod(
         const std::string& methodName,
         py::object request,
         py::object unused)
@@ -123,7 +135,7 @@ std::vector<uint8_t> PyOpenApiClient::callMethod(
             py::buffer_info info(py::buffer(requestData).request());
             auto* data = reinterpret_cast<uint8_t*>(info.ptr);
             auto length = static_cast<size_t>(info.size);
-            return helper.binary(std::vector<uint8_t>(data, data + length));
+            return helper.binary(zserio::Span<const uint8_t>(data, length));
         }
 
         auto parts = stx::split<std::vector<std::string>>(field, ".");
@@ -149,7 +161,5 @@ std::vector<uint8_t> PyOpenApiClient::callMethod(
         return helper.value(valueFromPyObject(value.ptr()));
     });
 
-    std::vector<uint8_t> responseData;
-    responseData.assign(response.begin(), response.end());
-    return responseData;
+    return py::bytes(reinterpret_cast<const char*>(response.data()), response.size());
 }
@@ -21,7 +21,7 @@ public:
                     std::optional<std::string> bearer,
                     std::optional<uint32_t> serverIndex);
 
-    std::vector<uint8_t> callMethod(
+    py::bytes callMethod(
         const std::string& methodName,
         py::object request,
         py::object unused);
@@ -5,6 +5,7 @@
 #include <fstream>
 
 #include "zswagcl/private/openapi-parser.hpp"
+#include "zswagcl/private/openapi-parameter-helper.hpp"
 #include "httpcl/http-settings.hpp"
 #include "py-openapi-client.h"
 #include "stx/format.h"
@@ -146,6 +147,19 @@ PYBIND11_MODULE(pyzswagcl, m)
         return fetchOpenAPIConfig(url, httpClient);
     }, py::return_value_policy::move, "url"_a);
 
+    ///////////////////////////////////////////////////////////////////////////
+    // Buffer Formats
+
+    // Malformed text raises ValueError.
+    m.def("parse_buffer", [](std::string_view text, OpenAPIConfig::Parameter::Format format){
+        try {
+            return py::bytes(impl::parseBuffer(format, text));
+        }
+        catch (std::invalid_argument const& e) {
+            throw py::value_error(e.what());
+        }
+    }, "text"_a, "format"_a);
+
     ///////////////////////////////////////////////////////////////////////////
     // Global Constants
     m.attr("ZSERIO_OBJECT_CONTENT_TYPE") = py::str(ZSERIO_OBJECT_CONTENT_TYPE);
@@ -1,6 +1,8 @@
 import connexion
+import io
 import os
 import inspect
+import zlib
 import zserio
 import sys
 import yaml
@@ -34,13 +36,140 @@ class IncompleteSchemaError(RuntimeError):
         self.fn_name = fn_name
 
 
+# Content codings which are decoded from request bodies.
+# wbits=47 lets zlib detect both the gzip and the zlib (deflate) format.
+DECODED_CONTENT_ENCODINGS = {"gzip", "x-gzip", "deflate"}
+ZLIB_AUTO_DETECT_WBITS = 15 + 32
+ZLIB_RAW_DEFLATE_WBITS = -15
+ZLIB_GZIP_WBITS = 15 + 16
+# Default limit for decoded request bodies, like HTTP_MAX_DECOMPRESSED_SIZE on the client.
+DEFAULT_MAX_DECOMPRESSED_SIZE = 256 * 1024 * 1024
+
+
+# Raised if a request body decodes to more than the allowed size
+class DecompressedSizeError(ValueError):
+    pass
+
+
+def accepts_gzip(accept_encoding: str) -> bool:
+    for coding in accept_encoding.split(","):
+        name, *params = [part.strip().lower() for part in coding.split(";")]
+        if name not in ("gzip", "*"):
+            continue
+        for param in params:
+            key, _, value = param.partition("=")
+            if key.strip() == "q":
+                try:
+                    return float(value) > 0
+                except ValueError:
+                    return False
+        return True
+    return False
+
+
+class ContentEncodingMiddleware:
+    """
+    WSGI middleware which decodes gzip/deflate request bodies, as sent
+    by clients with `compression.request` in their http-settings.
+    If `min_size` is given, responses of at least that many bytes
+    are gzip-compressed for clients which accept it. Request bodies
+    which decode to more than `max_size` bytes are rejected with 413,
+    to guard against decompression bombs (None or 0 disables the limit).
+    """
+
+    def __init__(self, app, min_size: int = None, max_size: int = DEFAULT_MAX_DECOMPRESSED_SIZE):
+        self.app = app
+        self.min_size = min_size
+        self.max_size = max_size
+
+    def __call__(self, environ, start_response):
+        encoding = environ.get("HTTP_CONTENT_ENCODING", "").strip().lower()
+        if encoding in DECODED_CONTENT_ENCODINGS:
+            try:
+                body = self.decode_body(environ, encoding)
+            except DecompressedSizeError:
+                start_response("413 Payload Too Large", [("Content-Type", "text/plain")])
+                return [f"Decoded request body exceeds {self.max_size} bytes.".encode()]
+            if body is None:
+                start_response("400 Bad Request", [("Content-Type", "text/plain")])
+                return [f"Could not decode {encoding} request body.".encode()]
+            environ["wsgi.input"] = io.BytesIO(body)
+            environ["CONTENT_LENGTH"] = str(len(body))
+            del environ["HTTP_CONTENT_ENCODING"]
+
+        if self.min_size is None or not accepts_gzip(environ.get("HTTP_ACCEPT_ENCODING", "")):
+            return self.app(environ, start_response)
+        return self.compress_response(environ, start_response)
+
+    def decode_body(self, environ, encoding: str):
+        length = int(environ.get("CONTENT_LENGTH") or 0)
+        body = environ["wsgi.input"].read(length) if length else environ["wsgi.input"].read()
+        try:
+            return self.decompress(body, ZLIB_AUTO_DETECT_WBITS)
+        except zlib.error:
+            pass
+        if encoding == "deflate":
+            # Some clients send raw deflate streams without zlib header.
+            try:
+                return self.decompress(body, ZLIB_RAW_DEFLATE_WBITS)
+            except zlib.error:
+                pass
+        return None
+
+    def decompress(self, body: bytes, wbits: int) -> bytes:
+        decompressor = zlib.decompressobj(wbits)
+        if not self.max_size:
+            result = decompressor.decompress(body)
+        else:
+            # Stop inflating one byte past the limit, instead of expanding a bomb.
+            result = decompressor.decompress(body, self.max_size + 1)
+            if decompressor.unconsumed_tail or len(result) > self.max_size:
+                raise DecompressedSizeError()
+        if not decompressor.eof:
+            raise zlib.error("Truncated stream")
+        return result
+
+    def compress_response(self, environ, start_response):
+        response = {}
+        chunks = []
+
+        def buffering_start_response(status, headers, exc_info=None):
+            response["status"] = status
+            response["headers"] = headers
+            response["exc_info"] = exc_info
+            return chunks.append
+
+        result = self.app(environ, buffering_start_response)
+        try:
+            chunks.extend(result)
+        finally:
+            if hasattr(result, "close"):
+                result.close()
+
+        body = b"".join(chunks)
+        headers = response["headers"]
+        already_encoded = any(k.lower() == "content-encoding" for k, _ in headers)
+        if not already_encoded and len(body) >= self.min_size:
+            compressor = zlib.compressobj(wbits=ZLIB_GZIP_WBITS)
+            body = compressor.compress(body) + compressor.flush()
+            headers = [(k, v) for k, v in headers if k.lower() != "content-length"]
+            headers += [
+                ("Content-Encoding", "gzip"),
+                ("Content-Length", str(len(body))),
+                ("Vary", "Accept-Encoding")]
+        start_response(response["status"], headers, response["exc_info"])
+        return [body]
+
+
 class OAServer(connexion.App):
 
     def __init__(self, *,
                  controller_module,
                  service_type: Type[zserio.ServiceInterface],
                  zs_pkg_path: str = None,
-                 yaml_path: str = None):
+                 yaml_path: str = None,
+                 compression_min_size: int = None,
+                 max_decompressed_size: int = DEFAULT_MAX_DECOMPRESSED_SIZE):
         """
         Brief
 
@@ -56,6 +185,11 @@ class OAServer(connexion.App):
 
             Documentation for the service is automatically extracted if `zs_pkg_path` is issued.
 
+            Request bodies with gzip/deflate Content-Encoding are always decoded. Responses of
+            at least `compression_min_size` bytes are gzip-compressed if the client accepts it.
+            Requests whose body decodes to more than `max_decompressed_size` bytes (default
+            256 MiB, None or 0 for unlimited) are rejected with status 413.
+
         Code example
 
             In file my.app.__init__:
@@ -200,6 +334,10 @@ class OAServer(connexion.App):
             arguments={"title": f"REST API for {service_type.__name__}"},
             pythonic_params=False)
 
+        # Decode compressed request bodies, and optionally compress responses.
+        self.app.wsgi_app = ContentEncodingMiddleware(
+            self.app.wsgi_app, compression_min_size, max_decompressed_size)
+
     def verify_openapi_schema(self):
         for method_name in self.service_instance.method_names:
             if method_name not in self.spec:
@@ -1,11 +1,10 @@
 import inspect
-import base64
 import zserio
 import struct
 import functools
 from enum import Enum
 from typing import Type, Tuple, Any, Dict, Union, Optional, List, get_type_hints, Iterator
-from .pyzswagcl import OAMethod, OAParam, OAParamFormat, ZSERIO_REQUEST_PART_WHOLE
+from .pyzswagcl import OAMethod, OAParam, OAParamFormat, ZSERIO_REQUEST_PART_WHOLE, parse_buffer
 from re import compile as re
 from zserio.typeinfo import TypeInfo, MemberInfo, TypeAttribute, MemberAttribute
 
@@ -164,12 +163,8 @@ def instantiate(t: Type) -> Any:
 
 # Get a byte buffer from a string which is encoded in a given format
 def str_to_bytes(s: str, fmt: OAParamFormat) -> bytes:
-    if fmt == OAParamFormat.BASE64:
-        return base64.b64decode(s)
-    elif fmt == OAParamFormat.BASE64URL:
-        return base64.urlsafe_b64decode(s)
-    elif fmt == OAParamFormat.HEX:
-        return bytes.fromhex(s)
+    if fmt in (OAParamFormat.BASE64, OAParamFormat.BASE64URL, OAParamFormat.HEX):
+        return parse_buffer(s, fmt)
     else:  # if fmt in (OAParamFormat.BINARY, OAParamFormat.STRING):
         return bytes(s, encoding="raw_unicode_escape")
 
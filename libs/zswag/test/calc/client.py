@@ -1,8 +1,13 @@
 from enum import Enum
 import calculator.api as api
 from zswag import OAClient, HTTPConfig
+from zswag.pyzswagcl import parse_buffer, OAParamFormat
 import json
 import pickle
+import urllib.error
+import urllib.request
+import zlib
+import zserio
 
 def run(host, port):
 
@@ -15,6 +20,15 @@ def run(host, port):
     config_pickled = pickle.dumps(HTTPConfig().header("x", "42"))
     assert pickle.loads(config_pickled)
 
+    # Make sure that malformed base64 is rejected instead of truncated
+    assert parse_buffer("QUI=", OAParamFormat.BASE64) == b"AB"
+    for malformed in ("QUI", "QU*=", "Q===", "QUI=QUI="):
+        try:
+            parse_buffer(malformed, OAParamFormat.BASE64)
+            raise AssertionError(f"Malformed base64 {malformed!r} was accepted!")
+        except ValueError:
+            pass
+
     def run_test(aspect, request, fn, expect, auth_args):
         nonlocal counter, failed
         counter += 1
@@ -123,6 +137,70 @@ def run(host, port):
             "config": HTTPConfig().api_key("42")
         })
 
+    def run_encoding_test(aspect, body, content_encoding, accept_encoding, expect_status, expect_body):
+        nonlocal counter, failed
+        counter += 1
+        try:
+            print(f"[py-test-client] Test#{counter}: {aspect}", flush=True)
+            headers = {
+                "Content-Type": "application/x-zserio-object",
+                "Content-Encoding": content_encoding,
+                "Cookie": "api-cookie=42"}
+            if accept_encoding:
+                headers["Accept-Encoding"] = accept_encoding
+            request = urllib.request.Request(
+                f"http://{host}:{port}/identity", data=body, headers=headers, method="POST")
+            try:
+                with urllib.request.urlopen(request) as response:
+                    status, response_encoding, response_body = \
+                        response.status, response.headers.get("Content-Encoding"), response.read()
+            except urllib.error.HTTPError as e:
+                status, response_encoding, response_body = e.code, None, e.read()
+            if status != expect_status:
+                raise ValueError(f"Expected status {expect_status}, got {status}!")
+            if response_encoding == "gzip":
+                response_body = zlib.decompress(response_body, 15 + 16)
+            elif accept_encoding and status == 200:
+                raise ValueError("Expected a gzip-encoded response!")
+            if expect_body is not None and response_body != expect_body:
+                raise ValueError(f"Expected {expect_body!r}, got {response_body!r}!")
+            print(f"[py-test-client]   -> Success.", flush=True)
+        except Exception as e:
+            failed += 1
+            print(f"[py-test-client]   -> ERROR: {str(e) or type(e).__name__}", flush=True)
+
+    # The server is run with compression_min_size and max_decompressed_size, see run_calc.py
+    blob = zserio.serialize_to_bytes(api.Double(1.))
+    gzip_compressor = zlib.compressobj(wbits=15 + 16)
+    raw_compressor = zlib.compressobj(wbits=-15)
+
+    run_encoding_test(
+        "Decode gzip request body, gzip response.",
+        gzip_compressor.compress(blob) + gzip_compressor.flush(),
+        "gzip", "gzip", 200, blob)
+
+    run_encoding_test(
+        "Decode deflate request body, plain response.",
+        zlib.compress(blob),
+        "deflate", None, 200, blob)
+
+    run_encoding_test(
+        "Decode raw deflate request body.",
+        raw_compressor.compress(blob) + raw_compressor.flush(),
+        "deflate", "gzip;q=1.0", 200, blob)
+
+    run_encoding_test(
+        "Reject corrupt gzip request body.",
+        b"not compressed",
+        "gzip", None, 400, None)
+
+    # The server limits decoded request bodies to 1 MiB.
+    bomb_compressor = zlib.compressobj(wbits=15 + 16)
+    run_encoding_test(
+        "Reject gzip request body which decodes to more than the limit.",
+        bomb_compressor.compress(bytes(16 * 1024 * 1024)) + bomb_compressor.flush(),
+        "gzip", None, 413, None)
+
     if failed > 0:
         print(f"[py-test-client] Done, {failed} test(s) failed!", flush=True)
         exit(1)
@@ -49,6 +49,8 @@ def main() -> int:
             service_type=calculator.Calculator.Service,
             yaml_path=str(calc_dir / "api.yaml"),
             zs_pkg_path=str(calc_dir),
+            compression_min_size=1,
+            max_decompressed_size=1024 * 1024,
         )
         app.run(host=host, port=port)
         return 0
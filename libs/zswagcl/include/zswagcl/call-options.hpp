@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+
+#include "httpcl/http-settings.hpp"
+#include "httpcl/executor.hpp"
+
+namespace zswagcl
+{
+
+/**
+ * Options for a single call. A pointer to them may be passed
+ * as the `context` argument of OAClient::callMethod.
+ */
+struct CallOptions
+{
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Point in time by which the call must be done, including
+     * authentication, retries and backoff. Overrides the method's
+     * `x-zswag-timeout`.
+     */
+    std::optional<Clock::time_point> deadline;
+
+    /** Aborts the call, including requests in flight, when cancelled. */
+    std::shared_ptr<httpcl::CancellationToken> cancellation;
+
+    /** Additional headers for the call. */
+    httpcl::Headers headers;
+
+    /** Scheduling class of the call's tasks on the shared worker pool. */
+    httpcl::Priority priority = httpcl::Priority::Normal;
+
+    /** Set the deadline relative to now. */
+    CallOptions& timeout(Clock::duration timeout)
+    {
+        deadline = Clock::now() + timeout;
+        return *this;
+    }
+};
+
+}
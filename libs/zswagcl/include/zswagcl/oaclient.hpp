@@ -2,7 +2,16 @@
 
 #include <zserio/IService.h>
 
+#include <exception>
+#include <future>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "private/openapi-client.hpp"
+#include "call-options.hpp"
+#include "response-buffer.hpp"
 #include "httpcl/http-client.hpp"
 
 namespace zswagcl
@@ -17,13 +26,96 @@ public:
         httpcl::Config httpConfig = {},
         uint32_t serverIndex = 0);
 
+    /**
+     * Call a service method. `context` may be null, or point
+     * to the CallOptions for this call.
+     */
     std::vector<uint8_t> callMethod(
         zserio::StringView methodName,
         zserio::IServiceData const& requestData,
         void* context) override;
 
+    /**
+     * Like callMethod, but returns the response without copying it,
+     * so that a zserio::BitStreamReader can read it in place.
+     */
+    ResponseBuffer callMethodBuffer(
+        zserio::StringView methodName,
+        zserio::IServiceData const& requestData,
+        CallOptions const& options = {});
+
+    /**
+     * Receives either the response data, or the error
+     * which was thrown while executing the request.
+     */
+    using Completion = std::function<void(std::vector<uint8_t> /* response */, std::exception_ptr /* error */)>;
+
+    /**
+     * Call a service method without blocking on the response. The request
+     * is serialized before this function returns, so `requestData` does not
+     * need to outlive the call. The OAClient itself must outlive it.
+     */
+    std::future<std::vector<uint8_t>> callMethodAsync(
+        zserio::StringView methodName,
+        zserio::IServiceData const& requestData,
+        CallOptions const& options = {});
+
+    /**
+     * Same as above, but calls `completion` on a worker
+     * thread once the request finished or failed.
+     */
+    void callMethodAsync(
+        zserio::StringView methodName,
+        zserio::IServiceData const& requestData,
+        Completion completion,
+        CallOptions const& options = {});
+
+    /**
+     * Counters for hedged requests, see OpenAPIClient::hedgeStats().
+     */
+    OpenAPIClient::HedgeStats hedgeStats() const { return client_.hedgeStats(); }
+
+    /**
+     * Load and health of the servers, see OpenAPIClient::loadBalancer().
+     */
+    const httpcl::LoadBalancer& loadBalancer() const { return client_.loadBalancer(); }
+
+    /**
+     * Number of coalesced calls, see OpenAPIClient::coalescedCalls().
+     */
+    uint64_t coalescedCalls() const { return client_.coalescedCalls(); }
+
+    /**
+     * Counters of the response cache, see OpenAPIClient::cacheStats().
+     */
+    ResponseCache::Stats cacheStats() const { return client_.cacheStats(); }
+
 private:
+    /**
+     * Resolution of an `x-zserio-request-part` path for one request type,
+     * compiled on first use: The members to walk, and the encoder
+     * which was selected for the type of the last one.
+     */
+    struct FieldAccessor
+    {
+        using Encoder = ParameterValue (*)(zserio::IReflectableConstPtr const&, ParameterValueHelper&);
+
+        struct Step {
+            std::string name;
+            bool isFunction = false;
+        };
+
+        std::vector<Step> steps;
+        Encoder encode = nullptr;
+    };
+
+    FieldAccessor const& accessor(zserio::ITypeInfo const& type, std::string const& field);
+    OpenAPIClient::ParameterCallback makeParameterCallback(zserio::IServiceData const& requestData);
+
     OpenAPIClient client_;
+
+    std::shared_mutex accessorsMutex_;
+    std::unordered_map<zserio::ITypeInfo const*, std::unordered_map<std::string, FieldAccessor>> accessors_;
 };
 
 }
@@ -1,14 +1,27 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "openapi-parser.hpp"
 #include "openapi-config.hpp"
 #include "openapi-parameter-helper.hpp"
 #include "openapi-security.hpp"
+#include "response-cache.hpp"
+#include "zswagcl/call-options.hpp"
+#include "zswagcl/response-buffer.hpp"
 
 #include "httpcl/uri.hpp"
 #include "httpcl/http-client.hpp"
+#include "httpcl/executor.hpp"
+#include "httpcl/load-balancer.hpp"
+#include "httpcl/circuit-breaker.hpp"
+#include "httpcl/hedging.hpp"
 
 namespace zswagcl
 {
@@ -20,31 +33,298 @@ public:
     httpcl::Config httpConfig_;
     AuthRegistry authHandlers_;
 
+    /**
+     * Whether requests run on the calling thread or on the shared
+     * worker pool. Initialized from HTTP_EXECUTION_POLICY.
+     */
+    httpcl::ExecutionPolicy executionPolicy_ = httpcl::executionPolicyFromEnv();
+
     OpenAPIClient(OpenAPIConfig config,
                   httpcl::Config httpConfig,
                   std::unique_ptr<httpcl::IHttpClient> client,
                   uint32_t serverIndex = 0);
     ~OpenAPIClient();
 
+    using ParameterCallback = std::function<ParameterValue(const std::string&, /* parameter identifier */
+                                                           const std::string&, /* zserio request part path */
+                                                           ParameterValueHelper&)>;
+
+    /**
+     * Receives either the response buffer, or the error
+     * which was thrown while executing the request.
+     */
+    using Completion = std::function<void(ResponseBuffer /* response */, std::exception_ptr /* error */)>;
+
     /**
      * Call OpenAPI method.
      *
      * The callback `fun` is called for each URL and request parameter of the
      * method.
      *
-     * @param method  OpenAPI method identifier.
-     * @param fun     Parameter resolve function.
+     * @param method   OpenAPI method identifier.
+     * @param fun      Parameter resolve function.
+     * @param options  Deadline, cancellation, headers and priority of the call.
      * @return Response buffer.
      */
-    std::string call(const std::string& method,
-                     const std::function<ParameterValue(const std::string&, /* parameter identifier */
-                                                        const std::string&, /* zserio request part path */
-                                                        ParameterValueHelper&)>& fun);
+    ResponseBuffer call(const std::string& method,
+                        const std::function<ParameterValue(const std::string&, /* parameter identifier */
+                                                           const std::string&, /* zserio request part path */
+                                                           ParameterValueHelper&)>& fun,
+                        const CallOptions& options = {});
+
+    /**
+     * Call OpenAPI method without blocking on the response.
+     *
+     * Like for `call`, `fun` is invoked for all parameters before this
+     * function returns, so it may reference the caller's request data. Errors
+     * during parameter resolution are thrown directly. The request is then
+     * executed on the shared httpcl::ThreadPool, so the client must outlive
+     * all pending calls. Each call occupies a worker for its HTTP round
+     * trip, so at most HTTP_WORKER_THREADS calls are in flight at once,
+     * and further calls are queued. Waiting for a retry does not occupy
+     * a worker, and hedged duplicates run on threads of their own.
+     *
+     * @param method   OpenAPI method identifier.
+     * @param fun      Parameter resolve function.
+     * @param options  Deadline, cancellation, headers and priority of the call.
+     * @return Future for the response buffer.
+     */
+    std::future<ResponseBuffer> callAsync(const std::string& method,
+                                          const ParameterCallback& fun,
+                                          const CallOptions& options = {});
+
+    /**
+     * Same as above, but calls `completion` on a worker thread
+     * once the request finished or failed.
+     */
+    void callAsync(const std::string& method,
+                   const ParameterCallback& fun,
+                   Completion completion,
+                   const CallOptions& options = {});
+
+    /**
+     * Distributes calls across the servers of the spec, as configured by
+     * HTTP_LOAD_BALANCING. Without load balancing, all calls go to the
+     * server which was passed to the constructor.
+     */
+    const httpcl::LoadBalancer& loadBalancer() const { return *balancer_; }
+
+    struct HedgeStats {
+        /** Attempts which were eligible for hedging. */
+        uint64_t attempts = 0;
+        /** Duplicates which were sent. */
+        uint64_t hedges = 0;
+        /** Attempts which were answered by a duplicate. */
+        uint64_t wins = 0;
+    };
+
+    /**
+     * Counters for hedged requests, to weigh the extra
+     * load against the saved latency.
+     */
+    HedgeStats hedgeStats() const;
+
+    /**
+     * Number of calls which were answered by an identical call
+     * that was already in flight, see `x-zswag-coalesce`.
+     */
+    uint64_t coalescedCalls() const { return coalescedCalls_; }
+
+    /**
+     * Counters of the response cache, see `x-zswag-cache-ttl`.
+     */
+    ResponseCache::Stats cacheStats() const { return responseCache_.stats(); }
 
 private:
-    std::unique_ptr<httpcl::IHttpClient> client_;
+    /**
+     * Immutable per-method state, compiled once at construction,
+     * so that a call only needs to fill in the parameter values.
+     */
+    struct CallPlan {
+        using HttpMethodFun = httpcl::IHttpClient::Result (httpcl::IHttpClient::*)(
+            const std::string&, const httpcl::OptionalBodyAndContentType&, const httpcl::Config&);
+
+        /**
+         * Piece of the path template: Either literal text, or a parameter
+         * slot. Slots for undeclared parameters have no `parameter`,
+         * and fail when the method is called.
+         */
+        struct PathSegment {
+            bool isSlot = false;
+            std::string text;  // Literal text or parameter identifier
+            const OpenAPIConfig::Parameter* parameter = nullptr;
+        };
+
+        const OpenAPIConfig::Path* method = nullptr;
+        std::vector<PathSegment> pathSegments;
+        /**
+         * Encoded path and query for each server, if the
+         * template has no parameters. Empty otherwise.
+         */
+        std::vector<std::string> staticPathAndQuery;
+        std::vector<const OpenAPIConfig::Parameter*> queryParameters;
+        std::vector<const OpenAPIConfig::Parameter*> headerParameters;
+        /** Method-specific or default security alternatives. */
+        const OpenAPIConfig::SecurityAlternatives* security = nullptr;
+        /** Member function for methods with body, null for GET. */
+        HttpMethodFun httpMethodFun = nullptr;
+        bool supportedHttpMethod = true;
+        /** Observed latencies for percentile-based hedging. Thread-safe. */
+        std::unique_ptr<httpcl::LatencyWindow> latencies;
+    };
+
+    CallPlan compile(const OpenAPIConfig::Path& method) const;
+
+    /**
+     * Call with resolved parameters, which is not yet bound to a
+     * server, so that retries may fail over to another one.
+     */
+    struct Request {
+        const CallPlan* plan = nullptr;
+        /** Path with parameters, if the plan has no static path. */
+        std::string path;
+        std::string debugContext;
+        /**
+         * Headers and query parameters which were filled in by the
+         * caller, and the call's deadline and cancellation token.
+         */
+        httpcl::Config parameters;
+        httpcl::OptionalBodyAndContentType body;
+        httpcl::Priority priority = httpcl::Priority::Normal;
+        /** Set if responses are cached. */
+        std::optional<std::chrono::seconds> cacheTtl;
+        /** Key of identical requests, if they are cached or coalesced. */
+        std::string key;
+    };
+
+    /** Resolve all parameters of the method on the calling thread. */
+    Request prepare(const std::string& method, const ParameterCallback& fun, const CallOptions& options);
+
+    /**
+     * Throw a CancelledError or DeadlineExceededError
+     * if the request must not continue.
+     */
+    void checkLimits(Request const& request) const;
+
+    /** Progress of a request across its attempts, see `sendOnce()`. */
+    struct Attempts {
+        /** Policies of the call, decided by the first attempt. */
+        std::optional<httpcl::RetryPolicy> policy;
+        std::optional<httpcl::HedgePolicy> hedge;
+        bool idempotent = false;
+        uint32_t server = 0;
+        uint32_t number = 0;
+        /** Time to wait before the next attempt. */
+        std::chrono::milliseconds delay{0};
+    };
+
+    /**
+     * Send the request, retrying according to the effective retry
+     * policy. Blocks the calling thread between attempts.
+     */
+    ResponseBuffer send(Request& request);
+
+    /**
+     * Like `send()`, but called on a pool worker, which is not blocked
+     * between attempts: The next attempt is scheduled on the shared
+     * Timer, or started early if the call is cancelled meanwhile.
+     * `completion` is called on a worker thread.
+     */
+    void sendAsync(std::shared_ptr<Request> request,
+                   std::shared_ptr<Attempts> attempts,
+                   Completion completion);
+
+    /**
+     * Make the next attempt. Returns the response, or an empty optional
+     * if the request should be repeated after `attempts.delay`.
+     * Throws if the request failed for good.
+     */
+    std::optional<ResponseBuffer> sendOnce(Request& request, Attempts& attempts);
+
+    /** Request bound to a server. */
+    struct Target {
+        uint32_t server = 0;
+        std::string uri;
+        httpcl::Config httpConfig;
+        /** Set if the http-settings enable a circuit breaker. */
+        std::shared_ptr<httpcl::CircuitBreaker> breaker;
+    };
+
+    /**
+     * Resolve the http-settings for sending the request to `server`.
+     * Returns an empty optional if the circuit for the server is open.
+     */
+    std::optional<Target> resolve(Request const& request, uint32_t server);
+
+    /**
+     * Apply security schemes and execute a single attempt. The outcome
+     * is reported to the load balancer and the target's circuit breaker.
+     */
+    httpcl::IHttpClient::Result attempt(Request const& request, Target& target);
+
+    /**
+     * Execute an attempt on the shared ThreadPool. Unless it is answered
+     * within the policy's delay, duplicates are sent to other servers,
+     * at most one per server, and the first definitive response wins.
+     * The other duplicates are cancelled, or dropped if not sent yet.
+     */
+    httpcl::IHttpClient::Result hedgedAttempt(Request const& request,
+                                              Target& primary,
+                                              httpcl::HedgePolicy const& policy);
+
+    std::string buildUri(Request const& request, uint32_t server) const;
+
+    /**
+     * Call which concurrent identical calls share, if the
+     * method enables coalescing. Each one gets the response.
+     */
+    struct Flight {
+        std::mutex mutex;
+        std::condition_variable landed;
+        bool finished = false;
+        ResponseBuffer response;
+        std::exception_ptr error;
+        uint32_t followers = 0;
+        /** Completions of async followers. */
+        std::vector<Completion> completions;
+    };
+
+    /** Whether the request may share a flight with identical ones. */
+    bool coalescable(Request const& request) const;
+
+    /** Key of identical requests: Method, path, query, headers and body. */
+    static std::string requestKey(Request const& request);
+
+    /**
+     * Join the flight for `key`, or start it if there is none,
+     * in which case the caller must call `land()` when done.
+     */
+    std::pair<std::shared_ptr<Flight>, bool /* leader */> board(std::string const& key);
+
+    /** Hand the outcome of a flight to its followers. */
+    void land(std::string const& key, Flight& flight, ResponseBuffer const& response, std::exception_ptr error);
+
+    std::shared_ptr<httpcl::IHttpClient> client_;
     httpcl::Settings settings_;
-    httpcl::URIComponents server_;
+    /** Index of the server which receives calls without load balancing. */
+    uint32_t serverIndex_ = 0;
+    std::vector<std::string> serverHosts_;
+    std::shared_ptr<httpcl::LoadBalancer> balancer_;
+    std::unordered_map<std::string, CallPlan> plans_;
+
+    std::mutex flightsMutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+    std::atomic<uint64_t> coalescedCalls_{0};
+
+    ResponseCache responseCache_{ResponseCache::maxBytesFromEnv()};
+
+    std::atomic<uint64_t> hedgeAttempts_{0};
+    std::atomic<uint64_t> hedges_{0};
+    std::atomic<uint64_t> hedgeWins_{0};
+    /** Hedged attempts which are still running, awaited on destruction. */
+    std::mutex hedgeTasksMutex_;
+    std::condition_variable hedgeTasksDone_;
+    uint32_t hedgeTasks_ = 0;
 };
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <map>
@@ -226,6 +227,49 @@ struct OpenAPIConfig
          * Optional security schemes override for the global default.
          */
         std::optional<SecurityAlternatives> security;
+
+        /**
+         * Whether repeating the request is safe. Defaults to true for
+         * GET, PUT and DELETE. Overridden by `x-zswag-idempotent`.
+         */
+        bool idempotent = false;
+
+        /**
+         * Whether duplicates of the request may be in flight at the same
+         * time (hedging). Concurrent PUTs or DELETEs may race, so this is
+         * only true for GET, or with an explicit `x-zswag-idempotent: true`.
+         */
+        bool hedgeable = false;
+
+        /**
+         * Optional retry policy from `x-zswag-retry`. A `retry`
+         * entry in the http-settings takes precedence.
+         */
+        std::optional<httpcl::RetryPolicy> retry;
+
+        /**
+         * Optional hedge policy from `x-zswag-hedge`. A `hedge`
+         * entry in the http-settings takes precedence.
+         */
+        std::optional<httpcl::HedgePolicy> hedge;
+
+        /**
+         * Default time budget for a call, from `x-zswag-timeout` (in
+         * seconds). A deadline in the CallOptions takes precedence.
+         */
+        std::optional<std::chrono::milliseconds> timeout;
+
+        /**
+         * Whether concurrent identical calls share one request,
+         * from `x-zswag-coalesce`.
+         */
+        bool coalesce = false;
+
+        /**
+         * How long responses are cached, from `x-zswag-cache-ttl` (in
+         * seconds). A `cache-ttl` in the http-settings takes precedence.
+         */
+        std::optional<std::chrono::seconds> cacheTtl;
     };
 
     /**
@@ -2,17 +2,42 @@
 
 #include "openapi-security.hpp"
 
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+
 namespace zswagcl
 {
 
+/**
+ * Obtains tokens with the OAuth2 client-credentials grant and caches
+ * them per token endpoint, client, audience and scopes. Once a share of
+ * a token's lifetime has passed (oauth2.refreshAfter), it is renewed on
+ * the shared worker pool, while requests keep using it. Only requests
+ * which find no token or an expired one wait for the token endpoint.
+ *
+ * At most one token request per key is in flight. Concurrent callers
+ * for that key wait for its result, and no lock is held while waiting,
+ * so requests for other keys are not delayed. A token request is bound
+ * to the deadline and cancellation of the caller which runs it. If it is
+ * aborted by them, waiters with budget left start a new one. A queued
+ * background refresh is run by the first caller which needs its result,
+ * rather than waiting for a free worker.
+ */
 class OAuth2ClientCredentialsHandler final : public ISecurityHandler
 {
 public:
+    ~OAuth2ClientCredentialsHandler() override;
+
     bool satisfy(
         const OpenAPIConfig::SecurityRequirement& req,
         AuthContext const& ctx,
         std::string& mismatchReason) override;
 
+    void waitForBackgroundTasks() override;
+
 private:
     // OAuth2 grant type constants
     static constexpr const char* GRANT_TYPE_CLIENT_CREDENTIALS = "client_credentials";
@@ -42,10 +67,55 @@ private:
         std::string accessToken;
         std::string refreshToken;  // may be empty (most CC flows don’t return one)
         std::chrono::steady_clock::time_point expiresAt;
+        // Once passed, the token is renewed in the background
+        std::chrono::steady_clock::time_point refreshAt = std::chrono::steady_clock::time_point::max();
     };
 
+    struct PendingRequest
+    {
+        std::shared_ptr<std::promise<MintedToken>> promise;
+        std::shared_future<MintedToken> result;
+        std::string refreshToken;
+        // False while a background refresh waits for a worker
+        bool started = false;
+    };
+
+    // Guards cache_ and pending_, never held across a token request
     std::shared_mutex m_;
     std::unordered_map<TokenKey, MintedToken, TokenKeyHash> cache_;
+    // Token requests which are in flight or queued, by key
+    std::unordered_map<TokenKey, PendingRequest, TokenKeyHash> pending_;
+
+    std::mutex backgroundTasksMutex_;
+    std::condition_variable backgroundTasksDone_;
+    uint32_t backgroundTasks_ = 0;
+
+    // Renew the token for `key` on the shared worker pool, unless that already happens
+    void startBackgroundRefresh(
+        const TokenKey& key,
+        AuthContext const& ctx,
+        const httpcl::Config::OAuth2& oauthConfig,
+        const std::string& refreshUrl,
+        const std::vector<std::string>& scopes);
+
+    // Run renewToken() for a request registered in pending_, then store and publish the result
+    void renew(
+        std::shared_ptr<std::promise<MintedToken>> const& promise,
+        const TokenKey& key,
+        AuthContext const& httpCtx,
+        const httpcl::Config::OAuth2& oauthConfig,
+        const std::string& refreshUrl,
+        const std::vector<std::string>& scopes,
+        const std::string& refreshToken);
+
+    // Refresh the token if there is a refresh token, otherwise (or if that fails) mint a new one
+    MintedToken renewToken(
+        AuthContext const& httpCtx,
+        const httpcl::Config::OAuth2& oauthConfig,
+        const std::string& tokenUrl,
+        const std::string& refreshUrl,
+        const std::vector<std::string>& scopes,
+        const std::string& refreshToken) const;
 
     // Method for both token fetch and refresh requests
     MintedToken requestToken(
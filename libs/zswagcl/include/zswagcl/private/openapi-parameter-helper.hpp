@@ -8,10 +8,18 @@
 #include <variant>
 #include <sstream>
 #include <array>
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+#include <string_view>
 
 #include "stx/string.h"
 #include "zserio/Span.h"
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <stdlib.h>
+#endif
+
 namespace zswagcl
 {
 
@@ -25,56 +33,108 @@ namespace impl
 
 using Format = OpenAPIConfig::Parameter::Format;
 
+/** Reverse the byte order of an unsigned integer */
+inline std::uint8_t byteswap(std::uint8_t v) { return v; }
+#if defined(_MSC_VER) && !defined(__clang__)
+inline std::uint16_t byteswap(std::uint16_t v) { return _byteswap_ushort(v); }
+inline std::uint32_t byteswap(std::uint32_t v) { return _byteswap_ulong(v); }
+inline std::uint64_t byteswap(std::uint64_t v) { return _byteswap_uint64(v); }
+#else
+inline std::uint16_t byteswap(std::uint16_t v) { return __builtin_bswap16(v); }
+inline std::uint32_t byteswap(std::uint32_t v) { return __builtin_bswap32(v); }
+inline std::uint64_t byteswap(std::uint64_t v) { return __builtin_bswap64(v); }
+#endif
+
+/** Unsigned integer type of the same size as `_Type` */
+template <class _Type>
+using UnsignedOfSize = std::conditional_t<sizeof(_Type) == 1, std::uint8_t,
+                       std::conditional_t<sizeof(_Type) == 2, std::uint16_t,
+                       std::conditional_t<sizeof(_Type) == 4, std::uint32_t, std::uint64_t>>>;
+
 /** Convert host to big endian */
 template <class _Type>
 static _Type htobe(_Type v)
 {
     static_assert(std::is_arithmetic_v<_Type>);
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-    for (int i = 0u; i < sizeof(v) / 2u; ++i)
-        std::swap(((uint8_t *)&v)[i], ((uint8_t *)&v)[sizeof(v) - 1u - i]);
-#endif
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return v;
+#else
+    UnsignedOfSize<_Type> bits;
+    static_assert(sizeof(bits) == sizeof(v));
+    std::memcpy(&bits, &v, sizeof(v));
+    bits = byteswap(bits);
+    std::memcpy(&v, &bits, sizeof(v));
     return v;
+#endif
 }
 
+/**
+ * Write the shortest decimal representation of `v` which
+ * parses back to the same value into [first, last).
+ * Returns the end of the written characters. 32 chars
+ * are always enough.
+ */
+char* toChars(char* first, char* last, float v);
+char* toChars(char* first, char* last, double v);
+
+/** Append formatted buffer to `out` */
+void appendBuffer(std::string& out, Format f, const std::uint8_t* ptr, std::size_t size);
+
 /** Format buffer to string */
 std::string formatBuffer(Format f, const std::uint8_t* ptr, std::size_t size);
 
+/**
+ * Parse a buffer which was formatted with `formatBuffer`. Throws
+ * std::invalid_argument for malformed hex or base64, including base64
+ * without its padding.
+ */
+std::string parseBuffer(Format f, std::string_view text);
+
+/**
+ * Formats values of a type, either into a new string (`format`),
+ * or by appending to an existing one (`append`).
+ */
 template <class _Type, class _Enable = void>
 struct FormatHelper;
 
 template <class _Type>
 struct FormatHelper<_Type, std::enable_if_t<std::is_integral_v<_Type>>>
 {
-    static std::string format(Format f, _Type v)
+    static void append(std::string& out, Format f, _Type v)
     {
         switch (f) {
-        case Format::Hex: {
+        case Format::Hex:
+        case Format::String: {
             std::array<char, 30> buffer;
-            if constexpr (std::is_unsigned_v<_Type>)
-                std::snprintf(buffer.data(), buffer.size(), "%llx",
-                              (unsigned long long)v);
-            else
-                std::snprintf(buffer.data(), buffer.size(), "%s%llx",
-                              v < _Type(0) ? "-" : "",
-                              (unsigned long long)std::llabs(v));
-            return {buffer.data()};
+            auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), +v,
+                                        f == Format::Hex ? 16 : 10);
+            out.append(buffer.data(), result.ptr);
+            break;
         }
 
-        case Format::String:
-            return stx::to_string(v);
-
         default: {
             auto be = htobe(v);
-            return formatBuffer(f, reinterpret_cast<const std::uint8_t*>(&be), sizeof(be));
+            appendBuffer(out, f, reinterpret_cast<const std::uint8_t*>(&be), sizeof(be));
         }
         }
     }
+
+    static std::string format(Format f, _Type v)
+    {
+        std::string result;
+        append(result, f, v);
+        return result;
+    }
 };
 
 template <>
 struct FormatHelper<std::vector<std::uint8_t>>
 {
+    static void append(std::string& out, Format f, const std::vector<std::uint8_t>& v)
+    {
+        appendBuffer(out, f, v.data(), v.size());
+    }
+
     static std::string format(Format f, const std::vector<std::uint8_t>& v)
     {
         return formatBuffer(f, v.data(), v.size());
@@ -85,6 +145,19 @@ template <class _Type>
 struct FormatHelper<_Type, std::enable_if_t<std::is_same_v<_Type, std::string> ||
                                             std::is_same_v<_Type, const char*>>>
 {
+    static void append(std::string& out, Format f, std::string_view v)
+    {
+        switch (f) {
+        case Format::String:
+        case Format::Binary:
+            out += v;
+            break;
+
+        default:
+            appendBuffer(out, f, reinterpret_cast<const std::uint8_t*>(v.data()), v.size());
+        }
+    }
+
     static std::string format(Format f, std::string v)
     {
         switch (f) {
@@ -101,43 +174,178 @@ struct FormatHelper<_Type, std::enable_if_t<std::is_same_v<_Type, std::string> |
 template <class _Type>
 struct FormatHelper<_Type, std::enable_if_t<std::is_floating_point_v<_Type>>>
 {
-    static std::string format(Format f, _Type v)
+    static void append(std::string& out, Format f, _Type v)
     {
         switch (f) {
-        case Format::String:
-            return stx::to_string(v);
+        case Format::String: {
+            std::array<char, 32> buffer;
+            out.append(buffer.data(), toChars(buffer.data(), buffer.data() + buffer.size(), v));
+            break;
+        }
 
         default: {
             auto be = htobe(v);
-            return formatBuffer(f, reinterpret_cast<const std::uint8_t*>(&be), sizeof(be));
+            appendBuffer(out, f, reinterpret_cast<const std::uint8_t*>(&be), sizeof(be));
         }
         }
     }
+
+    static std::string format(Format f, _Type v)
+    {
+        std::string result;
+        append(result, f, v);
+        return result;
+    }
 };
 
 template <>
 struct FormatHelper<Any>
 {
+    static void append(std::string& out, Format f, const Any& v)
+    {
+        std::visit([&](const auto& value) {
+            FormatHelper<std::decay_t<decltype(value)>>::append(out, f, value);
+        }, v);
+    }
+
     static std::string format(Format f, Any v)
     {
-        if (auto value = std::get_if<std::int64_t>(&v))
-            return FormatHelper<std::int64_t>::format(f, *value);
-        if (auto value = std::get_if<std::uint64_t>(&v))
-            return FormatHelper<std::uint64_t>::format(f, *value);
-        if (auto value = std::get_if<double>(&v))
-            return FormatHelper<double>::format(f, *value);
         if (auto value = std::get_if<std::string>(&v))
-            return FormatHelper<std::string>::format(f, *value);
+            return FormatHelper<std::string>::format(f, std::move(*value));
 
-        throw std::runtime_error("Unsupported type");
+        std::string result;
+        append(result, f, v);
+        return result;
     }
 };
 
 }
 
+/**
+ * Streaming encoder for the values of one parameter. Values are written
+ * in the style of the parameter straight into the request: Path values
+ * are appended to the path, query and header values become key-value
+ * pairs. No intermediate containers are built for arrays and objects.
+ *
+ * Path styles supported:
+ *   * Simple
+ *   * Label
+ *   * Matrix
+ *
+ * Query and header styles supported:
+ *   * Form, explode=false
+ *   * Form, explode=true
+ *
+ * Values of other styles are skipped; for the path, the
+ * parameter's default value is written instead.
+ *
+ * @see https://swagger.io/docs/specification/serialization/
+ */
+class ParameterWriter
+{
+public:
+    using Pairs = std::multimap<std::string, std::string>;
+
+    /** Append path values to `path`. */
+    ParameterWriter(const OpenAPIConfig::Parameter& param, std::string& path)
+        : param(param), path_(&path)
+    {}
+
+    /** Insert query or header values into `pairs`. */
+    ParameterWriter(const OpenAPIConfig::Parameter& param, Pairs& pairs)
+        : param(param), pairs_(&pairs)
+    {}
+
+    const OpenAPIConfig::Parameter& param;
+
+    template <class _Type>
+    void value(const _Type& v)
+    {
+        if (begin(Kind::Value))
+            format(next(Kind::Value, true), v);
+    }
+
+    template <class _Container>
+    void array(const _Container& v)
+    {
+        if (!begin(Kind::Array))
+            return;
+
+        auto first = true;
+        for (const auto& item : v) {
+            format(next(Kind::Array, first), item);
+            first = false;
+        }
+    }
+
+    /** Key-value pairs are written in the order of the container. */
+    template <class _Container>
+    void object(const _Container& v)
+    {
+        if (!begin(Kind::Object))
+            return;
+
+        auto first = true;
+        for (const auto& [key, item] : v) {
+            if (pairs_ && param.explode) {
+                format(pairs_->emplace(key, std::string())->second, item);
+                continue;
+            }
+
+            auto& out = next(Kind::Object, first);
+            out += key;
+            out += param.explode ? '=' : ',';
+            format(out, item);
+            first = false;
+        }
+    }
+
+    void binary(const std::uint8_t* data, std::size_t size)
+    {
+        if (begin(Kind::Value))
+            impl::appendBuffer(next(Kind::Value, true), param.format, data, size);
+    }
+
+    /**
+     * Write values which are formatted already, e.
+     * g. those of a ParameterValue.
+     */
+    void formattedValue(std::string_view v);
+    void formattedArray(const std::vector<std::string>& v);
+    void formattedObject(const std::map<std::string, std::string>& v);
+
+private:
+    enum class Kind { Value, Array, Object };
+
+    /** Write the prefix of a value. Returns false if the style is not supported. */
+    bool begin(Kind kind);
+
+    /** Write the separator for the next array item or object entry, and get the output for it. */
+    std::string& next(Kind kind, bool first);
+
+    template <class _Type>
+    void format(std::string& out, const _Type& v)
+    {
+        if constexpr (std::is_same_v<_Type, std::string_view>)
+            impl::FormatHelper<std::string>::append(out, param.format, v);
+        else
+            impl::FormatHelper<std::decay_t<const _Type&>>::append(out, param.format, v);
+    }
+
+    std::string* path_ = nullptr;
+    Pairs* pairs_ = nullptr;
+    /** Value of the query/header pair which holds all items. */
+    std::string* joined_ = nullptr;
+};
+
 struct ParameterValue
 {
-    using ValueHolder = std::variant<std::string,
+    /**
+     * Formatted value(s). std::monostate means that the value
+     * was streamed into a ParameterWriter already.
+     */
+    using ValueHolder = std::variant<std::monostate,
+                                     std::string,
                                      std::vector<std::string>,
                                      std::map<std::string, std::string>>;
 
@@ -151,7 +359,13 @@ struct ParameterValue
      * Returns the values string-value.
      * Throws if the current value is not a string/buffer.
      */
-    std::string bodyStr() const;
+    std::string bodyStr() const&;
+
+    /**
+     * Same as above, but moves the string-value out
+     * of a temporary, e.g. a serialized request body.
+     */
+    std::string bodyStr() &&;
 
     /**
      * Make path string.
@@ -178,8 +392,18 @@ struct ParameterValue
      * @see https://swagger.io/docs/specification/serialization/
      */
     std::vector<std::pair<std::string, std::string>> queryOrHeaderPairs(const OpenAPIConfig::Parameter&) const;
+
+    /**
+     * Write the value to `writer`, unless it was streamed there already.
+     */
+    void write(ParameterWriter& writer) const;
 };
 
+/**
+ * Formats values for a parameter. If the helper has a ParameterWriter,
+ * values are streamed into it right away, and the returned ParameterValue
+ * is empty. Otherwise, the ParameterValue holds the formatted values.
+ */
 class ParameterValueHelper
 {
 public:
@@ -189,15 +413,28 @@ public:
         : param(param)
     {}
 
+    ParameterValueHelper(const OpenAPIConfig::Parameter& param, ParameterWriter& writer)
+        : param(param), writer_(&writer)
+    {}
+
     template <class _Type>
     ParameterValue value(_Type&& v)
     {
+        if (writer_) {
+            writer_->value(v);
+            return streamed();
+        }
         return ParameterValue(format(std::forward<_Type>(v)));
     }
 
     template <class _Container>
     ParameterValue array(const _Container& v)
     {
+        if (writer_) {
+            writer_->array(v);
+            return streamed();
+        }
+
         std::vector<std::string> tmp(v.size());
         std::transform(std::begin(v), std::end(v), tmp.begin(), [&](const auto& v) {
             return format(v);
@@ -206,9 +443,26 @@ public:
         return ParameterValue(std::move(tmp));
     }
 
+    ParameterValue array(std::vector<std::string>&& v)
+    {
+        if (writer_) {
+            writer_->array(v);
+            return streamed();
+        }
+
+        for (auto& item : v)
+            item = format(std::move(item));
+        return ParameterValue(std::move(v));
+    }
+
     template <class _Container>
     ParameterValue object(const _Container& v)
     {
+        if (writer_) {
+            writer_->object(v);
+            return streamed();
+        }
+
         std::map<std::string, std::string> tmp;
         std::transform(v.begin(), v.end(), std::inserter(tmp, tmp.end()), [&](const auto& kv) {
             return std::make_pair(kv.first, format(kv.second));
@@ -219,18 +473,34 @@ public:
 
     ParameterValue binary(std::vector<std::uint8_t>&& v)
     {
-        return ParameterValue(format(std::move(v)));
+        return binary(zserio::Span<const uint8_t>(v.data(), v.size()));
     }
 
     ParameterValue binary(const std::vector<std::uint8_t>& v)
     {
-        return ParameterValue(format(v));
+        return binary(zserio::Span<const uint8_t>(v.data(), v.size()));
     }
 
     ParameterValue binary(const zserio::Span<const uint8_t>& v)
     {
-        std::vector<uint8_t> buf{v.begin(), v.end()};
-        return ParameterValue(format(std::move(buf)));
+        if (writer_) {
+            writer_->binary(v.data(), v.size());
+            return streamed();
+        }
+        return ParameterValue(impl::formatBuffer(param.format, v.data(), v.size()));
+    }
+
+    /**
+     * Binary value which is already held in a string. Unless it
+     * needs to be encoded, the string is moved, not copied.
+     */
+    ParameterValue binary(std::string&& v)
+    {
+        if (writer_) {
+            writer_->binary(reinterpret_cast<const std::uint8_t*>(v.data()), v.size());
+            return streamed();
+        }
+        return ParameterValue(format(std::move(v)));
     }
 
 private:
@@ -239,6 +509,13 @@ private:
     {
         return impl::FormatHelper<std::decay_t<_Type>>::format(param.format, std::forward<_Type>(v));
     }
+
+    static ParameterValue streamed()
+    {
+        return ParameterValue(std::monostate());
+    }
+
+    ParameterWriter* writer_ = nullptr;
 };
 
 
@@ -31,6 +31,12 @@ public:
         const OpenAPIConfig::SecurityRequirement& req,
         AuthContext const& ctx,
         std::string& mismatchReason) = 0;
+
+    /**
+     * Block until background work of the handler is done, e.g.
+     * before the HTTP client which it uses is destroyed.
+     */
+    virtual void waitForBackgroundTasks() {}
 };
 
 class AuthRegistry
@@ -48,6 +54,11 @@ public:
         const OpenAPIConfig::SecurityAlternatives& alts,
         AuthContext const& ctx);
 
+    /**
+     * Block until background work of all handlers is done.
+     */
+    void waitForBackgroundTasks();
+
 private:
     std::unordered_map<OpenAPIConfig::SecuritySchemeType, std::shared_ptr<ISecurityHandler>>
         handlers_;
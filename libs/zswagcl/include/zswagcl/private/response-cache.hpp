@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace zswagcl
+{
+
+/**
+ * In-memory cache for response buffers with a byte budget. Entries
+ * expire after their TTL, and the least recently used entries are
+ * evicted once the budget is exceeded. The cache is split into shards
+ * by key hash, so that concurrent lookups rarely contend on a lock.
+ */
+class ResponseCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Value = std::shared_ptr<const std::string>;
+
+    /**
+     * Read the byte budget from the HTTP_RESPONSE_CACHE_SIZE
+     * environment variable. Defaults to 64 MiB.
+     */
+    static std::size_t maxBytesFromEnv();
+
+    explicit ResponseCache(std::size_t maxBytes, std::size_t shards = 16);
+
+    ResponseCache(ResponseCache const&) = delete;
+    ResponseCache& operator=(ResponseCache const&) = delete;
+
+    /**
+     * Get the value for `key`, or null if there
+     * is none, or if it expired.
+     */
+    Value get(std::string const& key);
+
+    /**
+     * Store `value` under `key` for `ttl`. Values which
+     * exceed the budget of a shard are not stored.
+     */
+    void put(std::string const& key, Value value, Clock::duration ttl);
+    void put(std::string const& key, std::string value, Clock::duration ttl);
+
+    void clear();
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        /** Entries which were dropped to stay within the budget. */
+        uint64_t evictions = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        Value value;
+        Clock::time_point expires;
+        std::size_t bytes = 0;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        /** Most recently used entries first. */
+        std::list<Entry> entries;
+        /** Keys are views of Entry::key. */
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        std::size_t bytes = 0;
+    };
+
+    Shard& shard(std::string const& key);
+    void erase(Shard& shard, std::list<Entry>::iterator entry);
+
+    std::size_t maxShardBytes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace zswagcl
+{
+
+/**
+ * Immutable response body, which is shared instead of copied on its way
+ * from the HTTP client to the caller. Identical coalesced calls and
+ * response cache hits all share the same bytes.
+ *
+ * The bytes stay valid as long as any copy of the buffer exists, so
+ * a zserio reader may work on them directly:
+ *
+ *     auto response = oaClient.callMethodBuffer("getTile", requestData);
+ *     zserio::BitStreamReader reader(response.data(), response.size());
+ */
+class ResponseBuffer
+{
+public:
+    ResponseBuffer() = default;
+
+    /** Take over `content` without copying it. */
+    explicit ResponseBuffer(std::string content)
+        : content_(std::make_shared<const std::string>(std::move(content)))
+    {}
+
+    explicit ResponseBuffer(std::shared_ptr<const std::string> content)
+        : content_(std::move(content))
+    {}
+
+    const uint8_t* data() const
+    {
+        return content_ ? reinterpret_cast<const uint8_t*>(content_->data()) : nullptr;
+    }
+
+    std::size_t size() const { return content_ ? content_->size() : 0; }
+    bool empty() const { return size() == 0; }
+
+    std::string_view view() const
+    {
+        return content_ ? std::string_view(*content_) : std::string_view();
+    }
+
+    /** Copy of the bytes, for interfaces which need to own them. */
+    std::vector<uint8_t> toVector() const { return {data(), data() + size()}; }
+
+    /** Shared bytes, e.g. to keep them in a cache. */
+    std::shared_ptr<const std::string> const& shared() const { return content_; }
+
+private:
+    std::shared_ptr<const std::string> content_;
+};
+
+}
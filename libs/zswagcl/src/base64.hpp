@@ -10,6 +10,14 @@ std::string base64_encode(unsigned char const* bytes_to_encode,
 std::string base64url_encode(unsigned char const* bytes_to_encode,
                              unsigned int in_len);
 
+/* Same as above, but append to `out`. */
+void base64_append(std::string& out,
+                   unsigned char const* bytes_to_encode,
+                   unsigned int in_len);
+void base64url_append(std::string& out,
+                      unsigned char const* bytes_to_encode,
+                      unsigned int in_len);
+
 std::string base64_decode(std::string const& encoded_string);
 std::string base64url_decode(std::string const& encoded_string);
 
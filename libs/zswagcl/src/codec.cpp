@@ -0,0 +1,562 @@
+#include "codec.hpp"
+
+#include <array>
+#include <atomic>
+#include <stdexcept>
+
+#include "stx/format.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ZSWAGCL_CODEC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+/* MSVC allows intrinsics of any instruction set without flags. */
+#define ZSWAGCL_TARGET(isa)
+#else
+#define ZSWAGCL_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace zswagcl::codec
+{
+
+namespace
+{
+
+constexpr char base64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+constexpr char base64urlChars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789-_";
+
+constexpr char hexChars[] = "0123456789abcdef";
+
+/** Value of each character in the alphabet, -1 for other characters. */
+using DecodeTable = std::array<int8_t, 256>;
+
+DecodeTable makeDecodeTable(const char* alphabet)
+{
+    DecodeTable table;
+    table.fill(-1);
+    for (auto i = 0; i < 64; ++i)
+        table[static_cast<uint8_t>(alphabet[i])] = static_cast<int8_t>(i);
+    return table;
+}
+
+const DecodeTable& decodeTable(bool url)
+{
+    static const auto base64 = makeDecodeTable(base64Chars);
+    static const auto base64url = makeDecodeTable(base64urlChars);
+    return url ? base64url : base64;
+}
+
+const DecodeTable& hexTable()
+{
+    static const auto table = [] {
+        DecodeTable result;
+        result.fill(-1);
+        for (auto i = 0; i < 10; ++i)
+            result['0' + i] = static_cast<int8_t>(i);
+        for (auto i = 0; i < 6; ++i)
+            result['a' + i] = result['A' + i] = static_cast<int8_t>(10 + i);
+        return result;
+    }();
+    return table;
+}
+
+/*
+ * Kernels: Each one consumes as many whole blocks of the input as it
+ * can, and advances `in` and `out` past them. The scalar kernels then
+ * process the rest. Decoding kernels stop before the first block
+ * which contains a character that they cannot handle.
+ */
+
+void encodeBase64Scalar(const uint8_t*& in, const uint8_t* end, char*& out, bool url)
+{
+    const char* alphabet = url ? base64urlChars : base64Chars;
+    for (; end - in >= 3; in += 3, out += 4) {
+        const uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+        out[0] = alphabet[(v >> 18) & 0x3f];
+        out[1] = alphabet[(v >> 12) & 0x3f];
+        out[2] = alphabet[(v >> 6) & 0x3f];
+        out[3] = alphabet[v & 0x3f];
+    }
+
+    if (in == end)
+        return;
+
+    const uint32_t v = (uint32_t(in[0]) << 16) | (end - in > 1 ? uint32_t(in[1]) << 8 : 0u);
+    out[0] = alphabet[(v >> 18) & 0x3f];
+    out[1] = alphabet[(v >> 12) & 0x3f];
+    out[2] = end - in > 1 ? alphabet[(v >> 6) & 0x3f] : '=';
+    out[3] = '=';
+    in = end;
+    out += 4;
+}
+
+void decodeBase64Scalar(const char*& in, const char* end, uint8_t*& out, bool url)
+{
+    const auto& table = decodeTable(url);
+    uint32_t v = 0;
+    auto n = 0;
+    for (; in != end; ++in) {
+        auto value = table[static_cast<uint8_t>(*in)];
+        if (value < 0)
+            break;
+        v = (v << 6) | static_cast<uint32_t>(value);
+        if (++n == 4) {
+            *out++ = static_cast<uint8_t>(v >> 16);
+            *out++ = static_cast<uint8_t>(v >> 8);
+            *out++ = static_cast<uint8_t>(v);
+            v = 0;
+            n = 0;
+        }
+    }
+
+    /* A trailing group of n characters holds n - 1 bytes. */
+    if (n > 1) {
+        v <<= 6 * (4 - n);
+        *out++ = static_cast<uint8_t>(v >> 16);
+        if (n > 2)
+            *out++ = static_cast<uint8_t>(v >> 8);
+    }
+}
+
+void encodeHexScalar(const uint8_t*& in, const uint8_t* end, char*& out)
+{
+    for (; in != end; ++in) {
+        *out++ = hexChars[*in >> 4];
+        *out++ = hexChars[*in & 0xf];
+    }
+}
+
+void decodeHexScalar(const char*& in, const char* begin, const char* end, uint8_t*& out)
+{
+    const auto& table = hexTable();
+    for (; in != end; in += 2) {
+        auto hi = table[static_cast<uint8_t>(in[0])];
+        auto lo = table[static_cast<uint8_t>(in[1])];
+        if (hi < 0 || lo < 0) {
+            auto pos = (in - begin) + (hi < 0 ? 0 : 1);
+            throw std::invalid_argument(stx::format("Invalid hex character at position {}.", pos));
+        }
+        *out++ = static_cast<uint8_t>((hi << 4) | lo);
+    }
+}
+
+#ifdef ZSWAGCL_CODEC_X86
+
+/*
+ * Base64 with SIMD, after Wojciech Muła and Daniel Lemire,
+ * "Faster Base64 Encoding and Decoding Using AVX2 Instructions".
+ * Encoding spreads each 3 bytes over 4 bytes of 6 bits, which are then
+ * turned into characters by adding a per-range offset. Decoding does
+ * the opposite, and bails out on characters outside of the alphabet.
+ */
+
+ZSWAGCL_TARGET("sse4.1")
+__m128i base64Indices128(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const auto t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const auto t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const auto t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const auto t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+ZSWAGCL_TARGET("sse4.1")
+__m128i base64Chars128(__m128i indices, bool url)
+{
+    const auto offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62, (url ? '_' : '/') - 63, 'A', 0, 0);
+
+    /* 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 */
+    auto range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const auto upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+ZSWAGCL_TARGET("sse4.1")
+void encodeBase64SSE4(const uint8_t*& in, const uint8_t* end, char*& out, bool url)
+{
+    /* Loads 16 bytes, of which 12 are encoded. */
+    for (; end - in >= 16; in += 12, out += 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64Chars128(base64Indices128(block), url));
+    }
+}
+
+ZSWAGCL_TARGET("sse4.1")
+__m128i inRange128(__m128i in, char lo, char hi)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), in));
+}
+
+ZSWAGCL_TARGET("sse4.1")
+bool base64Values128(__m128i in, bool url, __m128i& values)
+{
+    const char c62 = url ? '-' : '+';
+    const char c63 = url ? '_' : '/';
+    const auto upper = inRange128(in, 'A', 'Z');
+    const auto lower = inRange128(in, 'a', 'z');
+    const auto digit = inRange128(in, '0', '9');
+    const auto is62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c62));
+    const auto is63 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c63));
+
+    const auto valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+    if (_mm_movemask_epi8(valid) != 0xffff)
+        return false;
+
+    auto shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(is62, _mm_set1_epi8(static_cast<char>(62 - c62))));
+    shift = _mm_or_si128(shift, _mm_and_si128(is63, _mm_set1_epi8(static_cast<char>(63 - c63))));
+    values = _mm_add_epi8(in, shift);
+    return true;
+}
+
+ZSWAGCL_TARGET("sse4.1")
+__m128i base64Pack128(__m128i values)
+{
+    /* Merge 4 x 6 bits into 24 bits per 32 bit lane, then drop every 4th byte. */
+    const auto pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const auto quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+ZSWAGCL_TARGET("sse4.1")
+void decodeBase64SSE4(const char*& in, const char* end, uint8_t*& out, bool url)
+{
+    /* Stores 16 bytes, of which 12 are decoded. */
+    for (; end - in >= 16; in += 16, out += 12) {
+        __m128i values;
+        if (!base64Values128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), url, values))
+            return;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64Pack128(values));
+    }
+}
+
+ZSWAGCL_TARGET("avx2")
+void encodeBase64AVX2(const uint8_t*& in, const uint8_t* end, char*& out, bool url)
+{
+    const auto offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62, (url ? '_' : '/') - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, (url ? '-' : '+') - 62, (url ? '_' : '/') - 63, 'A', 0, 0);
+    const auto spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+    /* Loads 12 bytes into each 128 bit lane, reading 28 bytes. */
+    for (; end - in >= 28; in += 24, out += 32) {
+        auto block = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+        block = _mm256_shuffle_epi8(block, spread);
+
+        const auto t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+        const auto t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const auto t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+        const auto t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const auto indices = _mm256_or_si256(t1, t3);
+
+        auto range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const auto upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        const auto chars = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+    }
+}
+
+ZSWAGCL_TARGET("avx2")
+__m256i inRange256(__m256i in, char lo, char hi)
+{
+    return _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), in));
+}
+
+ZSWAGCL_TARGET("avx2")
+void decodeBase64AVX2(const char*& in, const char* end, uint8_t*& out, bool url)
+{
+    const char c62 = url ? '-' : '+';
+    const char c63 = url ? '_' : '/';
+
+    /* Stores 32 bytes, of which 24 are decoded. */
+    for (; end - in >= 32; in += 32, out += 24) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        const auto upper = inRange256(block, 'A', 'Z');
+        const auto lower = inRange256(block, 'a', 'z');
+        const auto digit = inRange256(block, '0', '9');
+        const auto is62 = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c62));
+        const auto is63 = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(c63));
+
+        const auto valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                           _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+        if (_mm256_movemask_epi8(valid) != -1)
+            return;
+
+        auto shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(is62, _mm256_set1_epi8(static_cast<char>(62 - c62))));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(is63, _mm256_set1_epi8(static_cast<char>(63 - c63))));
+        const auto values = _mm256_add_epi8(block, shift);
+
+        const auto pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const auto quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        auto packed = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        /* Move the 12 bytes of the upper lane next to those of the lower one. */
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+    }
+}
+
+ZSWAGCL_TARGET("sse4.1")
+void encodeHexSSE4(const uint8_t*& in, const uint8_t* end, char*& out)
+{
+    const auto digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hexChars));
+    const auto nibble = _mm_set1_epi8(0x0f);
+
+    for (; end - in >= 16; in += 16, out += 32) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const auto hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+        const auto lo = _mm_shuffle_epi8(digits, _mm_and_si128(block, nibble));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+}
+
+ZSWAGCL_TARGET("avx2")
+void encodeHexAVX2(const uint8_t*& in, const uint8_t* end, char*& out)
+{
+    const auto digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hexChars)));
+    const auto nibble = _mm256_set1_epi8(0x0f);
+
+    for (; end - in >= 32; in += 32, out += 64) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        const auto hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+        const auto lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(block, nibble));
+        /* Unpacking works per 128 bit lane, so the lanes need to be reordered. */
+        const auto first = _mm256_unpacklo_epi8(hi, lo);
+        const auto second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+}
+
+ZSWAGCL_TARGET("sse4.1")
+bool hexValues128(__m128i in, __m128i& values)
+{
+    const auto digit = inRange128(in, '0', '9');
+    const auto lowered = _mm_or_si128(in, _mm_set1_epi8(0x20));
+    const auto letter = inRange128(lowered, 'a', 'f');
+    if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xffff)
+        return false;
+
+    values = _mm_blendv_epi8(_mm_sub_epi8(lowered, _mm_set1_epi8('a' - 10)),
+                             _mm_sub_epi8(in, _mm_set1_epi8('0')), digit);
+    return true;
+}
+
+ZSWAGCL_TARGET("sse4.1")
+void decodeHexSSE4(const char*& in, const char* end, uint8_t*& out)
+{
+    const auto weights = _mm_set1_epi16(0x0110);
+
+    for (; end - in >= 32; in += 32, out += 16) {
+        __m128i first, second;
+        if (!hexValues128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), first) ||
+            !hexValues128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)), second))
+            return;
+
+        /* hi * 16 + lo for each pair of characters */
+        const auto bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+    }
+}
+
+ZSWAGCL_TARGET("avx2")
+bool hexValues256(__m256i in, __m256i& values)
+{
+    const auto digit = inRange256(in, '0', '9');
+    const auto lowered = _mm256_or_si256(in, _mm256_set1_epi8(0x20));
+    const auto letter = inRange256(lowered, 'a', 'f');
+    if (_mm256_movemask_epi8(_mm256_or_si256(digit, letter)) != -1)
+        return false;
+
+    values = _mm256_blendv_epi8(_mm256_sub_epi8(lowered, _mm256_set1_epi8('a' - 10)),
+                                _mm256_sub_epi8(in, _mm256_set1_epi8('0')), digit);
+    return true;
+}
+
+ZSWAGCL_TARGET("avx2")
+void decodeHexAVX2(const char*& in, const char* end, uint8_t*& out)
+{
+    const auto weights = _mm256_set1_epi16(0x0110);
+
+    for (; end - in >= 64; in += 64, out += 32) {
+        __m256i first, second;
+        if (!hexValues256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)), first) ||
+            !hexValues256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32)), second))
+            return;
+
+        /* Packing works per 128 bit lane, so the 64 bit quarters need to be reordered. */
+        auto bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights), _mm256_maddubs_epi16(second, weights));
+        bytes = _mm256_permute4x64_epi64(bytes, 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), bytes);
+    }
+}
+
+Isa detectIsa()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const auto maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool ssse3 = info[2] & (1 << 9);
+    const bool sse41 = info[2] & (1 << 19);
+    /* AVX registers must also be saved by the OS. */
+    const bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+
+    bool avx2 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = avx && (info[1] & (1 << 5));
+    }
+#else
+    __builtin_cpu_init();
+    const bool ssse3 = __builtin_cpu_supports("ssse3");
+    const bool sse41 = __builtin_cpu_supports("sse4.1");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (avx2)
+        return Isa::AVX2;
+    if (ssse3 && sse41)
+        return Isa::SSE4;
+    return Isa::Scalar;
+}
+
+#else
+
+Isa detectIsa()
+{
+    return Isa::Scalar;
+}
+
+#endif
+
+std::atomic<Isa>& active()
+{
+    static std::atomic<Isa> isa{bestIsa()};
+    return isa;
+}
+
+}
+
+Isa bestIsa()
+{
+    static const auto isa = detectIsa();
+    return isa;
+}
+
+Isa activeIsa()
+{
+    return active();
+}
+
+void setActiveIsa(Isa isa)
+{
+    active() = isa <= bestIsa() ? isa : bestIsa();
+}
+
+void base64Encode(std::string& out, const std::uint8_t* data, std::size_t size, bool url, Isa isa)
+{
+    const auto offset = out.size();
+    out.resize(offset + (size + 2) / 3 * 4);
+
+    auto* in = data;
+    auto* end = data + size;
+    auto* pos = out.data() + offset;
+#ifdef ZSWAGCL_CODEC_X86
+    if (isa == Isa::AVX2 && bestIsa() == Isa::AVX2)
+        encodeBase64AVX2(in, end, pos, url);
+    if (isa >= Isa::SSE4 && bestIsa() >= Isa::SSE4)
+        encodeBase64SSE4(in, end, pos, url);
+#endif
+    encodeBase64Scalar(in, end, pos, url);
+}
+
+std::string base64Decode(std::string_view text, bool url, Isa isa)
+{
+    /* Room for the bytes which SIMD kernels store past their output. */
+    std::string result(text.size() / 4 * 3 + 3 + 32, '\0');
+
+    auto* in = text.data();
+    auto* end = text.data() + text.size();
+    auto* out = reinterpret_cast<uint8_t*>(result.data());
+#ifdef ZSWAGCL_CODEC_X86
+    if (isa == Isa::AVX2 && bestIsa() == Isa::AVX2)
+        decodeBase64AVX2(in, end, out, url);
+    if (isa >= Isa::SSE4 && bestIsa() >= Isa::SSE4)
+        decodeBase64SSE4(in, end, out, url);
+#endif
+    decodeBase64Scalar(in, end, out, url);
+
+    result.resize(out - reinterpret_cast<uint8_t*>(result.data()));
+    return result;
+}
+
+void hexEncode(std::string& out, const std::uint8_t* data, std::size_t size, Isa isa)
+{
+    const auto offset = out.size();
+    out.resize(offset + size * 2);
+
+    auto* in = data;
+    auto* end = data + size;
+    auto* pos = out.data() + offset;
+#ifdef ZSWAGCL_CODEC_X86
+    if (isa == Isa::AVX2 && bestIsa() == Isa::AVX2)
+        encodeHexAVX2(in, end, pos);
+    if (isa >= Isa::SSE4 && bestIsa() >= Isa::SSE4)
+        encodeHexSSE4(in, end, pos);
+#endif
+    encodeHexScalar(in, end, pos);
+}
+
+std::string hexDecode(std::string_view text, Isa isa)
+{
+    if (text.size() % 2)
+        throw std::invalid_argument(stx::format("Hex text has an odd length of {}.", text.size()));
+
+    std::string result(text.size() / 2, '\0');
+
+    auto* in = text.data();
+    auto* end = text.data() + text.size();
+    auto* out = reinterpret_cast<uint8_t*>(result.data());
+#ifdef ZSWAGCL_CODEC_X86
+    if (isa == Isa::AVX2 && bestIsa() == Isa::AVX2)
+        decodeHexAVX2(in, end, out);
+    if (isa >= Isa::SSE4 && bestIsa() >= Isa::SSE4)
+        decodeHexSSE4(in, end, out);
+#endif
+    decodeHexScalar(in, text.data(), end, out);
+    return result;
+}
+
+}
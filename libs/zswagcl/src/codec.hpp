@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace zswagcl::codec
+{
+
+/**
+ * Instruction sets for which the codecs have kernels. The kernel is
+ * picked at runtime, so one build runs on any CPU of its architecture.
+ * Other architectures than x86 always use the scalar kernels.
+ */
+enum class Isa
+{
+    Scalar,
+    /** SSSE3 and SSE4.1 */
+    SSE4,
+    AVX2
+};
+
+/** Best instruction set which is supported by this CPU and build. */
+Isa bestIsa();
+
+/** Instruction set which is used by default. Starts out as bestIsa(). */
+Isa activeIsa();
+
+/**
+ * Use `isa` by default, e.g. to compare kernels. Instruction
+ * sets which are not supported fall back to bestIsa().
+ */
+void setActiveIsa(Isa isa);
+
+/** Append the base64 (or base64url) encoding of the data to `out`, with padding. */
+void base64Encode(std::string& out, const std::uint8_t* data, std::size_t size, bool url, Isa isa = activeIsa());
+
+/**
+ * Decode base64 (or base64url) text. Decoding stops at the
+ * first padding or other character which is not in the alphabet.
+ */
+std::string base64Decode(std::string_view text, bool url, Isa isa = activeIsa());
+
+/** Append the lowercase hex encoding of the data to `out`. */
+void hexEncode(std::string& out, const std::uint8_t* data, std::size_t size, Isa isa = activeIsa());
+
+/**
+ * Decode hex text, upper- or lowercase. Throws std::invalid_argument
+ * if the text has an odd length or contains other characters.
+ */
+std::string hexDecode(std::string_view text, Isa isa = activeIsa());
+
+}
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include "stx/format.h"
+#include "zserio/CppRuntimeException.h"
 #include "zserio/ITypeInfo.h"
 
 namespace zswagcl
@@ -14,102 +15,137 @@ OAClient::OAClient(zswagcl::OpenAPIConfig config,
     : client_(std::move(config), std::move(httpConfig), std::move(client), serverIndex)
 {}
 
-template<typename arr_elem_t>
-ParameterValue reflectableArrayToParameterValue(std::function<void(std::vector<arr_elem_t>&, size_t)> appendFun, size_t length, ParameterValueHelper& helper) {
+namespace
+{
+
+/**
+ * Serialize a zserio object into a string of the exact size, which
+ * is then moved (not copied) into the request body or parameter.
+ */
+std::string serialize(zserio::IReflectableConstPtr const& reflectable)
+{
+    std::string result((reflectable->bitSizeOf() + 7) / 8, '\0');
+    zserio::BitStreamWriter writer(zserio::Span<uint8_t>(reinterpret_cast<uint8_t*>(result.data()), result.size()));
+    reflectable->write(writer);
+    return result;
+}
+
+using Encoder = ParameterValue (*)(zserio::IReflectableConstPtr const&, ParameterValueHelper&);
+
+template<typename arr_elem_t, typename element_fun_t>
+ParameterValue encodeArray(zserio::IReflectableConstPtr const& ref, ParameterValueHelper& helper, element_fun_t element)
+{
     std::vector<arr_elem_t> values;
+    auto const length = ref->size();
     values.reserve(length);
-    for (auto i = 0; i < length; ++i) {
-        appendFun(values, i);
-    }
-    return helper.array(values);
+    for (size_t i = 0; i < length; ++i)
+        values.emplace_back(element(ref->at(i)));
+    return helper.array(std::move(values));
+}
+
+std::string bitBufferBytes(zserio::IReflectableConstPtr const& ref)
+{
+    auto const& buffer = ref->getBitBuffer();
+    return {reinterpret_cast<const char*>(buffer.getBuffer()), buffer.getByteSize()};
 }
 
-ParameterValue reflectableToParameterValue(std::string const& fieldName, zserio::IReflectableConstPtr const& ref, zserio::ITypeInfo const& refType, ParameterValueHelper& helper)
+std::string bytes(zserio::IReflectableConstPtr const& ref)
 {
-    switch (refType.getCppType())
+    auto const& buffer = ref->getBytes();
+    return {buffer.begin(), buffer.end()};
+}
+
+/**
+ * Pick the function which turns a value of the given type into a
+ * ParameterValue, so that the type switch runs once per field.
+ */
+Encoder selectEncoder(zserio::ITypeInfo const& type, bool isArray, std::string const& fieldName)
+{
+    using Ref = zserio::IReflectableConstPtr;
+
+    switch (type.getCppType())
     {
         case zserio::CppType::BOOL:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<uint8_t>([&](auto& arr, auto i) {
-                    arr.emplace_back(static_cast<uint8_t>(ref->at(i)->getBool()));
-                }, ref->size(), helper);
-            }
-            return helper.value(static_cast<uint8_t>(ref->getBool()));
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<uint8_t>(ref, helper, [](Ref const& e) { return static_cast<uint8_t>(e->getBool()); });
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) {
+                return helper.value(static_cast<uint8_t>(ref->getBool()));
+            };
         case zserio::CppType::INT8:
         case zserio::CppType::INT16:
         case zserio::CppType::INT32:
         case zserio::CppType::INT64:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<int64_t>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toInt());
-                }, ref->size(), helper);
-            }
-            return helper.value(ref->toInt());
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<int64_t>(ref, helper, [](Ref const& e) { return e->toInt(); });
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) { return helper.value(ref->toInt()); };
         case zserio::CppType::UINT8:
         case zserio::CppType::UINT16:
         case zserio::CppType::UINT32:
         case zserio::CppType::UINT64:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<uint64_t>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toUInt());
-                }, ref->size(), helper);
-            }
-            return helper.value(ref->toUInt());
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<uint64_t>(ref, helper, [](Ref const& e) { return e->toUInt(); });
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) { return helper.value(ref->toUInt()); };
         case zserio::CppType::FLOAT:
+            /* Strings use the shortest float32 digits, binary
+             * formats keep sending 8-byte doubles. */
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    if (helper.param.format == OpenAPIConfig::Parameter::Format::String)
+                        return encodeArray<float>(ref, helper, [](Ref const& e) { return e->getFloat(); });
+                    return encodeArray<double>(ref, helper, [](Ref const& e) { return e->toDouble(); });
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) {
+                if (helper.param.format == OpenAPIConfig::Parameter::Format::String)
+                    return helper.value(ref->getFloat());
+                return helper.value(ref->toDouble());
+            };
         case zserio::CppType::DOUBLE:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<double>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toDouble());
-                }, ref->size(), helper);
-            }
-            return helper.value(ref->toDouble());
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<double>(ref, helper, [](Ref const& e) { return e->toDouble(); });
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) { return helper.value(ref->toDouble()); };
         case zserio::CppType::STRING:
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    arr.emplace_back(ref->at(i)->toString());
-                }, ref->size(), helper);
-            }
-            return helper.value(ref->toString());
-        case zserio::CppType::BIT_BUFFER: {
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    auto const& buffer = ref->at(i)->getBytes();
-                    arr.emplace_back(buffer.begin(), buffer.end());
-                }, ref->size(), helper);
-            }
-            auto const& buffer = ref->getBytes();
-            return helper.binary(std::vector<uint8_t>(buffer.begin(), buffer.end()));
-        }
-        case zserio::CppType::BYTES: {
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    auto const& buffer = ref->at(i)->getBitBuffer();
-                    arr.emplace_back(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize());
-                }, ref->size(), helper);
-            }
-            auto const& buffer = ref->getBitBuffer();
-            return helper.binary(std::vector<uint8_t>(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize()));
-        }
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<std::string>(ref, helper, [](Ref const& e) { return e->toString(); });
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) { return helper.value(ref->toString()); };
+        case zserio::CppType::BIT_BUFFER:
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<std::string>(ref, helper, bitBufferBytes);
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) {
+                auto const& buffer = ref->getBitBuffer();
+                return helper.binary(zserio::Span<const uint8_t>(buffer.getBuffer(), buffer.getByteSize()));
+            };
+        case zserio::CppType::BYTES:
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<std::string>(ref, helper, bytes);
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) {
+                auto const& buffer = ref->getBytes();
+                return helper.binary(zserio::Span<const uint8_t>(buffer.data(), buffer.size()));
+            };
         case zserio::CppType::ENUM:
-        case zserio::CppType::BITMASK: {
-            return reflectableToParameterValue(fieldName, ref, refType.getUnderlyingType(), helper);
-        }
+        case zserio::CppType::BITMASK:
+            return selectEncoder(type.getUnderlyingType(), isArray, fieldName);
         case zserio::CppType::STRUCT:
         case zserio::CppType::CHOICE:
-        case zserio::CppType::UNION: {
-            if (ref->isArray()) {
-                return reflectableArrayToParameterValue<std::string>([&](auto& arr, auto i) {
-                    zserio::BitBuffer buffer(ref->at(i)->bitSizeOf());
-                    zserio::BitStreamWriter writer(buffer);
-                    ref->at(i)->write(writer);
-                    arr.emplace_back(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize());
-                }, ref->size(), helper);
-            }
-            zserio::BitBuffer buffer(ref->bitSizeOf());
-            zserio::BitStreamWriter writer(buffer);
-            ref->write(writer);
-            return helper.binary(std::vector<uint8_t>(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize()));
-        }
+        case zserio::CppType::UNION:
+            if (isArray)
+                return [](Ref const& ref, ParameterValueHelper& helper) {
+                    return encodeArray<std::string>(ref, helper, serialize);
+                };
+            return [](Ref const& ref, ParameterValueHelper& helper) { return helper.binary(serialize(ref)); };
 
         case zserio::CppType::SQL_TABLE:
         case zserio::CppType::SQL_DATABASE:
@@ -121,30 +157,157 @@ ParameterValue reflectableToParameterValue(std::string const& fieldName, zserio:
     throw std::runtime_error(stx::format("Failed to serialize field '{}' for HTTP transport.", fieldName));
 }
 
+bool isCompound(zserio::ITypeInfo const& type)
+{
+    switch (type.getCppType()) {
+        case zserio::CppType::STRUCT:
+        case zserio::CppType::CHOICE:
+        case zserio::CppType::UNION:
+            return true;
+        default:
+            return false;
+    }
+}
+
+[[noreturn]] void throwUnknownField(std::string const& field)
+{
+    throw std::runtime_error(stx::format("Could not find field/function for identifier '{}'", field));
+}
+
+}
+
+OAClient::FieldAccessor const& OAClient::accessor(zserio::ITypeInfo const& type, std::string const& field)
+{
+    {
+        std::shared_lock lock(accessorsMutex_);
+        if (auto forType = accessors_.find(&type); forType != accessors_.end()) {
+            if (auto found = forType->second.find(field); found != forType->second.end())
+                return found->second;
+        }
+    }
+
+    // Resolve the path like IReflectable::find() would: Each segment names
+    // a field of the compound before it, and the last one may name a function.
+    FieldAccessor result;
+    auto const* current = &type;
+    auto isArray = false;
+    std::string::size_type begin = 0;
+    for (;;) {
+        auto const end = field.find('.', begin);
+        auto const name = field.substr(begin, end == std::string::npos ? end : end - begin);
+        if (isArray || !isCompound(*current))
+            throwUnknownField(field);
+
+        auto const* next = static_cast<zserio::ITypeInfo const*>(nullptr);
+        for (auto const& info : current->getFields()) {
+            if (info.schemaName == zserio::StringView(name)) {
+                next = &info.typeInfo;
+                isArray = info.isArray;
+                result.steps.push_back({name, false});
+                break;
+            }
+        }
+        if (!next && end == std::string::npos) {
+            for (auto const& info : current->getFunctions()) {
+                if (info.schemaName == zserio::StringView(name)) {
+                    next = &info.typeInfo;
+                    result.steps.push_back({name, true});
+                    break;
+                }
+            }
+        }
+        if (!next)
+            throwUnknownField(field);
+
+        current = next;
+        if (end == std::string::npos)
+            break;
+        begin = end + 1;
+    }
+    result.encode = selectEncoder(*current, isArray, field);
+
+    std::unique_lock lock(accessorsMutex_);
+    return accessors_[&type].emplace(field, std::move(result)).first->second;
+}
+
+OpenAPIClient::ParameterCallback OAClient::makeParameterCallback(zserio::IServiceData const& requestData)
+{
+    if (!requestData.getReflectable()) {
+        throw std::runtime_error(stx::format("Cannot use OAClient: Make sure that zserio generator call has -withTypeInfoCode flag!"));
+    }
+
+    return [this, &requestData](const std::string& parameter, const std::string& field, ParameterValueHelper& helper) -> ParameterValue {
+        auto reflectable = requestData.getReflectable();
+        if (field == ZSERIO_REQUEST_PART_WHOLE)
+            return helper.binary(serialize(reflectable));
+
+        auto const& fieldAccessor = accessor(reflectable->getTypeInfo(), field);
+        for (auto const& step : fieldAccessor.steps) {
+            try {
+                reflectable = step.isFunction ? reflectable->callFunction(step.name) : reflectable->getField(step.name);
+            }
+            catch (zserio::CppRuntimeException const&) {
+                // E.g. an inactive choice branch.
+                reflectable = nullptr;
+            }
+            if (!reflectable)
+                throwUnknownField(field);
+        }
+        return fieldAccessor.encode(reflectable, helper);
+    };
+}
+
 std::vector<uint8_t> OAClient::callMethod(
     zserio::StringView methodName,
     zserio::IServiceData const& requestData,
     void* context)
 {
-    if (!requestData.getReflectable()) {
-        throw std::runtime_error(stx::format("Cannot use OAClient: Make sure that zserio generator call has -withTypeInfoCode flag!"));
-    }
     const auto strMethodName = std::string(methodName.begin(), methodName.end());
+    auto options = static_cast<CallOptions const*>(context);
+    auto response = client_.call(strMethodName, makeParameterCallback(requestData),
+                                 options ? *options : CallOptions{});
+    return response.toVector();
+}
 
-    auto response = client_.call(strMethodName, [&](const std::string& parameter, const std::string& field, ParameterValueHelper& helper) -> ParameterValue {
-        if (field == ZSERIO_REQUEST_PART_WHOLE) {
-            zserio::BitBuffer buffer(requestData.getReflectable()->bitSizeOf());
-            zserio::BitStreamWriter writer(buffer);
-            requestData.getReflectable()->write(writer);
-            return helper.binary(std::vector<uint8_t>(buffer.getBuffer(), buffer.getBuffer() + buffer.getByteSize()));
-        }
-        auto reflectableField = requestData.getReflectable()->find(field);
-        if (!reflectableField)
-            throw std::runtime_error(stx::format("Could not find field/function for identifier '{}'", field));
-        return reflectableToParameterValue(field, reflectableField, reflectableField->getTypeInfo(), helper);
-    });
+ResponseBuffer OAClient::callMethodBuffer(
+    zserio::StringView methodName,
+    zserio::IServiceData const& requestData,
+    CallOptions const& options)
+{
+    const auto strMethodName = std::string(methodName.begin(), methodName.end());
+    return client_.call(strMethodName, makeParameterCallback(requestData), options);
+}
+
+std::future<std::vector<uint8_t>> OAClient::callMethodAsync(
+    zserio::StringView methodName,
+    zserio::IServiceData const& requestData,
+    CallOptions const& options)
+{
+    auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    auto future = promise->get_future();
+    callMethodAsync(methodName, requestData, [promise](std::vector<uint8_t> response, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(std::move(response));
+    }, options);
+    return future;
+}
 
-    return {response.begin(), response.end()};
+void OAClient::callMethodAsync(
+    zserio::StringView methodName,
+    zserio::IServiceData const& requestData,
+    Completion completion,
+    CallOptions const& options)
+{
+    const auto strMethodName = std::string(methodName.begin(), methodName.end());
+    client_.callAsync(
+        strMethodName,
+        makeParameterCallback(requestData),
+        [completion = std::move(completion)](ResponseBuffer response, std::exception_ptr error) {
+            completion(response.toVector(), error);
+        },
+        options);
 }
 
 }
@@ -1,82 +1,61 @@
 #include "private/openapi-client.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <variant>
 #include <future>
+#include <thread>
+#include <tuple>
 
 #include "stx/format.h"
 #include "spdlog/spdlog.h"
 #include "httpcl/log.hpp"
+#include "httpcl/executor.hpp"
+#include "httpcl/http-cache.hpp"
 
 namespace zswagcl
 {
 
-namespace {
-
-template <class _Fun>
-std::string replaceTemplate(std::string str,
-                            _Fun paramCb)
+namespace
 {
-    auto pos = std::string::size_type(0);
-    while (pos != std::string::npos) {
-        auto begin = str.find('{', pos);
-        if (begin == std::string::npos)
-            break;
-
-        auto end = str.find('}', begin);
-        if (end == std::string::npos)
-            break;
-
-        auto len = end - begin;
-        auto replacement = paramCb(std::string_view(str).substr(begin + 1, len - 1));
 
-        pos = begin + replacement.size();
-        str.replace(begin, len + 1, std::move(replacement));
-    }
-
-    return str;
+/**
+ * Run `task` on the shared pool. Pool workers must not wait for
+ * queue space, as that may be freed only by themselves: They
+ * run the task inline instead if the queue is full.
+ */
+void dispatch(std::function<void()> task, httpcl::Priority priority = httpcl::Priority::Normal)
+{
+    auto& pool = httpcl::ThreadPool::shared();
+    if (!httpcl::ThreadPool::isWorkerThread())
+        pool.post(std::move(task), priority);
+    else if (!pool.tryPost(task, priority))
+        task();
 }
 
-template <class _Fun>
-std::string resolvePath(const OpenAPIConfig::Path& path,
-                        const _Fun paramCb)
+/**
+ * Run `task` on the shared pool from a thread which must not block,
+ * like the Timer thread. While the queue is full, posting is
+ * repeated shortly after on the Timer.
+ */
+/**
+ * Whether a request with the given config was stopped on the client
+ * side, because it was cancelled or the caller's deadline passed,
+ * rather than failing due to the server.
+ */
+bool aborted(httpcl::Config const& config)
 {
-    return replaceTemplate(path.path, [&](std::string_view ident) -> std::string {
-        auto parameterIter = path.parameters.find(std::string(ident));
-        if (parameterIter == path.parameters.end())
-            throw std::runtime_error(stx::format("Could not find path parameter for name '{}' (path: '{}')", ident, path.path));
-
-        const auto& parameter = parameterIter->second;
-
-        ParameterValueHelper helper(parameter);
-        auto value = paramCb(parameter.ident, parameter.field, helper);
-
-        return value.pathStr(parameter);
-    });
+    return (config.cancellation && config.cancellation->cancelled()) ||
+           (config.deadline && std::chrono::steady_clock::now() >= *config.deadline);
 }
 
-template <class _Fun>
-void resolveHeaderAndQueryParameters(httpcl::Config& result,
-                                     const OpenAPIConfig::Path& path,
-                                     const _Fun paramCb)
+void postNonBlocking(std::function<void()> task, httpcl::Priority priority)
 {
-    for (const auto& [key, parameter] : path.parameters) {
-        switch (parameter.location) {
-        case OpenAPIConfig::ParameterLocation::Query:
-        case OpenAPIConfig::ParameterLocation::Header:
-        {
-            ParameterValueHelper helper(parameter);
-            auto values = paramCb(parameter.ident, parameter.field, helper).queryOrHeaderPairs(parameter);
-            auto& destination = (parameter.location == OpenAPIConfig::ParameterLocation::Header) ?
-                result.headers : result.query;
-            for (auto const& value : values)
-                destination.insert(value);
-            break;
-        }
-        default:
-            break;
-        }
-    }
+    if (httpcl::ThreadPool::shared().tryPost(task, priority))
+        return;
+    httpcl::Timer::shared().schedule(std::chrono::milliseconds(10), [task = std::move(task), priority]{
+        postNonBlocking(task, priority);
+    });
 }
 
 }
@@ -87,7 +66,7 @@ OpenAPIClient::OpenAPIClient(OpenAPIConfig config,
                              uint32_t serverIndex)
     : config_(std::move(config))
     , httpConfig_(std::move(httpConfig))
-    , client_(std::move(client))
+    , client_(httpcl::CachingHttpClient::wrapFromEnv(std::move(client)))
 {
     if (serverIndex >= config_.servers.size())
         throw httpcl::logRuntimeError(
@@ -95,117 +74,830 @@ OpenAPIClient::OpenAPIClient(OpenAPIConfig config,
                 "The server index {} is out of bounds (servers.size()={}).",
                 serverIndex,
                 config_.servers.size()));
-    server_ = config_.servers[serverIndex];
-    httpcl::log().debug("Instantiating OpenApiClient for node at '{}'", server_.build());
+    serverIndex_ = serverIndex;
+    for (const auto& server : config_.servers)
+        serverHosts_.push_back(server.buildHost());
+    httpcl::log().debug("Instantiating OpenApiClient for node at '{}'", config_.servers[serverIndex].build());
     assert(client_);
+
+    plans_.reserve(config_.methodPath.size());
+    for (const auto& [ident, method] : config_.methodPath)
+        plans_.emplace(ident, compile(method));
+
+    balancer_ = std::make_shared<httpcl::LoadBalancer>(
+        config_.servers.size(), httpcl::loadBalancingFromEnv(), serverIndex);
+
+    auto probeInterval = httpcl::probeIntervalFromEnv();
+    if (balancer_->mode() != httpcl::LoadBalancing::Off &&
+        balancer_->size() > 1 &&
+        probeInterval.count() > 0)
+    {
+        std::vector<std::string> urls;
+        std::vector<httpcl::Config> probeConfigs;
+        for (const auto& server : config_.servers) {
+            urls.push_back(server.build());
+            probeConfigs.push_back(settings_[urls.back()]);
+            probeConfigs.back() |= httpConfig_;
+        }
+
+        // Probes must reach the servers, not the response cache. The
+        // aliasing pointer keeps the probe bound to the lifetime of client_.
+        std::shared_ptr<httpcl::IHttpClient> transport = client_;
+        if (auto caching = dynamic_cast<httpcl::CachingHttpClient*>(client_.get()))
+            transport = std::shared_ptr<httpcl::IHttpClient>(client_, &caching->transport());
+        balancer_->startProbing(transport, std::move(urls), std::move(probeConfigs), probeInterval);
+    }
+}
+
+OpenAPIClient::~OpenAPIClient()
+{
+    // Duplicates of hedged requests which lost may still be running.
+    std::unique_lock lock(hedgeTasksMutex_);
+    hedgeTasksDone_.wait(lock, [this]{ return hedgeTasks_ == 0; });
+    lock.unlock();
+
+    // Background token refreshes use the client as well.
+    authHandlers_.waitForBackgroundTasks();
+}
+
+OpenAPIClient::CallPlan OpenAPIClient::compile(const OpenAPIConfig::Path& method) const
+{
+    CallPlan plan;
+    plan.method = &method;
+
+    // Split the path template into literal text and {parameter} slots.
+    const auto& path = method.path;
+    auto pos = std::string::size_type(0);
+    while (pos < path.size()) {
+        auto begin = path.find('{', pos);
+        auto end = begin == std::string::npos ? std::string::npos : path.find('}', begin);
+        if (end == std::string::npos) {
+            plan.pathSegments.push_back({false, path.substr(pos), nullptr});
+            break;
+        }
+
+        if (begin > pos)
+            plan.pathSegments.push_back({false, path.substr(pos, begin - pos), nullptr});
+
+        CallPlan::PathSegment slot{true, path.substr(begin + 1, end - begin - 1), nullptr};
+        auto parameterIter = method.parameters.find(slot.text);
+        if (parameterIter != method.parameters.end())
+            slot.parameter = &parameterIter->second;
+        plan.pathSegments.push_back(std::move(slot));
+        pos = end + 1;
+    }
+
+    auto hasSlots = std::any_of(plan.pathSegments.begin(), plan.pathSegments.end(),
+                                [](auto const& segment) { return segment.isSlot; });
+    if (!hasSlots) {
+        for (const auto& server : config_.servers) {
+            auto uri = server;
+            uri.appendPath(path);
+            plan.staticPathAndQuery.push_back(uri.buildPath());
+        }
+    }
+
+    for (const auto& [key, parameter] : method.parameters) {
+        if (parameter.location == OpenAPIConfig::ParameterLocation::Query)
+            plan.queryParameters.push_back(&parameter);
+        else if (parameter.location == OpenAPIConfig::ParameterLocation::Header)
+            plan.headerParameters.push_back(&parameter);
+    }
+
+    plan.security = method.security ? &*method.security : &config_.defaultSecurityScheme;
+    plan.latencies = std::make_unique<httpcl::LatencyWindow>();
+
+    const auto& httpMethod = method.httpMethod;
+    if (httpMethod == "POST")
+        plan.httpMethodFun = &httpcl::IHttpClient::post;
+    else if (httpMethod == "PUT")
+        plan.httpMethodFun = &httpcl::IHttpClient::put;
+    else if (httpMethod == "PATCH")
+        plan.httpMethodFun = &httpcl::IHttpClient::patch;
+    else if (httpMethod == "DELETE")
+        plan.httpMethodFun = &httpcl::IHttpClient::del;
+    else if (httpMethod != "GET")
+        plan.supportedHttpMethod = false;
+
+    return plan;
+}
+
+ResponseBuffer OpenAPIClient::call(const std::string& methodIdent,
+                                   const std::function<ParameterValue(const std::string&, /* parameter ident */
+                                                                      const std::string&, /* zserio member path */
+                                                                      ParameterValueHelper&)>& paramCb,
+                                   const CallOptions& options)
+{
+    auto request = prepare(methodIdent, paramCb, options);
+    if (request.cacheTtl) {
+        if (auto cached = responseCache_.get(request.key))
+            return ResponseBuffer(std::move(cached));
+    }
+    if (!coalescable(request))
+        return send(request);
+
+    const auto& key = request.key;
+    auto [flight, leader] = board(key);
+    if (leader) {
+        ResponseBuffer response;
+        std::exception_ptr error;
+        try {
+            response = send(request);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        land(key, *flight, response, error);
+        if (error)
+            std::rethrow_exception(error);
+        return response;
+    }
+
+    std::unique_lock lock(flight->mutex);
+    auto finished = [&flight = *flight]{ return flight.finished; };
+    if (const auto& deadline = request.parameters.deadline) {
+        if (!flight->landed.wait_until(lock, *deadline, finished))
+            throw httpcl::logRuntimeError<httpcl::DeadlineExceededError>(stx::format(
+                "{} Deadline exceeded while waiting for an identical call.", request.debugContext));
+    }
+    else
+        flight->landed.wait(lock, finished);
+
+    if (flight->error)
+        std::rethrow_exception(flight->error);
+    return flight->response;
+}
+
+std::future<ResponseBuffer> OpenAPIClient::callAsync(const std::string& methodIdent,
+                                                     const ParameterCallback& paramCb,
+                                                     const CallOptions& options)
+{
+    auto promise = std::make_shared<std::promise<ResponseBuffer>>();
+    auto future = promise->get_future();
+    callAsync(methodIdent, paramCb, [promise](ResponseBuffer response, std::exception_ptr error) {
+        if (error)
+            promise->set_exception(error);
+        else
+            promise->set_value(std::move(response));
+    }, options);
+    return future;
+}
+
+void OpenAPIClient::callAsync(const std::string& methodIdent,
+                              const ParameterCallback& paramCb,
+                              Completion completion,
+                              const CallOptions& options)
+{
+    auto request = std::make_shared<Request>(prepare(methodIdent, paramCb, options));
+    if (request->cacheTtl) {
+        if (auto cached = responseCache_.get(request->key)) {
+            dispatch([completion = std::move(completion), cached]{
+                completion(ResponseBuffer(cached), nullptr);
+            }, request->priority);
+            return;
+        }
+    }
+
+    std::string key;
+    std::shared_ptr<Flight> flight;
+    if (coalescable(*request)) {
+        key = request->key;
+        bool leader;
+        std::tie(flight, leader) = board(key);
+        if (!leader) {
+            // The completion is called once the leader lands.
+            std::unique_lock lock(flight->mutex);
+            if (!flight->finished) {
+                flight->completions.emplace_back(std::move(completion));
+                return;
+            }
+            auto response = flight->response;
+            auto error = flight->error;
+            lock.unlock();
+            dispatch([completion = std::move(completion), response = std::move(response), error]() mutable {
+                completion(std::move(response), error);
+            });
+            return;
+        }
+    }
+
+    dispatch([this, request, key, flight, completion = std::move(completion)]{
+        sendAsync(request, std::make_shared<Attempts>(),
+            [this, key, flight, completion](ResponseBuffer response, std::exception_ptr error) {
+                if (flight)
+                    land(key, *flight, response, error);
+                completion(std::move(response), error);
+            });
+    }, request->priority);
+}
+
+bool OpenAPIClient::coalescable(Request const& request) const
+{
+    // A cancelled leader would fail all of its followers.
+    return request.plan->method->coalesce && !request.parameters.cancellation;
+}
+
+std::string OpenAPIClient::requestKey(Request const& request)
+{
+    const auto& plan = *request.plan;
+    std::string key = plan.method->httpMethod;
+    auto append = [&key](std::string_view part) {
+        key += '\0';
+        key += part;
+    };
+
+    append(plan.method->path);
+    append(request.path);
+    for (const auto& [name, value] : request.parameters.query) {
+        append(name);
+        append(value);
+    }
+    for (const auto& [name, value] : request.parameters.headers) {
+        append(name);
+        append(value);
+    }
+    if (request.body)
+        append(request.body->body);
+    return key;
+}
+
+std::pair<std::shared_ptr<OpenAPIClient::Flight>, bool> OpenAPIClient::board(std::string const& key)
+{
+    std::lock_guard lock(flightsMutex_);
+    auto& flight = flights_[key];
+    if (!flight) {
+        flight = std::make_shared<Flight>();
+        return {flight, true};
+    }
+
+    ++coalescedCalls_;
+    std::lock_guard flightLock(flight->mutex);
+    ++flight->followers;
+    return {flight, false};
 }
 
-OpenAPIClient::~OpenAPIClient() = default;
+void OpenAPIClient::land(std::string const& key, Flight& flight, ResponseBuffer const& response, std::exception_ptr error)
+{
+    // Calls which start from now on take off on their own.
+    {
+        std::lock_guard lock(flightsMutex_);
+        flights_.erase(key);
+    }
+
+    std::vector<Completion> completions;
+    {
+        std::lock_guard lock(flight.mutex);
+        flight.response = response;
+        flight.error = error;
+        flight.finished = true;
+        completions.swap(flight.completions);
+    }
+    flight.landed.notify_all();
+
+    for (auto& completion : completions) {
+        dispatch([completion = std::move(completion), response, error]() mutable {
+            completion(std::move(response), error);
+        });
+    }
+}
 
-std::string OpenAPIClient::call(const std::string& methodIdent,
-                                const std::function<ParameterValue(const std::string&, /* parameter ident */
-                                                                   const std::string&, /* zserio member path */
-                                                                   ParameterValueHelper&)>& paramCb)
+OpenAPIClient::Request OpenAPIClient::prepare(const std::string& methodIdent,
+                                              const ParameterCallback& paramCb,
+                                              const CallOptions& options)
 {
-    auto methodIter = config_.methodPath.find(methodIdent);
-    if (methodIter == config_.methodPath.end())
+    auto planIter = plans_.find(methodIdent);
+    if (planIter == plans_.end())
         throw httpcl::logRuntimeError(stx::format("The method '{}' is not part of the used OpenAPI specification", methodIdent));
 
-    const auto& method = methodIter->second;
+    const auto& plan = planIter->second;
+    const auto& method = *plan.method;
+    Request request{&plan};
 
-    auto uri = server_;
-    uri.appendPath(resolvePath(method, paramCb));
-    std::string builtUri = uri.build();
-    std::string debugContext = stx::format("[{} {}]", method.httpMethod, uri.buildPath());
-    httpcl::log().debug("{} Calling endpoint {} ...", debugContext, builtUri);
+    if (plan.staticPathAndQuery.empty()) {
+        request.path.reserve(method.path.size() * 2);
+        for (const auto& segment : plan.pathSegments) {
+            if (!segment.isSlot) {
+                request.path += segment.text;
+                continue;
+            }
+            if (!segment.parameter)
+                throw std::runtime_error(stx::format("Could not find path parameter for name '{}' (path: '{}')", segment.text, method.path));
 
-    // Initialize HTTP config from persistent and ad-hoc values
-    auto httpConfig = settings_[builtUri];
-    httpConfig |= httpConfig_;
+            const auto& parameter = *segment.parameter;
+            ParameterWriter writer(parameter, request.path);
+            ParameterValueHelper helper(parameter, writer);
+            paramCb(parameter.ident, parameter.field, helper).write(writer);
+        }
+    }
+
+    auto uri = buildUri(request, serverIndex_);
+    request.debugContext = stx::format("[{} {}]", method.httpMethod, uri.substr(serverHosts_[serverIndex_].size()));
+    const auto& debugContext = request.debugContext;
+    httpcl::log().debug("{} Calling endpoint {} ...", debugContext, uri);
 
     // Make sure that the server responds with correct content type
-    httpConfig.headers.insert({"Accept", ZSERIO_OBJECT_CONTENT_TYPE});
+    request.parameters.headers.insert({"Accept", ZSERIO_OBJECT_CONTENT_TYPE});
+
+    request.parameters.headers.insert(options.headers.begin(), options.headers.end());
+    request.parameters.cancellation = options.cancellation;
+    request.priority = options.priority;
+    if (options.deadline)
+        request.parameters.deadline = options.deadline;
+    else if (method.timeout)
+        request.parameters.deadline = CallOptions::Clock::now() + *method.timeout;
 
     httpcl::log().debug("{} Resolving query/path parameters ...", debugContext);
-    resolveHeaderAndQueryParameters(httpConfig, method, paramCb);
+    for (const auto* parameter : plan.queryParameters) {
+        ParameterWriter writer(*parameter, request.parameters.query);
+        ParameterValueHelper helper(*parameter, writer);
+        paramCb(parameter->ident, parameter->field, helper).write(writer);
+    }
+    for (const auto* parameter : plan.headerParameters) {
+        ParameterWriter writer(*parameter, request.parameters.headers);
+        ParameterValueHelper helper(*parameter, writer);
+        paramCb(parameter->ident, parameter->field, helper).write(writer);
+    }
 
-    // Check whether the given config fulfills the required security schemes.
-    // Throws if the http config does not fulfill any allowed scheme.
-    if (method.security) {
-        httpcl::log().debug("{} Checking required security schemes for method ...", debugContext);
-        authHandlers_.satisfySecurity(
-            *method.security,
-            {*client_, builtUri, settings_, httpConfig});
+    if (method.httpMethod != "GET" && method.bodyRequestObject) {
+        httpcl::log().debug("{} Fetching body request body ...", debugContext);
+        request.body = httpcl::BodyAndContentType{
+            "", ZSERIO_OBJECT_CONTENT_TYPE
+        };
+
+        OpenAPIConfig::Parameter bodyParameter;
+        bodyParameter.ident = "body";
+        bodyParameter.format = OpenAPIConfig::Parameter::Format::Binary;
+
+        ParameterValueHelper bodyHelper(bodyParameter);
+        request.body->body = paramCb("", ZSERIO_REQUEST_PART_WHOLE, bodyHelper).bodyStr();
     }
-    else {
-        httpcl::log().debug("{} Checking default security scheme ...", debugContext);
-        authHandlers_.satisfySecurity(
-            config_.defaultSecurityScheme,
-            {*client_, builtUri, settings_, httpConfig});
+
+    // Same precedence as for the other settings: Ad-hoc config, http-settings, spec.
+    request.cacheTtl = httpConfig_.cacheTtl;
+    if (!request.cacheTtl)
+        request.cacheTtl = settings_[uri].cacheTtl;
+    if (!request.cacheTtl)
+        request.cacheTtl = method.cacheTtl;
+    if (request.cacheTtl && request.cacheTtl->count() <= 0)
+        request.cacheTtl.reset();
+
+    if (request.cacheTtl || method.coalesce)
+        request.key = requestKey(request);
+
+    return request;
+}
+
+std::string OpenAPIClient::buildUri(Request const& request, uint32_t server) const
+{
+    const auto& plan = *request.plan;
+    if (!plan.staticPathAndQuery.empty())
+        return serverHosts_[server] + plan.staticPathAndQuery[server];
+
+    auto uri = config_.servers[server];
+    uri.appendPath(request.path);
+    return serverHosts_[server] + uri.buildPath();
+}
+
+ResponseBuffer OpenAPIClient::send(Request& request)
+{
+    Attempts attempts;
+    for (;;) {
+        if (auto response = sendOnce(request, attempts))
+            return std::move(*response);
+
+        if (const auto& cancellation = request.parameters.cancellation)
+            cancellation->waitFor(attempts.delay);
+        else
+            std::this_thread::sleep_for(attempts.delay);
     }
+}
 
-    const auto& httpMethod = method.httpMethod;
-    std::future<httpcl::IHttpClient::Result> resultFuture = ([&]()
-    {
-        if (httpMethod == "GET") {
-            httpcl::log().debug("{} Executing request ...", debugContext);
-            return std::async(std::launch::async, [builtUri, httpConfig, this]{
-                return client_->get(builtUri, httpConfig);
-            });
-        } else {
-            httpcl::OptionalBodyAndContentType body;
-            if (method.bodyRequestObject) {
-                httpcl::log().debug("{} Fetching body request body ...", debugContext);
-                body = httpcl::BodyAndContentType{
-                    "", ZSERIO_OBJECT_CONTENT_TYPE
-                };
-
-                OpenAPIConfig::Parameter bodyParameter;
-                bodyParameter.ident = "body";
-                bodyParameter.format = OpenAPIConfig::Parameter::Format::Binary;
-
-                ParameterValueHelper bodyHelper(bodyParameter);
-                body->body = paramCb("", ZSERIO_REQUEST_PART_WHOLE, bodyHelper).bodyStr();
+void OpenAPIClient::sendAsync(std::shared_ptr<Request> request,
+                              std::shared_ptr<Attempts> attempts,
+                              Completion completion)
+{
+    std::optional<ResponseBuffer> response;
+    try {
+        response = sendOnce(*request, *attempts);
+    }
+    catch (...) {
+        completion({}, std::current_exception());
+        return;
+    }
+    if (response) {
+        completion(std::move(*response), nullptr);
+        return;
+    }
+
+    // Resumed by the timer or by cancellation, whichever comes first.
+    // A cancelled call fails right away in sendOnce().
+    struct Wait {
+        std::atomic<bool> resumed{false};
+        std::atomic<httpcl::CancellationToken::CallbackId> subscription{0};
+        std::atomic<httpcl::Timer::TaskId> timerTask{0};
+    };
+    auto wait = std::make_shared<Wait>();
+    auto& timer = httpcl::Timer::shared();
+    const auto& cancellation = request->parameters.cancellation;
+    auto resume = [=, &timer]{
+        if (wait->resumed.exchange(true))
+            return;
+        postNonBlocking([=, &timer]{
+            timer.cancel(wait->timerTask);
+            if (cancellation)
+                cancellation->unsubscribe(wait->subscription);
+            sendAsync(request, attempts, completion);
+        }, request->priority);
+    };
+
+    // Subscribe first, so that the subscription is
+    // known once the timer resumes the request.
+    if (cancellation)
+        wait->subscription = cancellation->subscribe(resume);
+    wait->timerTask = timer.schedule(attempts->delay, resume);
+}
+
+std::optional<ResponseBuffer> OpenAPIClient::sendOnce(Request& request, Attempts& attempts)
+{
+    const auto& plan = *request.plan;
+    const auto& debugContext = request.debugContext;
+
+    auto attemptNumber = ++attempts.number;
+    if (attemptNumber == 1)
+        attempts.server = static_cast<uint32_t>(balancer_->pick());
+    auto& server = attempts.server;
+    auto& policy = attempts.policy;
+    auto& hedge = attempts.hedge;
+    auto& idempotent = attempts.idempotent;
+
+    checkLimits(request);
+
+    // Skip servers with an open circuit. No request is sent
+    // to them, so this does not count as an attempt.
+    auto target = resolve(request, server);
+    for (auto skipped = 1u; !target; ++skipped) {
+        if (skipped >= serverHosts_.size())
+            throw httpcl::logRuntimeError<httpcl::CircuitOpenError>(stx::format(
+                "{} Circuit breaker is open for all servers.", debugContext));
+        httpcl::log().debug("{} Circuit breaker for {} is open, failing over.", debugContext, serverHosts_[server]);
+        server = (server + 1) % serverHosts_.size();
+        target = resolve(request, server);
+    }
+    const auto& httpConfig = target->httpConfig;
+
+    // The settings of the first server decide on the policies for the whole call.
+    if (!policy) {
+        if (httpConfig.retry)
+            policy = httpConfig.retry;
+        else if (plan.method->retry)
+            policy = plan.method->retry;
+        else {
+            policy.emplace();
+            policy->maxAttempts = 1;
+        }
+
+        idempotent = httpConfig.idempotent.value_or(plan.method->idempotent);
+
+        if (httpConfig.idempotent.value_or(plan.method->hedgeable))
+            hedge = httpConfig.hedge ? httpConfig.hedge : plan.method->hedge;
+    }
+
+    auto result = hedge ? hedgedAttempt(request, *target, *hedge) : attempt(request, *target);
+    if (result.status == 200) {
+        ResponseBuffer response(std::move(result.content));
+        if (request.cacheTtl)
+            responseCache_.put(request.key, response.shared(), *request.cacheTtl);
+        return response;
+    }
+    if (result.status == 0)
+        checkLimits(request);
+
+    auto retry = attemptNumber < policy->maxAttempts &&
+                 policy->retryable(result.status) &&
+                 (idempotent || policy->nonIdempotent);
+
+    std::chrono::milliseconds delay{0};
+    if (retry) {
+        delay = policy->backoff(attemptNumber);
+        if (auto retryAfter = httpcl::parseRetryAfter(result.header("Retry-After"))) {
+            if (*retryAfter > policy->maxBackoff) {
+                httpcl::log().debug("{} Retry-After of {}ms exceeds the maximum backoff.", debugContext, retryAfter->count());
+                retry = false;
             }
+            delay = std::max(delay, *retryAfter);
+        }
+    }
+
+    if (!retry) {
+        // Throw due to bad response code
+        std::string errorStr = stx::format(
+            "{} Got HTTP status: {}",
+            debugContext,
+            result.status);
+        throw httpcl::IHttpClient::Error(result, errorStr);
+    }
+
+    if (policy->failover)
+        server = (server + 1) % serverHosts_.size();
+    httpcl::log().debug("{} Got HTTP status {}, retrying at {} in {}ms (attempt {}/{}).",
+                        debugContext, result.status, serverHosts_[server], delay.count(),
+                        attemptNumber + 1, policy->maxAttempts);
+
+    // Do not wait for a retry which could not finish in time anyway.
+    const auto& deadline = request.parameters.deadline;
+    if (deadline && CallOptions::Clock::now() + delay >= *deadline)
+        throw httpcl::logRuntimeError<httpcl::DeadlineExceededError>(stx::format(
+            "{} Deadline exceeded before retrying after HTTP status {}.", debugContext, result.status));
 
-            httpcl::log().debug("{} Executing request ...", debugContext);
-            if (httpMethod == "POST")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->post(builtUri, body, httpConfig);
-                });
-            if (httpMethod == "PUT")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->put(builtUri, body, httpConfig);
-                });
-            if (httpMethod == "PATCH")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->patch(builtUri, body, httpConfig);
-                });
-            if (httpMethod == "DELETE")
-                return std::async(std::launch::async, [builtUri, body, httpConfig, this]{
-                    return client_->del(builtUri, body, httpConfig);
-                });
+    attempts.delay = delay;
+    return {};
+}
+
+void OpenAPIClient::checkLimits(Request const& request) const
+{
+    const auto& parameters = request.parameters;
+    if (parameters.cancellation && parameters.cancellation->cancelled())
+        throw httpcl::CancelledError(stx::format("{} Call was cancelled.", request.debugContext));
+    if (parameters.deadline && CallOptions::Clock::now() >= *parameters.deadline)
+        throw httpcl::logRuntimeError<httpcl::DeadlineExceededError>(stx::format(
+            "{} Deadline exceeded.", request.debugContext));
+}
+
+std::optional<OpenAPIClient::Target> OpenAPIClient::resolve(Request const& request, uint32_t server)
+{
+    Target target;
+    target.server = server;
+
+    // Initialize HTTP config from persistent and ad-hoc values
+    target.uri = buildUri(request, server);
+    target.httpConfig = settings_[target.uri];
+    target.httpConfig |= httpConfig_;
+    target.httpConfig |= request.parameters;
+
+    if (target.httpConfig.circuitBreaker) {
+        target.breaker = httpcl::CircuitBreakerRegistry::instance().get(
+            serverHosts_[server], *target.httpConfig.circuitBreaker);
+        if (!target.breaker->allow())
+            return {};
+    }
+    return target;
+}
+
+httpcl::IHttpClient::Result OpenAPIClient::attempt(Request const& request, Target& target)
+{
+    const auto& plan = *request.plan;
+    const auto& debugContext = request.debugContext;
+    const auto& uri = target.uri;
+    auto& httpConfig = target.httpConfig;
+
+    httpcl::IHttpClient::Result result;
+    try {
+        // Check whether the given config fulfills the required security schemes.
+        // Throws if the http config does not fulfill any allowed scheme.
+        httpcl::log().debug("{} Checking {} security schemes ...", debugContext,
+                            plan.method->security ? "required" : "default");
+        authHandlers_.satisfySecurity(
+            *plan.security,
+            {*client_, uri, settings_, httpConfig});
 
+        if (!plan.supportedHttpMethod)
             throw httpcl::logRuntimeError(stx::format(
                 "{} Unsupported HTTP method!", debugContext));
+
+        // The request, body and config are only referenced, as execute() blocks until done.
+        httpcl::log().debug("{} Executing request ...", debugContext);
+        balancer_->begin(target.server);
+        auto started = httpcl::LoadBalancer::Clock::now();
+        try {
+            httpcl::execute(executionPolicy_, debugContext, [&]{
+                if (plan.httpMethodFun)
+                    result = ((*client_).*plan.httpMethodFun)(uri, request.body, httpConfig);
+                else
+                    result = client_->get(uri, httpConfig);
+            }, request.priority);
+        }
+        catch (...) {
+            if (aborted(httpConfig))
+                balancer_->abandon(target.server);
+            else
+                balancer_->end(target.server, httpcl::LoadBalancer::Clock::now() - started, false);
+            throw;
         }
-    }());
+        if (result.status == 0 && aborted(httpConfig))
+            balancer_->abandon(target.server);
+        else
+            balancer_->end(target.server, httpcl::LoadBalancer::Clock::now() - started,
+                           result.status != 0 && result.status < 500);
+    }
+    catch (...) {
+        if (target.breaker)
+            target.breaker->abandon();
+        throw;
+    }
+    if (target.breaker) {
+        // A request which was stopped on purpose, e.g. a hedge which
+        // lost or a call which ran out of time, says nothing about the server.
+        if (result.status == 0 && aborted(httpConfig))
+            target.breaker->abandon();
+        else
+            target.breaker->record(result.status);
+    }
 
-    // Wait for resultFuture
-    while (resultFuture.wait_for(std::chrono::seconds{1}) != std::future_status::ready)
-        httpcl::log().debug("{} Waiting for response ...", debugContext);
-    auto result = resultFuture.get();
     httpcl::log().debug("{} Response received (code {}, content length {} bytes).", debugContext, result.status, result.content.size());
+    return result;
+}
 
-    if (result.status == 200) {
-        return std::move(result.content);
+namespace
+{
+
+/**
+ * Outcome of a hedged attempt, shared by the caller
+ * and the tasks which execute the duplicates.
+ */
+struct HedgeState
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    /** Tasks which did not finish yet. */
+    uint32_t pending = 0;
+    /** First definitive response, and the index of its duplicate. */
+    std::optional<httpcl::IHttpClient::Result> response;
+    uint32_t winner = 0;
+    /** First failure, in case no duplicate gets a definitive response. */
+    std::optional<httpcl::IHttpClient::Result> failure;
+    std::exception_ptr error;
+    /** Cancellation token of each duplicate, by index. */
+    std::vector<std::shared_ptr<httpcl::CancellationToken>> cancellations;
+};
+
+/**
+ * A response is definitive if it is not a server error, as
+ * retrying it elsewhere would give the same result.
+ */
+bool isDefinitive(httpcl::IHttpClient::Result const& result)
+{
+    return result.status != 0 && result.status < 500;
+}
+
+}
+
+httpcl::IHttpClient::Result OpenAPIClient::hedgedAttempt(Request const& request,
+                                                         Target& primary,
+                                                         httpcl::HedgePolicy const& policy)
+{
+    const auto& plan = *request.plan;
+    const auto& debugContext = request.debugContext;
+    auto started = std::chrono::steady_clock::now();
+    auto recordLatency = [&](httpcl::IHttpClient::Result const& result) {
+        if (isDefinitive(result))
+            plan.latencies->add(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started));
+    };
+
+    ++hedgeAttempts_;
+    auto delay = policy.hedgeDelay(*plan.latencies);
+    if (!delay) {
+        auto result = attempt(request, primary);
+        recordLatency(result);
+        return result;
+    }
+
+    // Duplicates may outlive this call, so they get their own copy of the request.
+    auto state = std::make_shared<HedgeState>();
+    auto sharedRequest = std::make_shared<Request>(request);
+    auto onWorker = httpcl::ThreadPool::isWorkerThread();
+    auto launch = [&](Target target, uint32_t index) {
+        // Each duplicate can be cancelled on its own, and along with the caller's call.
+        auto cancellation = std::make_shared<httpcl::CancellationToken>();
+        auto parent = std::move(target.httpConfig.cancellation);
+        std::optional<httpcl::CancellationToken::CallbackId> parentCallback;
+        if (parent)
+            parentCallback = parent->subscribe([cancellation]{ cancellation->cancel(); });
+        target.httpConfig.cancellation = cancellation;
+        {
+            std::lock_guard lock(state->mutex);
+            ++state->pending;
+            state->cancellations.push_back(cancellation);
+        }
+        {
+            std::lock_guard lock(hedgeTasksMutex_);
+            ++hedgeTasks_;
+        }
+        auto task = [this, state, sharedRequest, target = std::move(target), index,
+                     parent, parentCallback]() mutable {
+            std::optional<httpcl::IHttpClient::Result> result;
+            std::exception_ptr error;
+
+            bool decided;
+            {
+                std::lock_guard lock(state->mutex);
+                decided = state->response.has_value();
+            }
+            if (decided) {
+                // Cancelled before it was sent.
+                if (target.breaker)
+                    target.breaker->abandon();
+            }
+            else {
+                try {
+                    result = attempt(*sharedRequest, target);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+            }
+
+            if (parentCallback)
+                parent->unsubscribe(*parentCallback);
+
+            std::vector<std::shared_ptr<httpcl::CancellationToken>> losers;
+            {
+                std::lock_guard lock(state->mutex);
+                --state->pending;
+                if (result && isDefinitive(*result) && !state->response) {
+                    state->response = std::move(result);
+                    state->winner = index;
+                    losers = state->cancellations;
+                    losers.erase(losers.begin() + index);
+                }
+                else if (!state->response && !state->failure && !state->error) {
+                    if (result)
+                        state->failure = std::move(result);
+                    else if (error)
+                        state->error = error;
+                }
+            }
+            state->changed.notify_all();
+
+            // The other duplicates are not needed anymore.
+            for (auto const& loser : losers)
+                loser->cancel();
+
+            std::lock_guard lock(hedgeTasksMutex_);
+            if (--hedgeTasks_ == 0)
+                hedgeTasksDone_.notify_all();
+        };
+
+        // A pool worker waiting for duplicates on the pool could starve it,
+        // e.g. for async calls. Their duplicates get threads of their own,
+        // which at most adds max-hedges + 1 threads per waiting worker.
+        if (onWorker)
+            std::thread(std::move(task)).detach();
+        else
+            dispatch(std::move(task), request.priority);
+    };
+
+    launch(primary, 0);
+    auto server = primary.server;
+    auto hedges = 0u;
+    // Each duplicate goes to a server which did not get the request yet.
+    std::vector<bool> tried(serverHosts_.size(), false);
+    tried[primary.server] = true;
+    auto deadline = std::chrono::steady_clock::now() + *delay;
+
+    std::unique_lock lock(state->mutex);
+    while (!state->response && state->pending > 0) {
+        if (hedges >= policy.maxHedges) {
+            state->changed.wait(lock);
+            continue;
+        }
+        if (!state->changed.wait_until(lock, deadline, [&]{ return state->response || state->pending == 0; })) {
+            // No response yet, send a duplicate to the next untried server with a closed circuit.
+            lock.unlock();
+            std::optional<Target> target;
+            for (auto i = 0u; !target && i < serverHosts_.size(); ++i) {
+                server = (server + 1) % serverHosts_.size();
+                if (tried[server])
+                    continue;
+                tried[server] = true;
+                target = resolve(request, server);
+            }
+            if (target) {
+                httpcl::log().debug("{} No response after {}us, sending duplicate to {}.",
+                                    debugContext, delay->count(), serverHosts_[target->server]);
+                ++hedges_;
+                launch(std::move(*target), ++hedges);
+            }
+            else
+                hedges = policy.maxHedges;
+            deadline = std::chrono::steady_clock::now() + *delay;
+            lock.lock();
+        }
+    }
+
+    if (state->response) {
+        if (state->winner > 0)
+            ++hedgeWins_;
+        recordLatency(*state->response);
+        return std::move(*state->response);
     }
+    if (state->error)
+        std::rethrow_exception(state->error);
+    return std::move(*state->failure);
+}
 
-    // Throw due to bad response code
-    std::string errorStr = stx::format(
-        "{} Got HTTP status: {}",
-        debugContext,
-        result.status);
-    throw httpcl::IHttpClient::Error(result, errorStr);
+OpenAPIClient::HedgeStats OpenAPIClient::hedgeStats() const
+{
+    return {hedgeAttempts_.load(), hedges_.load(), hedgeWins_.load()};
 }
 }
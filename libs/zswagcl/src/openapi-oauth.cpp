@@ -3,6 +3,7 @@
 #include <stx/format.h>
 
 #include "base64.hpp"
+#include "httpcl/executor.hpp"
 #include "httpcl/oauth1-signature.hpp"
 
 #include <stx/string.h>
@@ -16,6 +17,26 @@ namespace zswagcl
 using SecurityRequirement = OpenAPIConfig::SecurityRequirement;
 using SecuritySchemeType = OpenAPIConfig::SecuritySchemeType;
 
+namespace
+{
+
+/**
+ * Published to the callers waiting for a token request which was
+ * aborted by the deadline or cancellation of the caller running it.
+ */
+struct AbortedTokenRequest : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+bool callExpired(httpcl::Config const& config)
+{
+    return (config.cancellation && config.cancellation->cancelled()) ||
+           (config.deadline && steady_clock::now() >= *config.deadline);
+}
+
+}
+
 bool OAuth2ClientCredentialsHandler::satisfy(
     const SecurityRequirement& req, AuthContext const& ctx, std::string& mismatchReason)
 {
@@ -50,67 +71,265 @@ bool OAuth2ClientCredentialsHandler::satisfy(
     TokenKey key{tokenUrl, oauthConfig.clientId, oauthConfig.audience, scopeKey};
 
     // Try cache
+    bool refreshDue = false;
     {
         std::shared_lock lk(m_);
         auto it = cache_.find(key);
-        if (it != cache_.end() && steady_clock::now() < it->second.expiresAt) {
+        auto now = steady_clock::now();
+        if (it != cache_.end() && now < it->second.expiresAt) {
             httpcl::log().debug("[OAuth2] Using cached token (still valid)");
             ctx.resultHttpConfigWithAuthorization.headers.insert({"Authorization", "Bearer " + it->second.accessToken});
+            refreshDue = now >= it->second.refreshAt && pending_.find(key) == pending_.end();
+            if (!refreshDue)
+                return true;
+        }
+    }
+
+    if (refreshDue) {
+        startBackgroundRefresh(key, ctx, oauthConfig, refreshUrl, scopes);
+        return true;
+    }
+
+    const auto& deadline = ctx.resultHttpConfigWithAuthorization.deadline;
+    for (;;) {
+        // Join the token request for this key which is in flight, or start one
+        std::shared_future<MintedToken> result;
+        std::shared_ptr<std::promise<MintedToken>> promise;
+        std::string refreshToken;
+        {
+            std::unique_lock lk(m_);
+            auto it = cache_.find(key);
+
+            // Check if someone else updated the token before we got the unique lock
+            if (it != cache_.end() && steady_clock::now() < it->second.expiresAt) {
+                ctx.resultHttpConfigWithAuthorization.headers.insert({"Authorization", "Bearer " + it->second.accessToken});
+                return true;
+            }
+
+            if (auto pending = pending_.find(key); pending != pending_.end()) {
+                if (!pending->second.started) {
+                    // Don't wait for a worker to pick up the queued refresh, it may never come.
+                    httpcl::log().debug("[OAuth2] Running queued token refresh right away...");
+                    pending->second.started = true;
+                    promise = pending->second.promise;
+                    refreshToken = pending->second.refreshToken;
+                }
+                else {
+                    httpcl::log().debug("[OAuth2] Waiting for token which is already being requested...");
+                }
+                result = pending->second.result;
+            }
+            else {
+                if (it != cache_.end() && !it->second.refreshToken.empty()) {
+                    httpcl::log().debug("[OAuth2] Cached token expired, attempting refresh...");
+                    refreshToken = it->second.refreshToken;
+                }
+                else if (it != cache_.end()) {
+                    httpcl::log().debug("[OAuth2] Cached token expired (no refresh token), minting new...");
+                }
+                else {
+                    httpcl::log().debug("[OAuth2] No cached token, minting new...");
+                }
+                promise = std::make_shared<std::promise<MintedToken>>();
+                result = promise->get_future().share();
+                pending_.emplace(key, PendingRequest{promise, result, refreshToken, true});
+            }
+        }
+
+        if (promise)
+            renew(promise, key, ctx, oauthConfig, refreshUrl, scopes, refreshToken);
+
+        // The request which we joined may take longer than our own deadline allows
+        if (deadline && result.wait_until(*deadline) == std::future_status::timeout) {
+            mismatchReason = "OAuth token mint failed: Deadline exceeded while waiting for the token endpoint.";
+            return false;
+        }
+
+        try {
+            const auto& token = result.get();
+            ctx.resultHttpConfigWithAuthorization.headers.insert({"Authorization", "Bearer " + token.accessToken});
+            httpcl::log().debug("[OAuth2] New access token: {}", token.accessToken);
             return true;
         }
+        catch (AbortedTokenRequest const& e) {
+            // The caller which ran the request ran out of time or was cancelled, but we may not be.
+            if (!promise && !callExpired(ctx.resultHttpConfigWithAuthorization)) {
+                httpcl::log().debug("[OAuth2] Joined token request was aborted, starting a new one...");
+                continue;
+            }
+            mismatchReason = stx::format("OAuth token mint failed: {}", e.what());
+            return false;
+        }
+        catch (std::exception const& e) {
+            mismatchReason = stx::format("OAuth token mint failed: {}", e.what());
+            return false;
+        }
     }
+}
+
+OAuth2ClientCredentialsHandler::~OAuth2ClientCredentialsHandler()
+{
+    waitForBackgroundTasks();
+}
+
+void OAuth2ClientCredentialsHandler::waitForBackgroundTasks()
+{
+    std::unique_lock lock(backgroundTasksMutex_);
+    backgroundTasksDone_.wait(lock, [this]{ return backgroundTasks_ == 0; });
+}
 
+void OAuth2ClientCredentialsHandler::startBackgroundRefresh(
+    const TokenKey& key,
+    AuthContext const& ctx,
+    const httpcl::Config::OAuth2& oauthConfig,
+    const std::string& refreshUrl,
+    const std::vector<std::string>& scopes)
+{
+    // Callers which find the token expired before the refresh is done wait for it,
+    // or run it themselves if it has not been picked up by a worker yet.
+    auto promise = std::make_shared<std::promise<MintedToken>>();
     {
         std::unique_lock lk(m_);
         auto it = cache_.find(key);
+        if (it == cache_.end() || pending_.find(key) != pending_.end())
+            return;
+        pending_.emplace(key, PendingRequest{promise, promise->get_future().share(), it->second.refreshToken, false});
+    }
+    {
+        std::lock_guard lock(backgroundTasksMutex_);
+        ++backgroundTasks_;
+    }
 
-        // Check if someone else updated the token before we got the unique lock
-        if (it != cache_.end() && steady_clock::now() < it->second.expiresAt) {
-            ctx.resultHttpConfigWithAuthorization.headers.insert({"Authorization", "Bearer " + it->second.accessToken});
-            return true;
-        }
+    auto finished = [this]()
+    {
+        // Notify under the lock, as the handler may be destroyed right after.
+        std::lock_guard lock(backgroundTasksMutex_);
+        --backgroundTasks_;
+        backgroundTasksDone_.notify_all();
+    };
+
+    // Remove the queued refresh unless a caller already started it. Returns true if removed.
+    auto unqueue = [this, key, promise]()
+    {
+        std::unique_lock lk(m_);
+        auto pending = pending_.find(key);
+        if (pending == pending_.end() || pending->second.promise != promise || pending->second.started)
+            return false;
+        pending_.erase(pending);
+        return true;
+    };
 
-        // Try refresh if we had an entry, but it expired and has refresh token
-        if (it != cache_.end() && !it->second.refreshToken.empty()) {
-            httpcl::log().debug("[OAuth2] Cached token expired, attempting refresh...");
-            try {
-                httpcl::log().debug("Trying token refresh at {} ...", refreshUrl);
-                auto newTok = requestToken(ctx, oauthConfig, refreshUrl,
-                    GRANT_TYPE_REFRESH_TOKEN, {}, it->second.refreshToken);
-                it->second = newTok;
-                ctx.resultHttpConfigWithAuthorization.headers.insert({"Authorization", "Bearer " + newTok.accessToken});
-                httpcl::log().debug("  ... refresh successful.");
-                httpcl::log().debug("[OAuth2] Refreshed access token: {}", newTok.accessToken);
-                return true;
+    httpcl::log().debug("[OAuth2] Token is due for refresh, renewing it in the background...");
+    auto task = [this, promise, key, &client = ctx.httpClient, &settings = ctx.httpSettings,
+                 oauthConfig, refreshUrl, scopes, finished]()
+    {
+        std::string refreshToken;
+        {
+            std::unique_lock lk(m_);
+            auto pending = pending_.find(key);
+            if (pending != pending_.end() && pending->second.promise == promise && !pending->second.started) {
+                pending->second.started = true;
+                refreshToken = pending->second.refreshToken;
             }
-            catch (std::exception const& e) {
-                httpcl::log().debug("  ... refresh failed with error: {}", e.what());
+            else {
+                // A caller which needed the token ran the refresh already.
+                lk.unlock();
+                finished();
+                return;
             }
         }
-        else if (it != cache_.end()) {
-            httpcl::log().debug("[OAuth2] Cached token expired (no refresh token), minting new...");
+
+        // The refresh is not bound to the deadline of the request which triggered it.
+        httpcl::Config config;
+        AuthContext refreshCtx{client, key.tokenUrl, settings, config};
+        renew(promise, key, refreshCtx, oauthConfig, refreshUrl, scopes, refreshToken);
+        finished();
+    };
+
+    // Satisfy() also runs on pool workers, so it must not wait for queue space.
+    // If the queue is full, the refresh is skipped: The token is still valid,
+    // and the next request will try again.
+    if (!httpcl::ThreadPool::shared().tryPost(std::move(task))) {
+        if (unqueue())
+            httpcl::log().debug("[OAuth2] Worker queue is full, skipping background token refresh.");
+        finished();
+    }
+}
+
+void OAuth2ClientCredentialsHandler::renew(
+    std::shared_ptr<std::promise<MintedToken>> const& promise,
+    const TokenKey& key,
+    AuthContext const& httpCtx,
+    const httpcl::Config::OAuth2& oauthConfig,
+    const std::string& refreshUrl,
+    const std::vector<std::string>& scopes,
+    const std::string& refreshToken)
+{
+    std::optional<MintedToken> token;
+    std::exception_ptr error;
+    try {
+        token = renewToken(httpCtx, oauthConfig, key.tokenUrl, refreshUrl, scopes, refreshToken);
+    }
+    catch (std::exception const& e) {
+        httpcl::log().warn("[OAuth2] Token request failed: {}", e.what());
+        error = std::current_exception();
+    }
+
+    // A request which failed as our caller ran out of time or was cancelled
+    // says nothing about the token endpoint, so waiters may try again.
+    const bool aborted = !token && callExpired(httpCtx.resultHttpConfigWithAuthorization);
+    if (aborted) {
+        error = std::make_exception_ptr(AbortedTokenRequest(
+            "Deadline exceeded or call cancelled while waiting for the token endpoint."));
+    }
+
+    {
+        std::unique_lock lk(m_);
+        auto it = cache_.find(key);
+        if (token) {
+            cache_[key] = *token;
         }
-        else {
-            httpcl::log().debug("[OAuth2] No cached token, minting new...");
+        else if (it != cache_.end() && !aborted) {
+            // Keep a token which is still valid, and retry after half of its remaining lifetime
+            auto now = steady_clock::now();
+            it->second.refreshAt = now + std::max(it->second.expiresAt - now, steady_clock::duration::zero()) / 2;
         }
+        if (auto pending = pending_.find(key); pending != pending_.end() && pending->second.promise == promise)
+            pending_.erase(pending);
+    }
+
+    if (token)
+        promise->set_value(*token);
+    else
+        promise->set_exception(error);
+}
 
-        // Mint fresh
+OAuth2ClientCredentialsHandler::MintedToken OAuth2ClientCredentialsHandler::renewToken(
+    AuthContext const& httpCtx,
+    const httpcl::Config::OAuth2& oauthConfig,
+    const std::string& tokenUrl,
+    const std::string& refreshUrl,
+    const std::vector<std::string>& scopes,
+    const std::string& refreshToken) const
+{
+    if (!refreshToken.empty()) {
         try {
-            httpcl::log().debug("Trying token mint at {} ...", tokenUrl);
-            auto minted = requestToken(ctx, oauthConfig, tokenUrl,
-                GRANT_TYPE_CLIENT_CREDENTIALS, scopes);
-            cache_[key] = minted;
-            ctx.resultHttpConfigWithAuthorization.headers.insert({"Authorization", "Bearer " + minted.accessToken});
-            httpcl::log().debug("  ... mint successful.");
-            httpcl::log().debug("[OAuth2] Minted access token: {}", minted.accessToken);
+            httpcl::log().debug("Trying token refresh at {} ...", refreshUrl);
+            auto token = requestToken(httpCtx, oauthConfig, refreshUrl,
+                GRANT_TYPE_REFRESH_TOKEN, {}, refreshToken);
+            httpcl::log().debug("  ... refresh successful.");
+            return token;
         }
         catch (std::exception const& e) {
-            mismatchReason = stx::format("OAuth token mint failed: {}", e.what());
-            return false;
+            httpcl::log().debug("  ... refresh failed with error: {}", e.what());
         }
-
-        return true;
     }
+
+    httpcl::log().debug("Trying token mint at {} ...", tokenUrl);
+    auto token = requestToken(httpCtx, oauthConfig, tokenUrl,
+        GRANT_TYPE_CLIENT_CREDENTIALS, scopes);
+    httpcl::log().debug("  ... mint successful.");
+    return token;
 }
 
 /**
@@ -210,6 +429,9 @@ OAuth2ClientCredentialsHandler::MintedToken OAuth2ClientCredentialsHandler::requ
     const std::string& refreshToken) const
 {
     auto tokenRequestConf = httpCtx.httpSettings[resolvedTokenUrl];
+    // The token request counts against the budget of the call which runs it.
+    tokenRequestConf.deadline = httpCtx.resultHttpConfigWithAuthorization.deadline;
+    tokenRequestConf.cancellation = httpCtx.resultHttpConfigWithAuthorization.cancellation;
 
     // Build request body based on grant type
     std::string body = "grant_type=" + grantType;
@@ -269,7 +491,10 @@ OAuth2ClientCredentialsHandler::MintedToken OAuth2ClientCredentialsHandler::requ
     if (auto expiresInNode = jsonResult["expires_in"])
         expiresIn = expiresInNode.as<int>();
     // Subtract a thirty-second jiggle period from the token TTL
-    out.expiresAt = steady_clock::now() + seconds(expiresIn - 30);
+    auto issuedAt = steady_clock::now();
+    out.expiresAt = issuedAt + seconds(expiresIn - 30);
+    if (auto refreshAfter = oauthConfig.getRefreshAfter(); refreshAfter < 1.)
+        out.refreshAt = issuedAt + duration_cast<steady_clock::duration>((out.expiresAt - issuedAt) * refreshAfter);
 
     // Handle refresh token in response
     if (auto refreshTokenNode = jsonResult["refresh_token"])
@@ -1,210 +1,292 @@
 #include "private/openapi-parameter-helper.hpp"
 
 #include "base64.hpp"
+#include "codec.hpp"
 
-#include <functional>
-#include <optional>
+#include <stx/format.h>
 
-using namespace std::string_literals;
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <utility>
 
 namespace zswagcl
 {
 namespace impl
 {
 
+namespace
+{
+
+#ifndef __cpp_lib_to_chars
+/**
+ * Fallback for standard libraries without floating point std::to_chars,
+ * e.g. libc++ before macOS 13.3: Increase the precision until the
+ * value survives the round trip.
+ */
+template <class _Type>
+char* shortestToChars(char* first, char* last, _Type v)
+{
+    for (auto precision = std::numeric_limits<_Type>::digits10;; ++precision) {
+        auto length = std::snprintf(first, last - first, "%.*g", precision, static_cast<double>(v));
+        if (length < 0 || length >= last - first)
+            return first;
+        if (precision >= std::numeric_limits<_Type>::max_digits10 ||
+            static_cast<_Type>(std::strtod(first, nullptr)) == v)
+            return first + length;
+    }
+}
+#endif
+
+/**
+ * Decode padded base64 (or base64url) text. Throws std::invalid_argument
+ * for characters outside of the alphabet, bad padding or a bad length.
+ */
+std::string strictBase64Decode(std::string_view text, bool url)
+{
+    if (text.size() % 4 != 0)
+        throw std::invalid_argument(stx::format("Invalid base64 length {}.", text.size()));
+
+    auto dataEnd = text.find_last_not_of('=');
+    auto dataSize = dataEnd == std::string_view::npos ? 0 : dataEnd + 1;
+    if (text.size() - dataSize > 2)
+        throw std::invalid_argument("Invalid base64 padding.");
+
+    // Decoding stops at the first character outside of the alphabet,
+    // which leaves the result short of the expected size.
+    auto result = codec::base64Decode(text, url);
+    if (result.size() != dataSize * 6 / 8) {
+        auto valid = [url](char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == (url ? '-' : '+') || c == (url ? '_' : '/');
+        };
+        auto position = std::find_if_not(text.begin(), text.begin() + dataSize, valid) - text.begin();
+        throw std::invalid_argument(stx::format("Invalid base64 character at position {}.", position));
+    }
+    return result;
+}
+
+}
+
+char* toChars(char* first, char* last, float v)
+{
+#ifdef __cpp_lib_to_chars
+    return std::to_chars(first, last, v).ptr;
+#else
+    return shortestToChars(first, last, v);
+#endif
+}
+
+char* toChars(char* first, char* last, double v)
+{
+#ifdef __cpp_lib_to_chars
+    return std::to_chars(first, last, v).ptr;
+#else
+    return shortestToChars(first, last, v);
+#endif
+}
+
+void appendBuffer(std::string& out, Format f, const std::uint8_t* ptr, std::size_t size)
+{
+    switch (f) {
+    case Format::Hex:
+        codec::hexEncode(out, ptr, size);
+        break;
+
+    case Format::Base64:
+        base64_append(out, ptr, size);
+        break;
+
+    case Format::Base64url:
+        base64url_append(out, ptr, size);
+        break;
+
+    case Format::Binary:
+    case Format::String:
+        out.append(reinterpret_cast<const char*>(ptr), size);
+        break;
+    }
+}
+
 std::string formatBuffer(Format f, const std::uint8_t* ptr, std::size_t size)
 {
-    static_assert(std::is_integral_v<unsigned char>);
+    std::string result;
+    appendBuffer(result, f, ptr, size);
+    return result;
+}
+
+std::string parseBuffer(Format f, std::string_view text)
+{
     switch (f) {
     case Format::Hex:
-        return stx::to_hex(ptr, ptr + size);
+        return codec::hexDecode(text);
 
     case Format::Base64:
-        return base64_encode(ptr, size);
+        return strictBase64Decode(text, false);
 
     case Format::Base64url:
-        return base64url_encode(ptr, size);
+        return strictBase64Decode(text, true);
 
     case Format::Binary:
     case Format::String:
-        return std::string(ptr, ptr + size);
+        break;
     }
 
-    return {};
+    return std::string(text);
 }
 
 }
 
 using Style = OpenAPIConfig::Parameter::Style;
 
-namespace
+bool ParameterWriter::begin(Kind kind)
 {
+    if (pairs_) {
+        if (param.style != Style::Form)
+            return false;
 
-template <class... _T>
-struct Overloaded : _T...
-{
-    using _T::operator()...;
-};
-
-template <class... _T>
-Overloaded(_T...) -> Overloaded<_T...>;
-
-template <class _Result, class _Variant>
-_Result visitValue(const _Variant& v,
-                   _Result defaultValue,
-                   std::function<std::optional<_Result>(const std::string&)> single,
-                   std::function<std::optional<_Result>(const std::vector<std::string>&)> vector,
-                   std::function<std::optional<_Result>(const std::map<std::string, std::string>&)> map)
-{
-    auto result = defaultValue;
-
-    std::visit(Overloaded {
-        [&](const std::string& v) {
-            if (auto res = single(v))
-                result = *res;
-        },
-        [&](const std::vector<std::string>& v) {
-            if (auto res = vector(v))
-                result = *res;
-        },
-        [&](const std::map<std::string, std::string>& v) {
-            if (auto res = map(v))
-                result = *res;
-        }
-    }, v);
+        /* Result example: ?id=1,2,3 */
+        if (kind == Kind::Value || !param.explode)
+            joined_ = &pairs_->emplace(param.ident, std::string())->second;
+        return true;
+    }
 
-    return result;
+    switch (param.style) {
+    case Style::Simple:
+        return true;
+    case Style::Label:
+        path_->push_back('.');
+        return true;
+    case Style::Matrix:
+        path_->push_back(';');
+        if (kind != Kind::Object || !param.explode) {
+            *path_ += param.ident;
+            path_->push_back('=');
+        }
+        return true;
+    default:
+        *path_ += param.defaultValue;
+        return false;
+    }
 }
 
-std::string joinMap(const std::map<std::string, std::string>& map,
-                    const std::string& kvSeparator,
-                    const std::string& pairSeparator)
+std::string& ParameterWriter::next(Kind kind, bool first)
 {
-    std::vector<std::string> tmp;
-    tmp.resize(map.size());
+    if (pairs_) {
+        /* Result example: ?id=1&id=2&id=3 */
+        if (kind == Kind::Array && param.explode)
+            return pairs_->emplace(param.ident, std::string())->second;
+
+        if (!first)
+            joined_->push_back(',');
+        return *joined_;
+    }
 
-    std::transform(map.begin(), map.end(), tmp.begin(), [&](const auto& kv) {
-        return kv.first + kvSeparator + kv.second;
-    });
+    if (first)
+        return *path_;
 
-    return stx::join(tmp.begin(), tmp.end(), pairSeparator);
+    switch (param.style) {
+    case Style::Label:
+        path_->push_back(param.explode ? '.' : ',');
+        break;
+    case Style::Matrix:
+        if (!param.explode)
+            path_->push_back(',');
+        else if (kind == Kind::Object)
+            path_->push_back(';');
+        else {
+            path_->push_back(';');
+            *path_ += param.ident;
+            path_->push_back('=');
+        }
+        break;
+    default:
+        path_->push_back(',');
+    }
+    return *path_;
 }
 
+void ParameterWriter::formattedValue(std::string_view v)
+{
+    if (begin(Kind::Value))
+        next(Kind::Value, true) += v;
 }
 
-std::string ParameterValue::bodyStr() const
+void ParameterWriter::formattedArray(const std::vector<std::string>& v)
 {
-    return visitValue<std::string>(value, {},
-        [&](const std::string& v) -> std::optional<std::string> {
-            return v;
-        },
-        [&](const std::vector<std::string>&) -> std::optional<std::string> {
-            throw std::runtime_error("Expected parameter-value of type string, got vector");
-        },
-        [&](const std::map<std::string, std::string>&) -> std::optional<std::string> {
-            throw std::runtime_error("Expected parameter-value of type string, got dictionary");
-        });
+    if (!begin(Kind::Array))
+        return;
+
+    auto first = true;
+    for (const auto& item : v) {
+        next(Kind::Array, first) += item;
+        first = false;
+    }
 }
 
-std::string ParameterValue::pathStr(const OpenAPIConfig::Parameter& param) const
+void ParameterWriter::formattedObject(const std::map<std::string, std::string>& v)
 {
-    return visitValue<std::string>(value, param.defaultValue,
-        [&](const std::string& v) -> std::optional<std::string> {
-            switch (param.style) {
-            case Style::Simple:
-                return v;
-            case Style::Label:
-                return "."s + v;
-            case Style::Matrix:
-                return ";"s + param.ident + "="s + v;
-            default:
-                return {};
-            }
-        },
-        [&](const std::vector<std::string>& v) -> std::optional<std::string> {
-            switch (param.style) {
-            case Style::Simple:
-                return stx::join(v.begin(), v.end(), ",");
-            case Style::Label:
-                if (param.explode)
-                    return "."s + stx::join(v.begin(), v.end(), ".");
-                return "."s + stx::join(v.begin(), v.end(), ",");
-            case Style::Matrix:
-                if (param.explode)
-                    return ";"s + param.ident + "=" + stx::join(v.begin(), v.end(), ";"s + param.ident + "=");
-                return ";"s + param.ident + "=" + stx::join(v.begin(), v.end(), ",");
-            default:
-                return {};
-            }
-        },
-        [&](const std::map<std::string, std::string>& v) -> std::optional<std::string> {
-            switch (param.style) {
-            case Style::Simple:
-                if (param.explode)
-                    return joinMap(v, "=", ",");
-                else
-                    return joinMap(v, ",", ",");
-            case Style::Label:
-                if (param.explode)
-                    return "."s + joinMap(v, "=", ".");
-                else
-                    return "."s + joinMap(v, ",", ",");
-            case Style::Matrix:
-                if (param.explode)
-                    return ";"s + joinMap(v, "=", ";");
-                else
-                    return ";"s + param.ident + "=" + joinMap(v, ",", ",");
-            default:
-                return {};
-            }
+    if (!begin(Kind::Object))
+        return;
+
+    auto first = true;
+    for (const auto& [key, item] : v) {
+        if (pairs_ && param.explode) {
+            pairs_->emplace(key, item);
+            continue;
         }
-    );
 
+        auto& out = next(Kind::Object, first);
+        out += key;
+        out += param.explode ? '=' : ',';
+        out += item;
+        first = false;
+    }
+}
+
+std::string ParameterValue::bodyStr() &&
+{
+    if (auto str = std::get_if<std::string>(&value))
+        return std::move(*str);
+    return std::as_const(*this).bodyStr();
+}
+
+std::string ParameterValue::bodyStr() const&
+{
+    if (auto str = std::get_if<std::string>(&value))
+        return *str;
+    if (std::holds_alternative<std::vector<std::string>>(value))
+        throw std::runtime_error("Expected parameter-value of type string, got vector");
+    if (std::holds_alternative<std::map<std::string, std::string>>(value))
+        throw std::runtime_error("Expected parameter-value of type string, got dictionary");
+    throw std::runtime_error("Expected parameter-value of type string, got streamed value");
+}
+
+void ParameterValue::write(ParameterWriter& writer) const
+{
+    if (auto str = std::get_if<std::string>(&value))
+        writer.formattedValue(*str);
+    else if (auto vec = std::get_if<std::vector<std::string>>(&value))
+        writer.formattedArray(*vec);
+    else if (auto map = std::get_if<std::map<std::string, std::string>>(&value))
+        writer.formattedObject(*map);
+}
+
+std::string ParameterValue::pathStr(const OpenAPIConfig::Parameter& param) const
+{
+    std::string result;
+    ParameterWriter writer(param, result);
+    write(writer);
+    return result;
 }
 
 std::vector<std::pair<std::string, std::string>> ParameterValue::queryOrHeaderPairs(const OpenAPIConfig::Parameter& param) const
 {
-    using Pair = std::pair<std::string, std::string>;
-    using List = std::vector<Pair>;
-
-    return visitValue<List>(value, {},
-        [&](const std::string& v) -> std::optional<List> {
-            switch (param.style) {
-            case Style::Form:
-                return {{{param.ident, v}}};
-            default:
-                return {};
-            }
-        },
-        [&](const std::vector<std::string>& v) -> std::optional<List> {
-            switch (param.style) {
-            case Style::Form:
-                /* Result example: ?id=1&id=2&id=3*/
-                if (param.explode) {
-                    List tmp;
-                    tmp.resize(v.size());
-                    std::transform(v.begin(), v.end(), tmp.begin(), [&](const auto& v) {
-                        return std::make_pair(param.ident, v);
-                    });
-
-                    return tmp;
-                }
-                return {{std::make_pair(param.ident, stx::join(v.begin(), v.end(), ","))}};
-            default:
-                return {};
-            }
-        },
-        [&](const std::map<std::string, std::string>& v) -> std::optional<List> {
-            switch (param.style) {
-            case Style::Form:
-                if (param.explode)
-                    return List(v.begin(), v.end());
-                return {{std::make_pair(param.ident, joinMap(v, ",", ","))}};
-            default:
-                return {};
-            }
-        }
-    );
+    ParameterWriter::Pairs pairs;
+    ParameterWriter writer(param, pairs);
+    write(writer);
+    return {std::make_move_iterator(pairs.begin()), std::make_move_iterator(pairs.end())};
 }
 
 }
@@ -7,8 +7,8 @@
 #include "yaml-cpp/yaml.h"
 #include "stx/format.h"
 #include "httpcl/log.hpp"
+#include "httpcl/executor.hpp"
 #include <httplib.h>
-#include <future>
 
 #include <sstream>
 #include <string>
@@ -342,6 +342,26 @@ static void parseMethod(const std::string& method,
         if (auto securityNode = methodNode["security"])
             path.security = parseSecurity(securityNode, config);
 
+        path.idempotent = path.httpMethod == "GET" || path.httpMethod == "PUT" || path.httpMethod == "DELETE";
+        path.hedgeable = path.httpMethod == "GET";
+        if (auto idempotentNode = methodNode["x-zswag-idempotent"])
+            path.idempotent = path.hedgeable = idempotentNode.as<bool>();
+
+        if (auto retryNode = methodNode["x-zswag-retry"])
+            path.retry = retryNode.as<httpcl::RetryPolicy>();
+
+        if (auto hedgeNode = methodNode["x-zswag-hedge"])
+            path.hedge = hedgeNode.as<httpcl::HedgePolicy>();
+
+        if (auto timeoutNode = methodNode["x-zswag-timeout"])
+            path.timeout = std::chrono::milliseconds(static_cast<int64_t>(timeoutNode.as<double>() * 1000.));
+
+        if (auto coalesceNode = methodNode["x-zswag-coalesce"])
+            path.coalesce = coalesceNode.as<bool>();
+
+        if (auto cacheTtlNode = methodNode["x-zswag-cache-ttl"])
+            path.cacheTtl = std::chrono::seconds(cacheTtlNode.as<int64_t>());
+
         parseMethodBody(methodNode, path);
     }
 }
@@ -524,12 +544,10 @@ OpenAPIConfig fetchOpenAPIConfig(const std::string& url,
     httpcl::log().debug("{} Parsing URL ...", debugContext);
     auto uriParts = httpcl::URIComponents::fromStrRfc3986(url);
     httpcl::log().debug("{} Executing HTTP GET ...", debugContext);
-    auto resFuture = std::async(std::launch::async, [uriParts, httpConfig, &client] {
-        return client.get(uriParts.build(), httpConfig);
+    httpcl::IHttpClient::Result res;
+    httpcl::execute(httpcl::executionPolicyFromEnv(), debugContext, [&] {
+        res = client.get(uriParts.build(), httpConfig);
     });
-    while (resFuture.wait_for(std::chrono::seconds{1}) != std::future_status::ready)
-        httpcl::log().debug("{} Waiting for response ...", debugContext);
-    auto res = resFuture.get();
     httpcl::log().debug("{} Got HTTP status {}, {} bytes.", debugContext, res.status, res.content.size());
 
     // Parse loaded JSON
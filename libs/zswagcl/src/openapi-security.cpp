@@ -101,6 +101,12 @@ AuthRegistry::AuthRegistry()
     handlers_.insert({SecuritySchemeType::OAuth2ClientCredentials, std::make_unique<OAuth2ClientCredentialsHandler>()});
 }
 
+void AuthRegistry::waitForBackgroundTasks()
+{
+    for (auto& [type, handler] : handlers_)
+        handler->waitForBackgroundTasks();
+}
+
 void AuthRegistry::satisfySecurity(
     const OpenAPIConfig::SecurityAlternatives& alts, AuthContext const& ctx)
 {
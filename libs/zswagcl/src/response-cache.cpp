@@ -0,0 +1,121 @@
+#include "private/response-cache.hpp"
+#include "httpcl/env.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+namespace zswagcl
+{
+
+namespace
+{
+
+/** Estimated bookkeeping cost of an entry, besides key and value. */
+constexpr std::size_t entryOverhead = 128;
+
+}
+
+std::size_t ResponseCache::maxBytesFromEnv()
+{
+    return httpcl::readEnvOption<std::size_t>("HTTP_RESPONSE_CACHE_SIZE", 64 * 1024 * 1024);
+}
+
+ResponseCache::ResponseCache(std::size_t maxBytes, std::size_t shards)
+{
+    shards = std::max<std::size_t>(shards, 1);
+    maxShardBytes_ = maxBytes / shards;
+    shards_.reserve(shards);
+    for (auto i = 0u; i < shards; ++i)
+        shards_.emplace_back(std::make_unique<Shard>());
+}
+
+ResponseCache::Shard& ResponseCache::shard(std::string const& key)
+{
+    return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+void ResponseCache::erase(Shard& shard, std::list<Entry>::iterator entry)
+{
+    shard.bytes -= entry->bytes;
+    shard.index.erase(entry->key);
+    shard.entries.erase(entry);
+}
+
+ResponseCache::Value ResponseCache::get(std::string const& key)
+{
+    auto& shard = this->shard(key);
+    {
+        std::lock_guard lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            auto entry = found->second;
+            if (Clock::now() < entry->expires) {
+                shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+                ++hits_;
+                return entry->value;
+            }
+            erase(shard, entry);
+        }
+    }
+    ++misses_;
+    return {};
+}
+
+void ResponseCache::put(std::string const& key, std::string value, Clock::duration ttl)
+{
+    put(key, std::make_shared<const std::string>(std::move(value)), ttl);
+}
+
+void ResponseCache::put(std::string const& key, Value value, Clock::duration ttl)
+{
+    if (!value)
+        return;
+    auto bytes = key.size() + value->size() + entryOverhead;
+    if (bytes > maxShardBytes_ || ttl <= Clock::duration::zero())
+        return;
+
+    auto& shard = this->shard(key);
+    std::lock_guard lock(shard.mutex);
+    if (auto found = shard.index.find(key); found != shard.index.end())
+        erase(shard, found->second);
+
+    // Make room, dropping expired entries along with the least recently used ones.
+    auto now = Clock::now();
+    while (!shard.entries.empty() && shard.bytes + bytes > maxShardBytes_) {
+        auto last = std::prev(shard.entries.end());
+        if (now < last->expires)
+            ++evictions_;
+        erase(shard, last);
+    }
+
+    shard.entries.push_front({key, std::move(value), now + ttl, bytes});
+    shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+    shard.bytes += bytes;
+}
+
+void ResponseCache::clear()
+{
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        shard->index.clear();
+        shard->entries.clear();
+        shard->bytes = 0;
+    }
+}
+
+ResponseCache::Stats ResponseCache::stats() const
+{
+    Stats result;
+    result.hits = hits_;
+    result.misses = misses_;
+    result.evictions = evictions_;
+    for (auto& shard : shards_) {
+        std::lock_guard lock(shard->mutex);
+        result.entries += shard->entries.size();
+        result.bytes += shard->bytes;
+    }
+    return result;
+}
+
+}
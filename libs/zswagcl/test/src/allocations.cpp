@@ -0,0 +1,138 @@
+#include <catch2/catch_all.hpp>
+
+#include "zswagcl/private/openapi-parameter-helper.hpp"
+
+#include <cstdlib>
+#include <new>
+#include <optional>
+
+/*
+ * Counting the heap allocations of a code path requires replacing the
+ * global operator new, which affects the whole executable. This file
+ * is therefore built into its own test binary, and only counts the
+ * allocations made by the current thread while an AllocationCounter
+ * is alive.
+ */
+
+using namespace zswagcl;
+
+namespace
+{
+
+thread_local bool counting = false;
+thread_local std::size_t allocations = 0;
+
+/** Counts the heap allocations of the current thread during its lifetime. */
+struct AllocationCounter
+{
+    AllocationCounter() {
+        allocations = 0;
+        counting = true;
+    }
+
+    ~AllocationCounter() {
+        counting = false;
+    }
+
+    std::size_t count() const {
+        return allocations;
+    }
+};
+
+auto makeParameter(std::string ident,
+                   OpenAPIConfig::Parameter::Style style,
+                   bool explode,
+                   OpenAPIConfig::Parameter::Format format)
+{
+    OpenAPIConfig::Parameter parameter;
+    parameter.ident = std::move(ident);
+    parameter.style = style;
+    parameter.explode = explode;
+    parameter.format = format;
+
+    return parameter;
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    if (counting)
+        ++allocations;
+    if (auto ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+using Format = OpenAPIConfig::Parameter::Format;
+using PStyle = OpenAPIConfig::Parameter::Style;
+
+TEST_CASE("serialized buffers are not copied", "[zswagcl::allocations]") {
+    std::string serialized(4096, 'x');
+    const auto* bytes = serialized.data();
+
+    SECTION("Binary body") {
+        auto param = makeParameter("body", PStyle::Simple, false, Format::Binary);
+        ParameterValueHelper helper(param);
+
+        std::size_t allocated = 0;
+        std::string body;
+        {
+            AllocationCounter counter;
+            body = helper.binary(std::move(serialized)).bodyStr();
+            allocated = counter.count();
+        }
+        REQUIRE(allocated == 0);
+        REQUIRE(body.data() == bytes);
+        REQUIRE(body.size() == 4096);
+    }
+
+    SECTION("Array of binary values") {
+        auto param = makeParameter("items", PStyle::Simple, false, Format::Binary);
+        ParameterValueHelper helper(param);
+        std::vector<std::string> items;
+        items.emplace_back(std::move(serialized));
+
+        std::size_t allocated = 0;
+        std::optional<ParameterValue> value;
+        {
+            AllocationCounter counter;
+            value.emplace(helper.array(std::move(items)));
+            allocated = counter.count();
+        }
+        REQUIRE(allocated == 0);
+        REQUIRE(std::get<std::vector<std::string>>(value->value)[0].data() == bytes);
+    }
+}
+
+TEST_CASE("parameter writer streams without allocating", "[zswagcl::allocations]") {
+    std::vector<std::uint64_t> ids(1000);
+    for (auto i = 0u; i < ids.size(); ++i)
+        ids[i] = 0xfff000 + i;
+
+    auto param = makeParameter("ids", PStyle::Matrix, true, Format::Hex);
+    std::string path;
+    path.reserve(32 * 1024);
+
+    std::size_t allocated = 0;
+    {
+        AllocationCounter counter;
+        ParameterWriter writer(param, path);
+        ParameterValueHelper helper(param, writer);
+        helper.array(ids).write(writer);
+        allocated = counter.count();
+    }
+
+    REQUIRE(allocated == 0);
+    REQUIRE(path.substr(0, 24) == ";ids=fff000;ids=fff001;i");
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch_all.hpp>
+
+#include "../../src/codec.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace zswagcl;
+using codec::Isa;
+
+namespace
+{
+
+/** All instruction sets which this machine can run. */
+std::vector<Isa> supportedIsas()
+{
+    std::vector<Isa> result{Isa::Scalar};
+    if (codec::bestIsa() >= Isa::SSE4)
+        result.push_back(Isa::SSE4);
+    if (codec::bestIsa() >= Isa::AVX2)
+        result.push_back(Isa::AVX2);
+    return result;
+}
+
+std::vector<uint8_t> randomBytes(std::size_t size)
+{
+    static std::mt19937 random(42);
+    std::vector<uint8_t> result(size);
+    for (auto& byte : result)
+        byte = static_cast<uint8_t>(random());
+    return result;
+}
+
+}
+
+TEST_CASE("Codec kernels agree", "[codec]") {
+    /* Sizes around the block sizes of all kernels */
+    for (auto size = 0u; size < 200u; ++size) {
+        auto bytes = randomBytes(size);
+        auto* data = bytes.data();
+        std::string expectedBytes(bytes.begin(), bytes.end());
+
+        std::string base64, base64url, hex;
+        codec::base64Encode(base64, data, size, false, Isa::Scalar);
+        codec::base64Encode(base64url, data, size, true, Isa::Scalar);
+        codec::hexEncode(hex, data, size, Isa::Scalar);
+        REQUIRE(base64.size() == (size + 2) / 3 * 4);
+        REQUIRE(hex.size() == size * 2);
+
+        for (auto isa : supportedIsas()) {
+            INFO("Size: " << size << ", ISA: " << static_cast<int>(isa));
+
+            std::string out = "prefix";
+            codec::base64Encode(out, data, size, false, isa);
+            REQUIRE(out == "prefix" + base64);
+
+            out = "prefix";
+            codec::base64Encode(out, data, size, true, isa);
+            REQUIRE(out == "prefix" + base64url);
+
+            out = "prefix";
+            codec::hexEncode(out, data, size, isa);
+            REQUIRE(out == "prefix" + hex);
+
+            REQUIRE(codec::base64Decode(base64, false, isa) == expectedBytes);
+            REQUIRE(codec::base64Decode(base64url, true, isa) == expectedBytes);
+            REQUIRE(codec::hexDecode(hex, isa) == expectedBytes);
+        }
+    }
+}
+
+TEST_CASE("Codec edge cases", "[codec]") {
+    auto isa = GENERATE(from_range(supportedIsas()));
+    INFO("ISA: " << static_cast<int>(isa));
+
+    SECTION("Base64 decoding stops at padding and invalid characters") {
+        std::string text(64, 'A');
+        REQUIRE(codec::base64Decode(text, false, isa) == std::string(48, '\0'));
+
+        text[40] = '=';
+        REQUIRE(codec::base64Decode(text, false, isa) == std::string(30, '\0'));
+
+        text[40] = '-';
+        REQUIRE(codec::base64Decode(text, false, isa) == std::string(30, '\0'));
+        REQUIRE(codec::base64Decode(text, true, isa).size() == 48);
+
+        text[5] = '\xC3';
+        REQUIRE(codec::base64Decode(text, true, isa) == std::string(3, '\0'));
+    }
+
+    SECTION("Hex decoding accepts both cases") {
+        std::string text;
+        for (auto i = 0; i < 8; ++i)
+            text += "0123456789abcdefABCDEF";
+        auto bytes = codec::hexDecode(text, isa);
+        REQUIRE(bytes.size() == text.size() / 2);
+        REQUIRE(bytes.substr(0, 11) == "\x01\x23\x45\x67\x89\xab\xcd\xef\xAB\xCD\xEF");
+    }
+
+    SECTION("Hex decoding rejects malformed text") {
+        std::string text(100, '0');
+        REQUIRE_THROWS_AS(codec::hexDecode(text.substr(1), isa), std::invalid_argument);
+
+        text[70] = 'g';
+        REQUIRE_THROWS_WITH(codec::hexDecode(text, isa), "Invalid hex character at position 70.");
+
+        text[70] = '0';
+        text[3] = ' ';
+        REQUIRE_THROWS_WITH(codec::hexDecode(text, isa), "Invalid hex character at position 3.");
+    }
+}
+
+TEST_CASE("Codec instruction set selection", "[codec]") {
+    auto previous = codec::activeIsa();
+    REQUIRE(previous == codec::bestIsa());
+
+    codec::setActiveIsa(Isa::Scalar);
+    REQUIRE(codec::activeIsa() == Isa::Scalar);
+
+    codec::setActiveIsa(Isa::AVX2);
+    REQUIRE(codec::activeIsa() == codec::bestIsa());
+
+    codec::setActiveIsa(previous);
+}
+
+TEST_CASE("Codec benchmarks", "[.][benchmark]") {
+    auto bytes = randomBytes(1024 * 1024);
+    std::string base64, hex;
+    codec::base64Encode(base64, bytes.data(), bytes.size(), false, Isa::Scalar);
+    codec::hexEncode(hex, bytes.data(), bytes.size(), Isa::Scalar);
+
+    for (auto isa : supportedIsas()) {
+        auto name = std::to_string(static_cast<int>(isa));
+
+        BENCHMARK("Base64 encode 1 MiB, ISA " + name) {
+            std::string out;
+            codec::base64Encode(out, bytes.data(), bytes.size(), false, isa);
+            return out;
+        };
+
+        BENCHMARK("Base64 decode 1 MiB, ISA " + name) {
+            return codec::base64Decode(base64, false, isa);
+        };
+
+        BENCHMARK("Hex encode 1 MiB, ISA " + name) {
+            std::string out;
+            codec::hexEncode(out, bytes.data(), bytes.size(), isa);
+            return out;
+        };
+
+        BENCHMARK("Hex decode 1 MiB, ISA " + name) {
+            return codec::hexDecode(hex, isa);
+        };
+    }
+}
@@ -1,7 +1,11 @@
 #include <catch2/catch_all.hpp>
 
+#include <atomic>
 #include <fstream>
+#include <future>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "zswagcl/oaclient.hpp"
 #include "zswagcl/private/openapi-config.hpp"
@@ -241,6 +245,78 @@ TEST_CASE("HTTP-Service", "[oaclient]") {
         REQUIRE(postCalled);
     }
 
+    SECTION("Asynchronous Calls") {
+        /* Setup mock client, which runs on a worker thread */
+        std::atomic<int> getCalls{0};
+        std::string calledUri;
+        auto client = std::make_unique<httpcl::MockHttpClient>();
+        client->getFun = [&](std::string_view uri) {
+            ++getCalls;
+            calledUri = uri;
+            return httpcl::IHttpClient::Result{200, "response"};
+        };
+
+        auto config = makeConfig(R"json(
+            "/async/{id}": {
+                "get": {
+                    "operationId": "async",
+                    "parameters": [
+                        {
+                            "name": "id",
+                            "in": "path",
+                            "x-zserio-request-part": "str"
+                        }
+                    ]
+                }
+            }
+        )json");
+        auto service = OAClient(config, std::move(client));
+
+        SECTION("Future") {
+            auto future = [&]{
+                /* The request must not need to outlive the call. */
+                auto request = service_client_test::Request(
+                    "hello", 0, std::vector<std::string>{},
+                    service_client_test::Flat("", ""));
+                return service.callMethodAsync("async", zserio::ReflectableServiceData(request.reflectable()));
+            }();
+
+            auto response = future.get();
+            REQUIRE(std::string(response.begin(), response.end()) == "response");
+            REQUIRE(getCalls == 1);
+            REQUIRE(calledUri == "https://my.server.com/api/async/hello");
+        }
+
+        SECTION("Completion Callback") {
+            auto request = service_client_test::Request(
+                "hello", 0, std::vector<std::string>{},
+                service_client_test::Flat("", ""));
+
+            std::promise<std::vector<uint8_t>> done;
+            service.callMethodAsync(
+                "async",
+                zserio::ReflectableServiceData(request.reflectable()),
+                [&](std::vector<uint8_t> response, std::exception_ptr error) {
+                    if (error)
+                        done.set_exception(error);
+                    else
+                        done.set_value(std::move(response));
+                });
+
+            auto response = done.get_future().get();
+            REQUIRE(std::string(response.begin(), response.end()) == "response");
+            REQUIRE(getCalls == 1);
+        }
+
+        SECTION("Unknown Method Throws Directly") {
+            auto request = service_client_test::Request(
+                "hello", 0, std::vector<std::string>{},
+                service_client_test::Flat("", ""));
+            REQUIRE_THROWS(service.callMethodAsync("unknown", zserio::ReflectableServiceData(request.reflectable())));
+            REQUIRE(getCalls == 0);
+        }
+    }
+
     SECTION("Authorization Schemes")
     {
         /* Initialize environment */
@@ -346,6 +422,729 @@ TEST_CASE("HTTP-Service", "[oaclient]") {
     }
 }
 
+TEST_CASE("OAClient - Retries", "[oaclient][retry]") {
+    std::vector<std::string> calledUris;
+    int failures = 0;
+    std::string retryAfter;
+
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        calledUris.emplace_back(uri);
+        if (failures-- > 0)
+            return httpcl::IHttpClient::Result{503, {}, {{"Retry-After", retryAfter}}};
+        return httpcl::IHttpClient::Result{200, "response"};
+    };
+    client->postFun = [&](std::string_view uri, auto const&, auto const&) {
+        calledUris.emplace_back(uri);
+        return httpcl::IHttpClient::Result{503, {}};
+    };
+
+    auto config = makeConfig(R"json(
+        "/retry": {
+            "get": {
+                "operationId": "retryGet",
+                "x-zswag-retry": {"max-attempts": 3, "initial-backoff-ms": 1}
+            },
+            "post": {
+                "operationId": "retryPost",
+                "x-zswag-retry": {"max-attempts": 3, "initial-backoff-ms": 1}
+            }
+        },
+        "/single": {
+            "get": {
+                "operationId": "singleGet"
+            }
+        }
+    )json");
+    config.servers.push_back(httpcl::URIComponents::fromStrRfc3986("https://backup.server.com/api"));
+    auto service = OAClient(config, std::move(client));
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+    auto call = [&](std::string const& method) {
+        return service.callMethod(method, zserio::ReflectableServiceData(request.reflectable()), nullptr);
+    };
+
+    SECTION("Fail over to the next server") {
+        failures = 1;
+        auto response = call("retryGet");
+        REQUIRE(std::string(response.begin(), response.end()) == "response");
+        REQUIRE(calledUris == std::vector<std::string>{
+            "https://my.server.com/api/retry",
+            "https://backup.server.com/api/retry"});
+    }
+
+    SECTION("Give up after max attempts") {
+        failures = 5;
+        REQUIRE_THROWS_AS(call("retryGet"), httpcl::IHttpClient::Error);
+        REQUIRE(calledUris.size() == 3);
+    }
+
+    SECTION("Give up if Retry-After exceeds the maximum backoff") {
+        failures = 1;
+        retryAfter = "3600";
+        REQUIRE_THROWS_AS(call("retryGet"), httpcl::IHttpClient::Error);
+        REQUIRE(calledUris.size() == 1);
+    }
+
+    SECTION("Do not retry non-idempotent methods") {
+        REQUIRE_THROWS_AS(call("retryPost"), httpcl::IHttpClient::Error);
+        REQUIRE(calledUris.size() == 1);
+    }
+
+    SECTION("Do not retry without policy") {
+        failures = 1;
+        REQUIRE_THROWS_AS(call("singleGet"), httpcl::IHttpClient::Error);
+        REQUIRE(calledUris.size() == 1);
+    }
+}
+
+TEST_CASE("OAClient - Circuit breaker", "[oaclient][circuit-breaker]") {
+    std::vector<std::string> calledUris;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        calledUris.emplace_back(uri);
+        if (uri.find("breaker-a") != std::string_view::npos)
+            return httpcl::IHttpClient::Result{0, {}};
+        return httpcl::IHttpClient::Result{200, "response"};
+    };
+
+    auto config = makeConfig(R"json(
+        "/breaker": {
+            "get": {
+                "operationId": "breakerGet"
+            }
+        }
+    )json");
+    // Breakers are shared process-wide, so use hosts which no other test calls.
+    config.servers = {
+        httpcl::URIComponents::fromStrRfc3986("https://breaker-a.com/api"),
+        httpcl::URIComponents::fromStrRfc3986("https://breaker-b.com/api")};
+
+    httpcl::Config httpConfig(R"(
+        scope: "*"
+        circuit-breaker:
+          consecutive-failures: 2
+          open-ms: 60000
+    )");
+    auto service = OAClient(config, std::move(client), httpConfig);
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+    auto call = [&]() {
+        return service.callMethod("breakerGet", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+    };
+
+    REQUIRE_THROWS_AS(call(), httpcl::IHttpClient::Error);
+    REQUIRE_THROWS_AS(call(), httpcl::IHttpClient::Error);
+    REQUIRE(calledUris.size() == 2);
+
+    // The circuit for breaker-a is open now, calls go to breaker-b without trying it.
+    auto response = call();
+    REQUIRE(std::string(response.begin(), response.end()) == "response");
+    REQUIRE(calledUris.back() == "https://breaker-b.com/api/breaker");
+    REQUIRE(calledUris.size() == 3);
+}
+
+TEST_CASE("OAClient - Hedged requests", "[oaclient][hedging]") {
+    std::mutex mutex;
+    std::vector<std::string> calledUris;
+
+    /** MockHttpClient only mocks GET and POST. */
+    struct PutMock : httpcl::MockHttpClient
+    {
+        std::function<Result(std::string_view)> putFun;
+
+        Result put(const std::string& uri, const httpcl::OptionalBodyAndContentType&, const httpcl::Config&) override {
+            return putFun(uri);
+        }
+    };
+
+    auto respond = [&](std::string_view uri) {
+        {
+            std::lock_guard lock(mutex);
+            calledUris.emplace_back(uri);
+        }
+        if (uri.find("slow") != std::string_view::npos) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            return httpcl::IHttpClient::Result{200, "slow"};
+        }
+        return httpcl::IHttpClient::Result{200, "fast"};
+    };
+
+    auto config = makeConfig(R"json(
+        "/hedge": {
+            "get": {
+                "operationId": "hedgeGet",
+                "x-zswag-hedge": {"delay-ms": 10}
+            },
+            "post": {
+                "operationId": "hedgePost",
+                "x-zswag-hedge": {"delay-ms": 10}
+            },
+            "put": {
+                "operationId": "hedgePut",
+                "x-zswag-hedge": {"delay-ms": 10}
+            }
+        },
+        "/hedge-idempotent": {
+            "put": {
+                "operationId": "hedgeIdempotentPut",
+                "x-zswag-idempotent": true,
+                "x-zswag-hedge": {"delay-ms": 10}
+            }
+        }
+    )json");
+    config.servers = {
+        httpcl::URIComponents::fromStrRfc3986("https://slow.server.com/api"),
+        httpcl::URIComponents::fromStrRfc3986("https://fast.server.com/api")};
+
+    auto makeService = [&](httpcl::Config httpConfig) {
+        auto client = std::make_unique<PutMock>();
+        client->getFun = respond;
+        client->putFun = respond;
+        client->postFun = [&](std::string_view uri, auto const&, auto const&) {
+            std::lock_guard lock(mutex);
+            calledUris.emplace_back(uri);
+            return httpcl::IHttpClient::Result{200, "post"};
+        };
+        return OAClient(config, std::move(client), std::move(httpConfig));
+    };
+    auto service = makeService({});
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+    auto call = [&](OAClient& service, std::string const& method) {
+        auto response = service.callMethod(method, zserio::ReflectableServiceData(request.reflectable()), nullptr);
+        return std::string(response.begin(), response.end());
+    };
+
+    SECTION("A duplicate answers a slow GET") {
+        REQUIRE(call(service, "hedgeGet") == "fast");
+        auto stats = service.hedgeStats();
+        REQUIRE(stats.attempts == 1);
+        REQUIRE(stats.hedges == 1);
+        REQUIRE(stats.wins == 1);
+    }
+
+    SECTION("Async calls are hedged") {
+        auto future = service.callMethodAsync("hedgeGet", zserio::ReflectableServiceData(request.reflectable()));
+        auto response = future.get();
+        REQUIRE(std::string(response.begin(), response.end()) == "fast");
+        REQUIRE(service.hedgeStats().hedges == 1);
+        REQUIRE(service.hedgeStats().wins == 1);
+    }
+
+    SECTION("POST is not hedged") {
+        REQUIRE(call(service, "hedgePost") == "post");
+        REQUIRE(service.hedgeStats().attempts == 0);
+        std::lock_guard lock(mutex);
+        REQUIRE(calledUris.size() == 1);
+    }
+
+    SECTION("PUT is not hedged by default") {
+        REQUIRE(call(service, "hedgePut") == "slow");
+        REQUIRE(service.hedgeStats().attempts == 0);
+        std::lock_guard lock(mutex);
+        REQUIRE(calledUris.size() == 1);
+    }
+
+    SECTION("PUT with x-zswag-idempotent is hedged") {
+        REQUIRE(call(service, "hedgeIdempotentPut") == "fast");
+        REQUIRE(service.hedgeStats().hedges == 1);
+    }
+
+    SECTION("The HTTP settings decide whether a method is idempotent") {
+        httpcl::Config idempotent;
+        idempotent.idempotent = true;
+        auto marked = makeService(idempotent);
+        REQUIRE(call(marked, "hedgePut") == "fast");
+        REQUIRE(marked.hedgeStats().hedges == 1);
+
+        httpcl::Config notIdempotent;
+        notIdempotent.idempotent = false;
+        auto unmarked = makeService(notIdempotent);
+        REQUIRE(call(unmarked, "hedgeGet") == "slow");
+        REQUIRE(unmarked.hedgeStats().attempts == 0);
+    }
+}
+
+TEST_CASE("OAClient - Hedged requests go to other servers and cancel losers", "[oaclient][hedging]") {
+    std::mutex mutex;
+    std::vector<std::string> calledUris;
+    std::atomic<int> cancelled{0};
+    // Like HttpLibHttpClient, whose stopped requests fail with status 0.
+    bool stoppedWithStatus0 = false;
+
+    /** Slow servers answer after 2s, unless the request is cancelled. */
+    struct SlowMock : httpcl::MockHttpClient
+    {
+        std::function<Result(const std::string&, const httpcl::Config&)> fun;
+
+        Result get(const std::string& uri, const httpcl::Config& config) override {
+            return fun(uri, config);
+        }
+    };
+
+    auto mock = std::make_unique<SlowMock>();
+    mock->fun = [&](const std::string& uri, const httpcl::Config& config) -> httpcl::IHttpClient::Result {
+        {
+            std::lock_guard lock(mutex);
+            calledUris.emplace_back(uri);
+        }
+        if (uri.find("slow") == std::string::npos)
+            return {200, "fast"};
+        if (config.cancellation && config.cancellation->waitFor(std::chrono::seconds(2))) {
+            ++cancelled;
+            if (stoppedWithStatus0)
+                return {0, {}};
+            throw httpcl::CancelledError("cancelled");
+        }
+        return {200, "slow"};
+    };
+    auto config = makeConfig(R"json(
+        "/hedge": {
+            "get": {
+                "operationId": "hedgeGet",
+                "x-zswag-hedge": {"delay-ms": 10, "max-hedges": 3}
+            }
+        }
+    )json");
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+
+    SECTION("A single server gets no duplicates") {
+        config.servers = {httpcl::URIComponents::fromStrRfc3986("https://slow.server.com/api")};
+        auto service = OAClient(config, std::move(mock));
+        auto response = service.callMethod("hedgeGet", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+        REQUIRE(std::string(response.begin(), response.end()) == "slow");
+        REQUIRE(service.hedgeStats().hedges == 0);
+        std::lock_guard lock(mutex);
+        REQUIRE(calledUris.size() == 1);
+    }
+
+    SECTION("The slow loser is cancelled") {
+        config.servers = {
+            httpcl::URIComponents::fromStrRfc3986("https://slow.server.com/api"),
+            httpcl::URIComponents::fromStrRfc3986("https://fast.server.com/api")};
+        auto started = std::chrono::steady_clock::now();
+        {
+            auto service = OAClient(config, std::move(mock));
+            auto response = service.callMethod("hedgeGet", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+            REQUIRE(std::string(response.begin(), response.end()) == "fast");
+            REQUIRE(service.hedgeStats().hedges == 1);
+        }
+        // Destroying the client waits for the loser, which must not take the full 2s.
+        REQUIRE(std::chrono::steady_clock::now() - started < std::chrono::seconds(1));
+        REQUIRE(cancelled == 1);
+        std::lock_guard lock(mutex);
+        REQUIRE(calledUris.size() == 2);
+    }
+
+    SECTION("Cancelled losers do not count as failures") {
+        stoppedWithStatus0 = true;
+        config.servers = {
+            httpcl::URIComponents::fromStrRfc3986("https://slow.hedge-loser.com/api"),
+            httpcl::URIComponents::fromStrRfc3986("https://fast.hedge-loser.com/api")};
+        httpcl::CircuitBreakerPolicy breakerPolicy;
+        breakerPolicy.consecutiveFailures = 1;
+        httpcl::Config httpConfig;
+        httpConfig.circuitBreaker = breakerPolicy;
+        auto service = OAClient(config, std::move(mock), httpConfig);
+
+        for (auto i = 0u; i < httpcl::LoadBalancer::unhealthyAfterFailures; ++i) {
+            auto response = service.callMethod("hedgeGet", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+            REQUIRE(std::string(response.begin(), response.end()) == "fast");
+        }
+        REQUIRE(service.hedgeStats().wins == httpcl::LoadBalancer::unhealthyAfterFailures);
+
+        // Wait until the losers are done.
+        auto const& balancer = service.loadBalancer();
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (balancer.stats(0).outstanding > 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        REQUIRE(cancelled == static_cast<int>(httpcl::LoadBalancer::unhealthyAfterFailures));
+
+        auto stats = balancer.stats(0);
+        REQUIRE(stats.outstanding == 0);
+        REQUIRE(stats.consecutiveFailures == 0);
+        REQUIRE(stats.healthy);
+        auto breaker = httpcl::CircuitBreakerRegistry::instance().get("https://slow.hedge-loser.com", breakerPolicy);
+        REQUIRE(breaker->state() == httpcl::CircuitBreaker::State::Closed);
+    }
+}
+
+TEST_CASE("OAClient - Call options", "[oaclient][call-options]") {
+    httpcl::Config lastConfig;
+    int calls = 0;
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view) {
+        ++calls;
+        return httpcl::IHttpClient::Result{503, {}};
+    };
+    client->postFun = [&](std::string_view, auto const&, httpcl::Config const& config) {
+        ++calls;
+        lastConfig = config;
+        return httpcl::IHttpClient::Result{200, "response"};
+    };
+
+    auto config = makeConfig(R"json(
+        "/options": {
+            "get": {
+                "operationId": "optionsGet",
+                "x-zswag-retry": {"max-attempts": 5, "initial-backoff-ms": 100, "jitter": 0}
+            },
+            "post": {
+                "operationId": "optionsPost",
+                "x-zswag-timeout": 2.5
+            }
+        }
+    )json");
+    REQUIRE(config.methodPath["optionsPost"].timeout == std::chrono::milliseconds(2500));
+    auto service = OAClient(config, std::move(client));
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+    auto call = [&](std::string const& method, CallOptions* options) {
+        return service.callMethod(method, zserio::ReflectableServiceData(request.reflectable()), options);
+    };
+
+    SECTION("Headers and the spec's timeout are applied") {
+        CallOptions options;
+        options.headers.insert({"X-Request-Id", "42"});
+        auto before = CallOptions::Clock::now();
+        call("optionsPost", &options);
+        REQUIRE(lastConfig.headers.find("X-Request-Id")->second == "42");
+        REQUIRE(lastConfig.deadline);
+        REQUIRE(*lastConfig.deadline >= before + std::chrono::milliseconds(2500));
+    }
+
+    SECTION("An explicit deadline overrides the spec's timeout") {
+        CallOptions options;
+        options.timeout(std::chrono::milliseconds(100));
+        call("optionsPost", &options);
+        REQUIRE(*lastConfig.deadline == *options.deadline);
+    }
+
+    SECTION("Retries stop at the deadline") {
+        CallOptions options;
+        options.timeout(std::chrono::milliseconds(150));
+        REQUIRE_THROWS_AS(call("optionsGet", &options), httpcl::DeadlineExceededError);
+        REQUIRE(calls == 2);
+    }
+
+    SECTION("Cancelled calls are not sent") {
+        CallOptions options;
+        options.cancellation = std::make_shared<httpcl::CancellationToken>();
+        options.cancellation->cancel();
+        REQUIRE_THROWS_AS(call("optionsPost", &options), httpcl::CancelledError);
+        REQUIRE(calls == 0);
+    }
+}
+
+TEST_CASE("OAClient - Aborted calls do not count as server failures", "[oaclient][call-options][circuit-breaker]") {
+    /** Answers once the call is cancelled or its deadline passed, like a stopped HttpLibHttpClient. */
+    struct StoppedMock : httpcl::MockHttpClient
+    {
+        Result get(const std::string&, const httpcl::Config& config) override {
+            if (config.deadline)
+                std::this_thread::sleep_until(*config.deadline);
+            else if (config.cancellation)
+                config.cancellation->waitFor(std::chrono::seconds(2));
+            return {0, {}};
+        }
+    };
+
+    auto config = makeConfig(R"json(
+        "/aborted": {
+            "get": {
+                "operationId": "abortedGet"
+            }
+        }
+    )json");
+    config.servers = {httpcl::URIComponents::fromStrRfc3986("https://aborted.server.com/api")};
+    httpcl::CircuitBreakerPolicy breakerPolicy;
+    breakerPolicy.consecutiveFailures = 1;
+    httpcl::Config httpConfig;
+    httpConfig.circuitBreaker = breakerPolicy;
+    auto service = OAClient(config, std::make_unique<StoppedMock>(), httpConfig);
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+    auto call = [&](CallOptions& options) {
+        return service.callMethod("abortedGet", zserio::ReflectableServiceData(request.reflectable()), &options);
+    };
+
+    auto const attempts = httpcl::LoadBalancer::unhealthyAfterFailures;
+
+    SECTION("Deadline") {
+        for (auto i = 0u; i < attempts; ++i) {
+            CallOptions options;
+            options.timeout(std::chrono::milliseconds(20));
+            REQUIRE_THROWS_AS(call(options), httpcl::DeadlineExceededError);
+        }
+    }
+
+    SECTION("Cancellation") {
+        for (auto i = 0u; i < attempts; ++i) {
+            CallOptions options;
+            options.cancellation = std::make_shared<httpcl::CancellationToken>();
+            std::thread canceller([&]{
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                options.cancellation->cancel();
+            });
+            REQUIRE_THROWS_AS(call(options), httpcl::CancelledError);
+            canceller.join();
+        }
+    }
+
+    auto stats = service.loadBalancer().stats(0);
+    REQUIRE(stats.consecutiveFailures == 0);
+    REQUIRE(stats.healthy);
+    auto breaker = httpcl::CircuitBreakerRegistry::instance().get("https://aborted.server.com", breakerPolicy);
+    REQUIRE(breaker->state() == httpcl::CircuitBreaker::State::Closed);
+}
+
+TEST_CASE("OAClient - Async retries", "[oaclient][retry]") {
+    std::atomic<int> calls{0};
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        ++calls;
+        if (uri.find("backup") == std::string_view::npos)
+            return httpcl::IHttpClient::Result{503, {}};
+        return httpcl::IHttpClient::Result{200, "response"};
+    };
+
+    auto config = makeConfig(R"json(
+        "/async-retry": {
+            "get": {
+                "operationId": "asyncRetryGet",
+                "x-zswag-retry": {"max-attempts": 2, "initial-backoff-ms": 300, "jitter": 0}
+            }
+        },
+        "/slow-retry": {
+            "get": {
+                "operationId": "slowRetryGet",
+                "x-zswag-retry": {"max-attempts": 2, "initial-backoff-ms": 10000, "jitter": 0}
+            }
+        }
+    )json");
+    config.servers.push_back(httpcl::URIComponents::fromStrRfc3986("https://backup.server.com/api"));
+    auto service = OAClient(config, std::move(client));
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+
+    SECTION("Waiting for a retry does not occupy a worker") {
+        auto count = httpcl::ThreadPool::shared().size() * 4;
+        std::vector<std::future<std::vector<uint8_t>>> responses;
+        auto started = std::chrono::steady_clock::now();
+        for (auto i = 0u; i < count; ++i)
+            responses.push_back(service.callMethodAsync("asyncRetryGet", zserio::ReflectableServiceData(request.reflectable())));
+        for (auto& response : responses) {
+            auto content = response.get();
+            REQUIRE(std::string(content.begin(), content.end()) == "response");
+        }
+
+        // Workers which sleep through the backoff would need four times as long.
+        REQUIRE(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(900));
+        REQUIRE(calls == static_cast<int>(count * 2));
+    }
+
+    SECTION("Cancelling a call ends its wait for a retry") {
+        CallOptions options;
+        options.cancellation = std::make_shared<httpcl::CancellationToken>();
+        auto response = service.callMethodAsync("slowRetryGet", zserio::ReflectableServiceData(request.reflectable()), options);
+        while (calls == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        options.cancellation->cancel();
+
+        REQUIRE(response.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        REQUIRE_THROWS_AS(response.get(), httpcl::CancelledError);
+        REQUIRE(calls == 1);
+    }
+}
+
+TEST_CASE("OAClient - Coalescing identical calls", "[oaclient][coalesce]") {
+    constexpr auto callers = 4;
+    OAClient* service = nullptr;
+    std::atomic<int> requests{0};
+
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        ++requests;
+        // Stay in flight until the other callers joined.
+        for (auto i = 0; i < 500 && service->coalescedCalls() < callers - 1; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return httpcl::IHttpClient::Result{200, std::string(uri)};
+    };
+
+    auto config = makeConfig(R"json(
+        "/coalesce": {
+            "get": {
+                "operationId": "coalesceGet",
+                "x-zswag-coalesce": true
+            }
+        }
+    )json");
+    OAClient oaClient(config, std::move(client));
+    service = &oaClient;
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+
+    std::vector<std::future<std::vector<uint8_t>>> responses;
+    for (auto i = 0; i < callers; ++i)
+        responses.emplace_back(std::async(std::launch::async, [&]{
+            return oaClient.callMethod("coalesceGet", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+        }));
+
+    for (auto& response : responses) {
+        auto data = response.get();
+        REQUIRE(std::string(data.begin(), data.end()) == "https://my.server.com/api/coalesce");
+    }
+    REQUIRE(requests == 1);
+    REQUIRE(oaClient.coalescedCalls() == callers - 1);
+
+    // Later calls are sent again.
+    oaClient.callMethod("coalesceGet", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+    REQUIRE(requests == 2);
+}
+
+TEST_CASE("OAClient - Response cache", "[oaclient][response-cache]") {
+    int requests = 0;
+    int status = 200;
+
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        ++requests;
+        return httpcl::IHttpClient::Result{status, std::string(uri)};
+    };
+
+    auto config = makeConfig(R"json(
+        "/cached": {
+            "get": {
+                "operationId": "cachedGet",
+                "x-zswag-cache-ttl": 60
+            }
+        },
+        "/uncached": {
+            "get": {
+                "operationId": "uncachedGet"
+            }
+        }
+    )json");
+    auto service = OAClient(config, std::move(client));
+
+    auto request = service_client_test::Request(
+        "hello", 0, std::vector<std::string>{},
+        service_client_test::Flat("", ""));
+    auto call = [&](std::string const& method) {
+        auto data = service.callMethod(method, zserio::ReflectableServiceData(request.reflectable()), nullptr);
+        return std::string(data.begin(), data.end());
+    };
+
+    SECTION("Hits skip the request") {
+        REQUIRE(call("cachedGet") == "https://my.server.com/api/cached");
+        REQUIRE(call("cachedGet") == "https://my.server.com/api/cached");
+        REQUIRE(requests == 1);
+        REQUIRE(service.cacheStats().hits == 1);
+        REQUIRE(service.cacheStats().misses == 1);
+        REQUIRE(service.cacheStats().entries == 1);
+    }
+
+    SECTION("Hits share the cached bytes") {
+        auto first = service.callMethodBuffer("cachedGet", zserio::ReflectableServiceData(request.reflectable()));
+        auto second = service.callMethodBuffer("cachedGet", zserio::ReflectableServiceData(request.reflectable()));
+        REQUIRE(first.view() == "https://my.server.com/api/cached");
+        REQUIRE(first.data() == second.data());
+        REQUIRE(requests == 1);
+    }
+
+    SECTION("Methods without TTL are not cached") {
+        call("uncachedGet");
+        call("uncachedGet");
+        REQUIRE(requests == 2);
+        REQUIRE(service.cacheStats().entries == 0);
+    }
+
+    SECTION("Errors are not cached") {
+        status = 404;
+        REQUIRE_THROWS(call("cachedGet"));
+        status = 200;
+        call("cachedGet");
+        REQUIRE(requests == 2);
+    }
+}
+
+TEST_CASE("OAClient - Field accessors", "[oaclient][field-accessors]") {
+    std::vector<std::string> uris;
+
+    auto client = std::make_unique<httpcl::MockHttpClient>();
+    client->getFun = [&](std::string_view uri) {
+        uris.emplace_back(uri);
+        return httpcl::IHttpClient::Result{200, {}};
+    };
+
+    auto config = makeConfig(R"json(
+        "/person/{name}": {
+            "get": {
+                "operationId": "person",
+                "parameters": [
+                    {"name": "name", "in": "path", "x-zserio-request-part": "flat.firstName"},
+                    {"name": "tags", "in": "query", "style": "form", "explode": false, "x-zserio-request-part": "strArray"}
+                ]
+            }
+        },
+        "/unknown": {
+            "get": {
+                "operationId": "unknown",
+                "parameters": [
+                    {"name": "x", "in": "query", "x-zserio-request-part": "flat.lastName"}
+                ]
+            }
+        }
+    )json");
+    auto service = OAClient(config, std::move(client));
+
+    SECTION("Repeated calls read the current values") {
+        auto request = service_client_test::Request(
+            "", 2, std::vector<std::string>{"a", "b"},
+            service_client_test::Flat("", "ada"));
+        service.callMethod("person", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+
+        request.setStrLen(1);
+        request.setStrArray({"c"});
+        request.getFlat().setFirstName("grace");
+        service.callMethod("person", zserio::ReflectableServiceData(request.reflectable()), nullptr);
+
+        REQUIRE(uris == std::vector<std::string>{
+            "https://my.server.com/api/person/ada?tags=a,b",
+            "https://my.server.com/api/person/grace?tags=c"});
+    }
+
+    SECTION("Unknown fields fail on every call") {
+        auto request = service_client_test::Request(
+            "", 0, std::vector<std::string>{},
+            service_client_test::Flat("", ""));
+        for (auto i = 0; i < 2; ++i) {
+            REQUIRE_THROWS_WITH(
+                service.callMethod("unknown", zserio::ReflectableServiceData(request.reflectable()), nullptr),
+                "Could not find field/function for identifier 'flat.lastName'");
+        }
+        REQUIRE(uris.empty());
+    }
+}
+
 // ============================================================================
 // Array and Complex Type Tests
 // ============================================================================
@@ -470,9 +1269,12 @@ TEST_CASE("OAClient - Primitive Arrays", "[oaclient][arrays]") {
 
         client->getFun = [&](std::string_view uri) {
             getCalled = true;
-            // Just verify parameters exist, exact float representation varies
             REQUIRE(uri.find("floats=") != std::string::npos);
             REQUIRE(uri.find("doubles=") != std::string::npos);
+            // Floats are formatted with their shortest float32 digits
+            REQUIRE(uri.find("3.14") != std::string::npos);
+            REQUIRE(uri.find("3.1400") == std::string::npos);
+            REQUIRE(uri.find("3.14159") != std::string::npos);
             return httpcl::IHttpClient::Result{200, {}};
         };
 
@@ -1,13 +1,17 @@
 #include <catch2/catch_all.hpp>
 
+#include <atomic>
 #include <fstream>
 #include <chrono>
+#include <future>
+#include <mutex>
 #include <thread>
 #include <sstream>
 
 #include "zswagcl/oaclient.hpp"
 #include "zswagcl/private/openapi-oauth.hpp"
 #include "httpcl/http-client.hpp"
+#include "httpcl/executor.hpp"
 #include "httplib.h"
 #include "yaml-cpp/yaml.h"
 #include "service_client_test/Request.h"
@@ -463,3 +467,288 @@ TEST_CASE("OAuth2 Client Credentials Flow", "[oauth2]") {
         oaClient->callMethod("test", zserio::ReflectableServiceData(request.reflectable()), nullptr);
     }
 }
+
+TEST_CASE("OAuth2 Background Token Refresh", "[oauth2]") {
+    MockOAuth2Server mockServer;
+    mockServer.tokenExpirySeconds = 40;  // 10s after the jiggle period
+
+    // Refresh requests wait until the test releases them (or a check failed)
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    httpcl::MockHttpClient client;
+    client.postFun = [&](auto uri, auto body, auto conf) {
+        if (uri == "https://auth.example.com/refresh") {
+            released.wait_for(5s);
+            return mockServer.handleRefreshRequest(uri, body, conf);
+        }
+        return mockServer.handleTokenRequest(uri, body, conf);
+    };
+
+    auto config = makeOAuth2Config("https://auth.example.com/token", "https://auth.example.com/refresh");
+    auto const& req = config.methodPath["test"].security->front().front();
+
+    httpcl::Settings settings;
+    httpcl::Config httpConfig;
+    httpConfig.oauth2 = httpcl::Config::OAuth2{"test-client", "test-secret"};
+    httpConfig.oauth2->refreshAfter = 0.01;  // After 100ms
+
+    OAuth2ClientCredentialsHandler handler;
+    auto authorize = [&]() {
+        auto result = httpConfig;
+        std::string uri = "https://api.example.com/test";
+        AuthContext ctx{client, uri, settings, result};
+        std::string mismatchReason;
+        REQUIRE(handler.satisfy(req, ctx, mismatchReason));
+        return result.headers.find("Authorization")->second;
+    };
+
+    REQUIRE(authorize() == "Bearer access_1");
+    std::this_thread::sleep_for(200ms);
+
+    SECTION("Requests keep using the current token during the refresh") {
+        // Starts the refresh, which blocks until released
+        REQUIRE(authorize() == "Bearer access_1");
+        REQUIRE(authorize() == "Bearer access_1");
+
+        release.set_value();
+        handler.waitForBackgroundTasks();
+        REQUIRE(mockServer.tokenRequestCount == 1);
+        REQUIRE(mockServer.refreshRequestCount == 1);
+        REQUIRE(authorize() == "Bearer refreshed_access_1");
+    }
+
+    SECTION("A failed refresh falls back to minting a new token") {
+        mockServer.shouldFailRefreshRequest = true;
+        release.set_value();
+
+        REQUIRE(authorize() == "Bearer access_1");
+        handler.waitForBackgroundTasks();
+        REQUIRE(mockServer.tokenRequestCount == 2);
+        REQUIRE(mockServer.refreshRequestCount == 1);
+        REQUIRE(authorize() == "Bearer access_2");
+    }
+
+    SECTION("A failed mint keeps the current token") {
+        mockServer.shouldFailRefreshRequest = true;
+        mockServer.shouldFailTokenRequest = true;
+        release.set_value();
+
+        REQUIRE(authorize() == "Bearer access_1");
+        handler.waitForBackgroundTasks();
+        REQUIRE(mockServer.tokenRequestCount == 2);
+        REQUIRE(authorize() == "Bearer access_1");
+    }
+}
+
+TEST_CASE("OAuth2 Background Token Refresh Disabled", "[oauth2]") {
+    MockOAuth2Server mockServer;
+    mockServer.tokenExpirySeconds = 40;
+
+    httpcl::MockHttpClient client;
+    client.postFun = [&](auto uri, auto body, auto conf) {
+        return mockServer.handleTokenRequest(uri, body, conf);
+    };
+
+    auto config = makeOAuth2Config("https://auth.example.com/token");
+    auto const& req = config.methodPath["test"].security->front().front();
+
+    httpcl::Settings settings;
+    httpcl::Config result;
+    result.oauth2 = httpcl::Config::OAuth2{"test-client", "test-secret"};
+    result.oauth2->refreshAfter = 1.;
+    std::string uri = "https://api.example.com/test";
+    AuthContext ctx{client, uri, settings, result};
+
+    OAuth2ClientCredentialsHandler handler;
+    std::string mismatchReason;
+    REQUIRE(handler.satisfy(req, ctx, mismatchReason));
+    std::this_thread::sleep_for(200ms);
+    REQUIRE(handler.satisfy(req, ctx, mismatchReason));
+
+    handler.waitForBackgroundTasks();
+    REQUIRE(mockServer.tokenRequestCount == 1);
+    REQUIRE(mockServer.refreshRequestCount == 0);
+}
+
+TEST_CASE("OAuth2 Single-Flight Token Requests", "[oauth2]") {
+    MockOAuth2Server mockServer;
+    std::mutex mockServerMutex;
+
+    // Token requests for the "slow" scope wait until the test releases them (or a check failed)
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> slowRequestCount{0};
+
+    httpcl::MockHttpClient client;
+    client.postFun = [&](auto uri, auto body, auto conf) {
+        if (body && body->body.find("scope=slow") != std::string::npos) {
+            ++slowRequestCount;
+            released.wait_for(5s);
+        }
+        std::lock_guard lock(mockServerMutex);
+        return mockServer.handleTokenRequest(uri, body, conf);
+    };
+
+    auto config = makeOAuth2Config("https://auth.example.com/token");
+    auto slowReq = config.methodPath["test"].security->front().front();
+    slowReq.scopes = {"slow"};
+    auto fastReq = slowReq;
+    fastReq.scopes = {"fast"};
+
+    httpcl::Settings settings;
+    httpcl::Config httpConfig;
+    httpConfig.oauth2 = httpcl::Config::OAuth2{"test-client", "test-secret"};
+
+    OAuth2ClientCredentialsHandler handler;
+    auto authorize = [&](OpenAPIConfig::SecurityRequirement const& req, httpcl::Config result) -> std::string {
+        std::string uri = "https://api.example.com/test";
+        AuthContext ctx{client, uri, settings, result};
+        std::string mismatchReason;
+        if (!handler.satisfy(req, ctx, mismatchReason))
+            return mismatchReason;
+        return result.headers.find("Authorization")->second;
+    };
+
+    std::vector<std::future<std::string>> slowCalls;
+    for (auto i = 0; i < 4; ++i)
+        slowCalls.push_back(std::async(std::launch::async, [&]() { return authorize(slowReq, httpConfig); }));
+    while (slowRequestCount == 0)
+        std::this_thread::sleep_for(1ms);
+
+    SECTION("Concurrent callers share one request, other keys proceed") {
+        REQUIRE(authorize(fastReq, httpConfig) == "Bearer access_1");
+
+        std::this_thread::sleep_for(50ms);
+        release.set_value();
+        for (auto& call : slowCalls)
+            REQUIRE(call.get() == "Bearer access_2");
+
+        REQUIRE(slowRequestCount == 1);
+        REQUIRE(mockServer.tokenRequestCount == 2);
+    }
+
+    SECTION("Waiting callers give up at their own deadline") {
+        auto withDeadline = httpConfig;
+        withDeadline.deadline = std::chrono::steady_clock::now() + 50ms;
+        REQUIRE_THAT(authorize(slowReq, withDeadline), Catch::Matchers::ContainsSubstring("Deadline exceeded"));
+
+        release.set_value();
+        for (auto& call : slowCalls)
+            REQUIRE(call.get() == "Bearer access_1");
+        REQUIRE(slowRequestCount == 1);
+    }
+}
+
+TEST_CASE("OAuth2 Token Requests Aborted By Their Caller", "[oauth2]") {
+    MockOAuth2Server mockServer;
+    std::mutex mockServerMutex;
+
+    // Token requests wait until the test releases them, or their deadline passed
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> requestCount{0};
+
+    httpcl::MockHttpClient client;
+    client.postFun = [&](auto uri, auto body, auto conf) -> httpcl::IHttpClient::Result {
+        ++requestCount;
+        if (conf.deadline)
+            released.wait_until(*conf.deadline);
+        else
+            released.wait_for(5s);
+        if (conf.deadline && std::chrono::steady_clock::now() >= *conf.deadline)
+            return {0, ""};
+        std::lock_guard lock(mockServerMutex);
+        return mockServer.handleTokenRequest(uri, body, conf);
+    };
+
+    auto config = makeOAuth2Config("https://auth.example.com/token");
+    auto const& req = config.methodPath["test"].security->front().front();
+
+    httpcl::Settings settings;
+    httpcl::Config httpConfig;
+    httpConfig.oauth2 = httpcl::Config::OAuth2{"test-client", "test-secret"};
+
+    OAuth2ClientCredentialsHandler handler;
+    auto authorize = [&](httpcl::Config result) -> std::string {
+        std::string uri = "https://api.example.com/test";
+        AuthContext ctx{client, uri, settings, result};
+        std::string mismatchReason;
+        if (!handler.satisfy(req, ctx, mismatchReason))
+            return mismatchReason;
+        return result.headers.find("Authorization")->second;
+    };
+
+    auto hasty = httpConfig;
+    hasty.deadline = std::chrono::steady_clock::now() + 100ms;
+    auto hastyCall = std::async(std::launch::async, [&]() { return authorize(hasty); });
+    while (requestCount == 0)
+        std::this_thread::sleep_for(1ms);
+    auto patientCall = std::async(std::launch::async, [&]() { return authorize(httpConfig); });
+
+    REQUIRE_THAT(hastyCall.get(), Catch::Matchers::ContainsSubstring("Deadline exceeded"));
+    while (requestCount < 2)
+        std::this_thread::sleep_for(1ms);
+    release.set_value();
+
+    REQUIRE(patientCall.get() == "Bearer access_1");
+    REQUIRE(requestCount == 2);
+}
+
+TEST_CASE("OAuth2 Queued Background Refresh", "[oauth2]") {
+    MockOAuth2Server mockServer;
+    mockServer.tokenExpirySeconds = 31;  // 1s after the jiggle period
+
+    httpcl::MockHttpClient client;
+    client.postFun = [&](auto uri, auto body, auto conf) {
+        if (uri == "https://auth.example.com/refresh")
+            return mockServer.handleRefreshRequest(uri, body, conf);
+        return mockServer.handleTokenRequest(uri, body, conf);
+    };
+
+    auto config = makeOAuth2Config("https://auth.example.com/token", "https://auth.example.com/refresh");
+    auto const& req = config.methodPath["test"].security->front().front();
+
+    httpcl::Settings settings;
+    httpcl::Config httpConfig;
+    httpConfig.oauth2 = httpcl::Config::OAuth2{"test-client", "test-secret"};
+    httpConfig.oauth2->refreshAfter = 0.01;  // After 10ms
+
+    OAuth2ClientCredentialsHandler handler;
+    auto authorize = [&]() -> std::string {
+        auto result = httpConfig;
+        std::string uri = "https://api.example.com/test";
+        AuthContext ctx{client, uri, settings, result};
+        std::string mismatchReason;
+        if (!handler.satisfy(req, ctx, mismatchReason))
+            return mismatchReason;
+        return result.headers.find("Authorization")->second;
+    };
+
+    REQUIRE(authorize() == "Bearer access_1");
+
+    // Keep all workers busy, so that the background refresh stays queued
+    auto& pool = httpcl::ThreadPool::shared();
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<std::size_t> busy{0};
+    for (auto i = 0u; i < pool.size(); ++i)
+        pool.post([&busy, released]{ ++busy; released.wait_for(5s); });
+    while (busy < pool.size())
+        std::this_thread::sleep_for(1ms);
+
+    std::this_thread::sleep_for(50ms);
+    REQUIRE(authorize() == "Bearer access_1");
+
+    // Once the token expired, the caller runs the queued refresh itself
+    std::this_thread::sleep_for(1100ms);
+    auto call = std::async(std::launch::async, authorize);
+    REQUIRE(call.wait_for(2s) == std::future_status::ready);
+    REQUIRE(call.get() == "Bearer refreshed_access_1");
+    REQUIRE(mockServer.refreshRequestCount == 1);
+
+    release.set_value();
+    handler.waitForBackgroundTasks();
+    REQUIRE(mockServer.refreshRequestCount == 1);
+    REQUIRE(mockServer.tokenRequestCount == 1);
+}
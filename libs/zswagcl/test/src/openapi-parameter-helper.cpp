@@ -22,18 +22,38 @@ static auto makeParameter(std::string ident,
     return parameter;
 }
 
+/**
+ * Format the value returned by `fun` as ParameterValue, and check
+ * that a ParameterWriter streams the same path.
+ */
 template <class _Fun>
 static auto pathStr(const Parameter& parameter, _Fun fun)
 {
     ParameterValueHelper helper(parameter);
-    return fun(helper).pathStr(parameter);
+    auto result = fun(helper).pathStr(parameter);
+
+    std::string streamed = "/prefix";
+    ParameterWriter writer(parameter, streamed);
+    ParameterValueHelper streamingHelper(parameter, writer);
+    fun(streamingHelper).write(writer);
+    REQUIRE(streamed == "/prefix" + result);
+
+    return result;
 }
 
 template <class _Fun>
 static auto queryOrHeaderPairs(const Parameter& parameter, _Fun fun)
 {
     ParameterValueHelper helper(parameter);
-    return fun(helper).queryOrHeaderPairs(parameter);
+    auto result = fun(helper).queryOrHeaderPairs(parameter);
+
+    ParameterWriter::Pairs streamed;
+    ParameterWriter writer(parameter, streamed);
+    ParameterValueHelper streamingHelper(parameter, writer);
+    fun(streamingHelper).write(writer);
+    REQUIRE(std::vector<std::pair<std::string, std::string>>(streamed.begin(), streamed.end()) == result);
+
+    return result;
 }
 
 /* Testdata */
@@ -400,7 +420,7 @@ TEST_CASE("openapi parameter helper - floating point", "[zswagcl::open-api-forma
         ParameterValueHelper helper(param);
 
         auto r = helper.value(3.14f).pathStr(param);
-        REQUIRE(r == "3.140000");
+        REQUIRE(r == "3.14");
     }
 
     SECTION("Double with String format") {
@@ -408,7 +428,7 @@ TEST_CASE("openapi parameter helper - floating point", "[zswagcl::open-api-forma
         ParameterValueHelper helper(param);
 
         auto r = helper.value(2.71828).pathStr(param);
-        REQUIRE(r.substr(0, 7) == "2.71828");
+        REQUIRE(r == "2.71828");
     }
 
     SECTION("Float array with String format") {
@@ -416,7 +436,7 @@ TEST_CASE("openapi parameter helper - floating point", "[zswagcl::open-api-forma
         ParameterValueHelper helper(param);
 
         auto r = helper.array(std::vector<double>{1.1, 2.2, 3.3}).pathStr(param);
-        REQUIRE(r == "1.100000,2.200000,3.300000");
+        REQUIRE(r == "1.1,2.2,3.3");
     }
 
     SECTION("Float with Binary format") {
@@ -424,8 +444,33 @@ TEST_CASE("openapi parameter helper - floating point", "[zswagcl::open-api-forma
         ParameterValueHelper helper(param);
 
         auto r = helper.value(1.0).pathStr(param);
-        REQUIRE(r.size() == sizeof(double));
+        REQUIRE(r == std::string("\x3f\xf0\0\0\0\0\0\0", 8));
     }
+
+    SECTION("String format round-trips") {
+        auto param = makeParameter("value", PStyle::Simple, false, Format::String);
+        ParameterValueHelper helper(param);
+
+        for (auto v : {0.1, 1.0 / 3.0, 1e-300, 123456789.123456789, -2.5e20}) {
+            auto r = helper.value(v).pathStr(param);
+            INFO(r);
+            REQUIRE(std::strtod(r.c_str(), nullptr) == v);
+        }
+        REQUIRE(helper.value(0.1f).pathStr(param) == "0.1");
+    }
+}
+
+TEST_CASE("openapi parameter helper - byte order", "[zswagcl::open-api-format-helper]") {
+    auto param = makeParameter("value", PStyle::Simple, false, Format::Hex);
+    ParameterValueHelper helper(param);
+    auto binary = makeParameter("value", PStyle::Simple, false, Format::Base64);
+    ParameterValueHelper binaryHelper(binary);
+
+    REQUIRE(impl::htobe(std::uint16_t(0x0102)) == std::uint16_t(0x0201));
+    REQUIRE(impl::htobe(std::uint32_t(0x01020304)) == std::uint32_t(0x04030201));
+    REQUIRE(impl::htobe(std::int64_t(0x0102030405060708)) == std::int64_t(0x0807060504030201));
+    REQUIRE(helper.value(1.5f).pathStr(param) == "3fc00000");
+    REQUIRE(binaryHelper.value(std::int16_t(-2)).pathStr(binary) == "//4=");
 }
 
 TEST_CASE("openapi parameter helper - Base64 encoding", "[zswagcl::open-api-format-helper]") {
@@ -705,3 +750,133 @@ TEST_CASE("openapi parameter helper - binary method overloads", "[zswagcl::open-
         REQUIRE(r == "AQIDBA==");
     }
 }
+
+TEST_CASE("openapi parameter writer", "[zswagcl::open-api-format-helper]") {
+    std::vector<std::uint64_t> ids(1000);
+    for (auto i = 0u; i < ids.size(); ++i)
+        ids[i] = 0xfff000 + i;
+
+    SECTION("Streamed values are empty") {
+        auto param = makeParameter("ids", PStyle::Form, false);
+        ParameterWriter::Pairs pairs;
+        ParameterWriter writer(param, pairs);
+        ParameterValueHelper helper(param, writer);
+
+        auto value = helper.array(std::vector<int>{1, 2});
+        REQUIRE(std::holds_alternative<std::monostate>(value.value));
+        REQUIRE(pairs.size() == 1);
+        REQUIRE(pairs.begin()->second == "1,2");
+        REQUIRE_THROWS_WITH(value.bodyStr(), "Expected parameter-value of type string, got streamed value");
+    }
+
+    SECTION("Headers of unsupported styles are skipped") {
+        auto param = makeParameter("ids", PStyle::Label, false);
+        ParameterWriter::Pairs pairs;
+        ParameterWriter writer(param, pairs);
+        ParameterValueHelper helper(param, writer);
+
+        helper.array(ids);
+        REQUIRE(pairs.empty());
+    }
+}
+
+TEST_CASE("openapi parameter helper - parse buffers", "[zswagcl::open-api-format-helper]") {
+    std::string bytes("\x00\xfb\xff\x10", 4);
+    auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+    for (auto format : {Format::Hex, Format::Base64, Format::Base64url, Format::String})
+        REQUIRE(impl::parseBuffer(format, impl::formatBuffer(format, data, bytes.size())) == bytes);
+
+    REQUIRE(impl::parseBuffer(Format::Base64, "").empty());
+    REQUIRE(impl::parseBuffer(Format::Base64, "QQ==") == "A");
+    REQUIRE(impl::parseBuffer(Format::Base64, "QUI=") == "AB");
+
+    SECTION("Malformed base64 is rejected") {
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64, "AAAA*AAA"), "Invalid base64 character at position 4.");
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64, "AA=A"), "Invalid base64 character at position 2.");
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64, "AA-_"), "Invalid base64 character at position 2.");
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64url, "AA+/"), "Invalid base64 character at position 2.");
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64, "QQ"), "Invalid base64 length 2.");
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64, "QUJD="), "Invalid base64 length 5.");
+        REQUIRE_THROWS_WITH(impl::parseBuffer(Format::Base64, "Q==="), "Invalid base64 padding.");
+        REQUIRE_THROWS_AS(impl::parseBuffer(Format::Base64url, std::string(100, 'A') + "\xC3" "AAA"), std::invalid_argument);
+    }
+
+    SECTION("Malformed hex is rejected") {
+        REQUIRE_THROWS_AS(impl::parseBuffer(Format::Hex, "abc"), std::invalid_argument);
+        REQUIRE_THROWS_AS(impl::parseBuffer(Format::Hex, "zz"), std::invalid_argument);
+    }
+}
+
+TEST_CASE("openapi parameter writer benchmarks", "[.][benchmark]") {
+    std::vector<std::uint64_t> ids(10000);
+    for (auto i = 0u; i < ids.size(); ++i)
+        ids[i] = i * 0x9e3779b9ull;
+
+    auto query = makeParameter("ids", PStyle::Form, false, Format::Hex);
+    auto path = makeParameter("ids", PStyle::Label, true, Format::Base64);
+
+    BENCHMARK("Query array via ParameterValue") {
+        ParameterWriter::Pairs pairs;
+        ParameterValueHelper helper(query);
+        for (auto& pair : helper.array(ids).queryOrHeaderPairs(query))
+            pairs.insert(std::move(pair));
+        return pairs;
+    };
+
+    BENCHMARK("Query array via ParameterWriter") {
+        ParameterWriter::Pairs pairs;
+        ParameterWriter writer(query, pairs);
+        ParameterValueHelper helper(query, writer);
+        helper.array(ids).write(writer);
+        return pairs;
+    };
+
+    BENCHMARK("Path array via ParameterValue") {
+        std::string result;
+        ParameterValueHelper helper(path);
+        result += helper.array(ids).pathStr(path);
+        return result;
+    };
+
+    BENCHMARK("Path array via ParameterWriter") {
+        std::string result;
+        ParameterWriter writer(path, result);
+        ParameterValueHelper helper(path, writer);
+        helper.array(ids).write(writer);
+        return result;
+    };
+}
+
+TEST_CASE("openapi parameter format benchmarks", "[.][benchmark]") {
+    std::vector<std::int64_t> integers(10000);
+    std::vector<double> doubles(10000);
+    for (auto i = 0u; i < integers.size(); ++i) {
+        integers[i] = static_cast<std::int64_t>(i * 0x9e3779b9ull) - (1ll << 31);
+        doubles[i] = static_cast<double>(integers[i]) / 7.0;
+    }
+
+    std::pair<Format, const char*> formats[] = {
+        {Format::String, "string"},
+        {Format::Hex, "hex"},
+        {Format::Base64, "base64"},
+        {Format::Base64url, "base64url"},
+        {Format::Binary, "binary"}};
+
+    for (auto const& [format, name] : formats) {
+        auto param = makeParameter("values", PStyle::Simple, false, format);
+
+        BENCHMARK(std::string("10k int64, ") + name) {
+            std::string path;
+            ParameterWriter writer(param, path);
+            writer.array(integers);
+            return path;
+        };
+
+        BENCHMARK(std::string("10k double, ") + name) {
+            std::string path;
+            ParameterWriter writer(param, path);
+            writer.array(doubles);
+            return path;
+        };
+    }
+}
@@ -0,0 +1,78 @@
+#include <catch2/catch_all.hpp>
+
+#include "zswagcl/private/response-cache.hpp"
+
+#include <thread>
+
+using namespace zswagcl;
+using namespace std::chrono_literals;
+
+TEST_CASE("ResponseCache hits and misses", "[response-cache]") {
+    ResponseCache cache(1024 * 1024, 4);
+    REQUIRE_FALSE(cache.get("a"));
+
+    cache.put("a", "alpha", 1min);
+    auto value = cache.get("a");
+    REQUIRE(value);
+    REQUIRE(*value == "alpha");
+
+    SECTION("Values are replaced") {
+        cache.put("a", "omega", 1min);
+        REQUIRE(*cache.get("a") == "omega");
+        REQUIRE(*value == "alpha");
+        REQUIRE(cache.stats().entries == 1);
+    }
+
+    SECTION("Entries expire") {
+        cache.put("b", "beta", 1ms);
+        std::this_thread::sleep_for(5ms);
+        REQUIRE_FALSE(cache.get("b"));
+        REQUIRE(cache.stats().entries == 1);
+    }
+
+    SECTION("Zero TTL is not stored") {
+        cache.put("c", "gamma", 0s);
+        REQUIRE_FALSE(cache.get("c"));
+    }
+
+    auto stats = cache.stats();
+    REQUIRE(stats.hits >= 1);
+    REQUIRE(stats.misses >= 1);
+    REQUIRE(stats.evictions == 0);
+}
+
+TEST_CASE("ResponseCache stays within its budget", "[response-cache]") {
+    // One shard, so that the eviction order is predictable.
+    ResponseCache cache(1024, 1);
+    std::string value(200, 'x');
+
+    cache.put("1", value, 1min);
+    cache.put("2", value, 1min);
+    cache.put("3", value, 1min);
+    REQUIRE(cache.get("1"));
+
+    // Evicts "2", which is the least recently used entry.
+    cache.put("4", value, 1min);
+    REQUIRE(cache.get("1"));
+    REQUIRE_FALSE(cache.get("2"));
+    REQUIRE(cache.get("3"));
+    REQUIRE(cache.get("4"));
+
+    auto stats = cache.stats();
+    REQUIRE(stats.evictions == 1);
+    REQUIRE(stats.entries == 3);
+    REQUIRE(stats.bytes <= 1024);
+
+    SECTION("Values above the budget are not stored") {
+        cache.put("big", std::string(2048, 'x'), 1min);
+        REQUIRE_FALSE(cache.get("big"));
+        REQUIRE(cache.stats().entries == 3);
+    }
+
+    SECTION("Clear") {
+        cache.clear();
+        REQUIRE(cache.stats().entries == 0);
+        REQUIRE(cache.stats().bytes == 0);
+        REQUIRE_FALSE(cache.get("1"));
+    }
+}